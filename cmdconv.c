@@ -0,0 +1,147 @@
+/** @weakgroup tools
+ *  @{
+ */
+/**
+ * @file cmdconv.c
+ * @brief shell command compiler, makes sorted command table of shell_cmds.def
+ *
+ * Copyright 2020 Stanislav V. Vlasov <stanislav.v.v@gmail.com>
+ *
+ * Runs on build host, C source of command table is written to stdout.
+ * Table is sorted by name for {@link #shell_cmd_lookup}, duplicate
+ * names and bad arguments ranges stop the build. Firmware commands
+ * are put under UNITTEST guard, names of all commands are kept for
+ * tests, so order of full firmware table is checked by them too.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "shell_process.h"
+
+/**
+ * command of list
+ */
+typedef struct //vera++ blamed for single space
+{
+    const char *name;
+    const char *handler;    /** name of handler function */
+    unsigned min_args;
+    unsigned max_args;
+    const char *max_str;    /** max args as written in list */
+    unsigned flags;
+    const char *flags_str;  /** flags as written in list */
+    const char *help;
+    unsigned firmware;      /** 1 - left out of unit tests */
+} cmdconv_src_t;
+
+#define SHELL_CMD(name, handler, min, max, flags, help, firmware) \
+    {name, #handler, min, max, #max, flags, #flags, help, firmware},
+
+static cmdconv_src_t cmdconv_list[] =
+{
+#include "shell_cmds.def"
+};
+
+#undef SHELL_CMD
+
+#define CMDCONV_COUNT (sizeof(cmdconv_list) / sizeof(cmdconv_list[0]))
+
+/**
+ * @brief compare commands by name, as strcmp_local does
+ */
+static int cmdconv_cmp(const void *a, const void *b)
+{
+    return strcmp(((const cmdconv_src_t *)a)->name, ((const cmdconv_src_t *)b)->name);
+}
+
+/**
+ * @brief check sorted list
+ * @return count of errors, they are reported to stderr
+ */
+static unsigned cmdconv_check(void)
+{
+    unsigned errors = 0;
+
+    for (unsigned i = 0; i < CMDCONV_COUNT; i++)
+    {
+        const cmdconv_src_t *c = &cmdconv_list[i];
+        if ((c->name[0] == 0) || (c->help[0] == 0) || (c->min_args > c->max_args) ||
+            (c->max_args > SHELL_MAX_ARGS) || (c->firmware > 1))
+        {
+            fprintf(stderr, "cmdconv: bad command '%s'\n", c->name);
+            errors++;
+        }
+        if ((i > 0) && (strcmp(cmdconv_list[i - 1].name, c->name) == 0))
+        {
+            fprintf(stderr, "cmdconv: duplicate command '%s'\n", c->name);
+            errors++;
+        }
+    }
+    return errors;
+}
+
+/**
+ * @brief print handler prototypes or table entries
+ * @param table - 1 prints entries of table, 0 - prototypes
+ *
+ * Runs of firmware commands are put under UNITTEST guard.
+ */
+static void cmdconv_print(int table)
+{
+    unsigned firmware = 0;
+
+    for (unsigned i = 0; i < CMDCONV_COUNT; i++)
+    {
+        const cmdconv_src_t *c = &cmdconv_list[i];
+        if (c->firmware != firmware)
+        {
+            printf(c->firmware ? "#ifndef UNITTEST\n" : "#endif\n");
+            firmware = c->firmware;
+        }
+        if (table)
+        {
+            printf("    {\"%s\", %s, %u, %s, %s, \"%s\"},\n", c->name, c->handler,
+                   c->min_args, c->max_str, c->flags_str, c->help);
+        }
+        else
+        {
+            printf("void %s(char* argv[], uint16_t argc);\n", c->handler);
+        }
+    }
+    if (firmware)
+    {
+        printf("#endif\n");
+    }
+}
+
+int main(void)
+{
+    qsort(cmdconv_list, CMDCONV_COUNT, sizeof(cmdconv_list[0]), cmdconv_cmp);
+    if (cmdconv_check() != 0)
+    {
+        return 1;
+    }
+
+    printf("/* shell commands, made by cmdconv from shell_cmds.def, do not edit */\n");
+    printf("#include \"shell_process.h\"\n\n");
+    cmdconv_print(0);
+    printf("\nconst shell_cmd_def_t shell_cmd_table[] =\n{\n");
+    cmdconv_print(1);
+    printf("};\n\n");
+    printf("const uint16_t shell_cmd_count =\n"
+           "    (uint16_t)(sizeof(shell_cmd_table) / sizeof(shell_cmd_table[0]));\n\n");
+    printf("#ifdef UNITTEST\n");
+    printf("const char *const shell_cmd_all_names[] =\n{\n");
+    for (unsigned i = 0; i < CMDCONV_COUNT; i++)
+    {
+        printf("    \"%s\",\n", cmdconv_list[i].name);
+    }
+    printf("};\n\n");
+    printf("const uint16_t shell_cmd_all_count = %u;\n", (unsigned)CMDCONV_COUNT);
+    printf("#endif\n");
+    fprintf(stderr, "cmdconv    %u commands\n", (unsigned)CMDCONV_COUNT);
+    return 0;
+}
+
+/** @}*/
@@ -41,8 +41,17 @@
  */
 #define UART USART1
 #define UART_RCC RCC_USART1
+#define UART_IRQ NVIC_USART1_IRQ
+#define UART_TX_DMA DMA_CHANNEL4 // usart1 tx request of dma1
+#define UART_TX_DMA_IRQ NVIC_DMA1_CHANNEL4_IRQ
 #define UART_SPEED 921600 // max speed on some usb-uart converters
 
+/**
+ * nvic priority of interrupts calling FromISR rtos functions, must be
+ * numerically not lower than configMAX_SYSCALL_INTERRUPT_PRIORITY
+ */
+#define IRQ_PRIORITY_RTOS 0xc0
+
 /**
  * shell will be echo input chars
  */
@@ -59,12 +68,22 @@
  * DC         - PA3
  * SCK        - PA5 (SPI1 port)
  * SDA (MOSI) - PA7 (SPI1 port)
+ * TE         - PA4
  */
 #define ST7789_RST_PORT GPIOA
 #define ST7789_RST_PIN  GPIO2
 #define ST7789_DC_PORT  GPIOA
 #define ST7789_DC_PIN   GPIO3
 
+/**
+ * tearing effect output of display
+ * TE         - PA4 (free while CS is not used)
+ */
+#define ST7789_TE_PORT  GPIOA
+#define ST7789_TE_PIN   GPIO4
+#define ST7789_TE_EXTI  EXTI4
+#define ST7789_TE_IRQ   NVIC_EXTI4_IRQ
+
 // SPI1
 
 #define ST7789_RCC      RCC_SPI1
@@ -0,0 +1,764 @@
+/** @weakgroup hardware
+ *  @{
+ */
+/**
+ * @file display.c
+ * @brief queue of drawing commands and render task owning ST7789
+ *
+ * Copyright 2020 Stanislav V. Vlasov <stanislav.v.v@gmail.com>
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include "hw.h"
+#include "st7789.h"
+#include "display.h"
+
+#ifndef UNITTEST
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+/**
+ * render task, NULL before {@link #display_start}
+ */
+static TaskHandle_t display_task = NULL;
+
+#define DISPLAY_LOCK() taskENTER_CRITICAL()
+#define DISPLAY_UNLOCK() taskEXIT_CRITICAL()
+#define DISPLAY_LOCK_FROM_ISR(saved) saved = taskENTER_CRITICAL_FROM_ISR()
+#define DISPLAY_UNLOCK_FROM_ISR(saved) taskEXIT_CRITICAL_FROM_ISR(saved)
+#define DISPLAY_SELF() xTaskGetCurrentTaskHandle()
+
+#else
+
+#define DISPLAY_LOCK()
+#define DISPLAY_UNLOCK()
+#define DISPLAY_LOCK_FROM_ISR(saved) saved = 0
+#define DISPLAY_UNLOCK_FROM_ISR(saved) (void)(saved)
+#define DISPLAY_SELF() NULL
+
+#endif
+
+/**
+ * pending commands, oldest first
+ * @{
+ */
+static display_cmd_t display_queue[DISPLAY_QUEUE_SIZE];
+static uint16_t display_count = 0;
+/**
+ * @}
+ */
+
+display_stats_t display_stats;
+
+st7789_link_t display_link;
+
+st7789_verify_t display_verify_result;
+
+st7789_check_t display_check_result;
+
+/**
+ * viewport of posted commands on screen, inclusive, and task which
+ * holds it, posts of other tasks are in screen coordinates
+ * @{
+ */
+static uint16_t display_view_x0 = 0, display_view_y0 = 0;
+static uint16_t display_view_x1 = ST7789_WIDTH - 1, display_view_y1 = ST7789_HEIGHT - 1;
+static boolean display_view_held = FALSE;
+static TaskHandle_t display_view_task = NULL;
+/**
+ * @}
+ */
+
+/**
+ * fills, texts and images are read back after drawing
+ */
+static boolean display_checking = FALSE;
+
+/**
+ * frame sync state
+ * @{
+ */
+static uint8_t display_divider = 0;     /** draw on every n-th TE pulse, 0 - no sync */
+static uint32_t display_frame_te = 0;   /** TE count at start of last frame */
+static boolean display_waiting = FALSE; /** commands are pending without frame */
+static uint32_t display_wait_since = 0; /** tick when waiting started */
+/**
+ * @}
+ */
+
+/**
+ * @brief clean queue and counters
+ */
+void display_init(void)
+{
+    DISPLAY_LOCK();
+    display_count = 0;
+    display_stats.posted = 0;
+    display_stats.coalesced = 0;
+    display_stats.rejected = 0;
+    display_stats.drawn = 0;
+    display_stats.te = 0;
+    display_stats.frames = 0;
+    display_stats.missed = 0;
+    display_stats.unsynced = 0;
+    display_divider = 0;
+    display_frame_te = 0;
+    display_waiting = FALSE;
+    display_checking = FALSE;
+    display_view_x0 = display_view_y0 = 0;
+    display_view_x1 = ST7789_WIDTH - 1;
+    display_view_y1 = ST7789_HEIGHT - 1;
+    display_view_held = FALSE;
+    DISPLAY_UNLOCK();
+}
+
+/**
+ * @brief bounds of command on screen, cut by its viewport
+ * @param cmd - command
+ * @param b - x0, y0, x1, y1 of visible part on return
+ * @return FALSE if nothing of command is visible
+ */
+static boolean display_screen_bounds(const display_cmd_t *cmd, int32_t b[4])
+{
+    b[0] = (int32_t)cmd->vx0 + cmd->x0;
+    b[1] = (int32_t)cmd->vy0 + cmd->y0;
+    b[2] = (int32_t)cmd->vx0 + cmd->x1;
+    b[3] = (int32_t)cmd->vy0 + cmd->y1;
+    b[2] = (b[2] < cmd->vx1) ? b[2] : cmd->vx1;
+    b[3] = (b[3] < cmd->vy1) ? b[3] : cmd->vy1;
+    return (b[0] <= b[2]) && (b[1] <= b[3]);
+}
+
+/**
+ * @brief check if command is fully overdrawn by other one
+ * @param old - pending command
+ * @param cmd - new command
+ * @return TRUE if old command is redundant
+ */
+static boolean display_covered(const display_cmd_t *old, const display_cmd_t *cmd)
+{
+    int32_t o[4], n[4];
+
+    if ((old->type == DISPLAY_CMD_CHECK) || (cmd->type == DISPLAY_CMD_CHECK))
+    {
+        /* following commands depend on it */
+        return FALSE;
+    }
+    if ((old->type == DISPLAY_CMD_SCROLL) || (cmd->type == DISPLAY_CMD_SCROLL) ||
+        (old->type == DISPLAY_CMD_CALIBRATE) || (cmd->type == DISPLAY_CMD_CALIBRATE) ||
+        (old->type == DISPLAY_CMD_VERIFY) || (cmd->type == DISPLAY_CMD_VERIFY))
+    {
+        /* only last scroll start matters, calibration and test have no bounds */
+        return (old->type == cmd->type);
+    }
+    if (!display_screen_bounds(old, o))
+    {
+        /* draws nothing */
+        return TRUE;
+    }
+    return display_screen_bounds(cmd, n) && (n[0] <= o[0]) && (n[1] <= o[1]) &&
+           (n[2] >= o[2]) && (n[3] >= o[3]);
+}
+
+/**
+ * @brief add command to queue, dropping pending commands made redundant
+ * @param cmd - command
+ * @return errno - 0 (posted), EBUSY (queue is full)
+ *
+ * Caller holds queue lock.
+ */
+static uint16_t display_enqueue(const display_cmd_t *cmd)
+{
+    uint16_t n = 0;
+    uint16_t first = 0;
+
+    /* commands before check switch are checked other way */
+    for (uint16_t i = 0; i < display_count; i++)
+    {
+        if (display_queue[i].type == DISPLAY_CMD_CHECK)
+        {
+            first = (uint16_t)(i + 1);
+        }
+    }
+    for (uint16_t i = 0; i < display_count; i++)
+    {
+        if ((i >= first) && display_covered(&display_queue[i], cmd))
+        {
+            display_stats.coalesced++;
+        }
+        else
+        {
+            if (n != i)
+            {
+                display_queue[n] = display_queue[i];
+            }
+            n++;
+        }
+    }
+    display_count = n;
+    if (display_count >= DISPLAY_QUEUE_SIZE)
+    {
+        display_stats.rejected++;
+        return EBUSY;
+    }
+    display_queue[display_count++] = *cmd;
+    display_stats.posted++;
+    return 0;
+}
+
+/**
+ * @brief viewport of posts of calling task
+ * @param v - x0, y0, x1, y1 of viewport on screen on return
+ *
+ * Caller holds queue lock.
+ */
+static void display_view(uint16_t v[4])
+{
+    if (display_view_held && (display_view_task == DISPLAY_SELF()))
+    {
+        v[0] = display_view_x0;
+        v[1] = display_view_y0;
+        v[2] = display_view_x1;
+        v[3] = display_view_y1;
+        return;
+    }
+    v[0] = v[1] = 0;
+    v[2] = ST7789_WIDTH - 1;
+    v[3] = ST7789_HEIGHT - 1;
+}
+
+/**
+ * @brief post command from task and wake render task
+ * @param cmd - command, viewport of calling task is set to it
+ * @return errno - 0 (posted), EBUSY (queue is full)
+ */
+static uint16_t display_post(display_cmd_t *cmd)
+{
+    uint16_t v[4];
+    uint16_t res;
+
+    DISPLAY_LOCK();
+    display_view(v);
+    cmd->vx0 = v[0];
+    cmd->vy0 = v[1];
+    cmd->vx1 = v[2];
+    cmd->vy1 = v[3];
+    res = display_enqueue(cmd);
+    DISPLAY_UNLOCK();
+#ifndef UNITTEST
+    if ((res == 0) && (display_task != NULL))
+    {
+        xTaskNotify(display_task, DISPLAY_EVENT_POST, eSetBits);
+    }
+#endif
+    return res;
+}
+
+/**
+ * @brief post command from interrupt and wake render task
+ * @param cmd - command with bounds inside of screen, its viewport is ignored
+ * @return errno - 0 (posted), EBUSY (queue is full)
+ */
+uint16_t display_post_from_isr(const display_cmd_t *cmd)
+{
+    display_cmd_t c = *cmd;
+    UBaseType_t saved;
+    uint16_t res;
+
+    c.vx0 = c.vy0 = 0;
+    c.vx1 = ST7789_WIDTH - 1;
+    c.vy1 = ST7789_HEIGHT - 1;
+    DISPLAY_LOCK_FROM_ISR(saved);
+    res = display_enqueue(&c);
+    DISPLAY_UNLOCK_FROM_ISR(saved);
+#ifndef UNITTEST
+    if ((res == 0) && (display_task != NULL))
+    {
+        BaseType_t woken = pdFALSE;
+        xTaskNotifyFromISR(display_task, DISPLAY_EVENT_POST, eSetBits, &woken);
+        portYIELD_FROM_ISR(woken);
+    }
+#endif
+    return res;
+}
+
+/**
+ * @brief post filled rectangle
+ * @param x0, y0, x1, y1 - corners, inclusive, clipped to screen
+ * @param color - RGB565 color
+ * @return errno - 0 (posted), EBUSY (queue is full), EINVAL (outside of screen)
+ */
+uint16_t display_fill(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1,
+                      uint16_t color)
+{
+    display_cmd_t cmd;
+
+    if ((x0 > x1) || (y0 > y1) || (x0 >= ST7789_WIDTH) || (y0 >= ST7789_HEIGHT))
+    {
+        return EINVAL;
+    }
+    cmd.type = DISPLAY_CMD_FILL;
+    cmd.x0 = x0;
+    cmd.y0 = y0;
+    cmd.x1 = x1 < ST7789_WIDTH ? x1 : ST7789_WIDTH - 1;
+    cmd.y1 = y1 < ST7789_HEIGHT ? y1 : ST7789_HEIGHT - 1;
+    cmd.color = color;
+    return display_post(&cmd);
+}
+
+/**
+ * @brief post single line of text
+ * @param x, y - top left corner
+ * @param str - text, chars beyond DISPLAY_TEXT_LEN or screen are cut
+ * @param font - font, must live until drawn
+ * @param color, bgcolor - RGB565 colors
+ * @return errno - 0 (posted), EBUSY (queue is full), EINVAL (outside of screen)
+ */
+uint16_t display_text(uint16_t x, uint16_t y, const char *str, const FontDef *font,
+                      uint16_t color, uint16_t bgcolor)
+{
+    display_cmd_t cmd;
+    uint16_t end = x;
+    uint16_t len = 0;
+    uint16_t v[4];
+
+    DISPLAY_LOCK();
+    display_view(v);
+    DISPLAY_UNLOCK();
+    if (y + font->height > ST7789_HEIGHT)
+    {
+        return EINVAL;
+    }
+    while (str[len] && (len < DISPLAY_TEXT_LEN))
+    {
+        uint8_t w = Font_Advance(font, Font_Glyph(font, str[len]));
+        /* text is not wrapped, it stays inside of its bounds */
+        if (end + w > v[2] - v[0] + 1)
+        {
+            break;
+        }
+        cmd.text[len] = str[len];
+        end = (uint16_t)(end + w);
+        len++;
+    }
+    if (len == 0)
+    {
+        return EINVAL;
+    }
+    cmd.text[len] = 0;
+    cmd.type = DISPLAY_CMD_TEXT;
+    cmd.x0 = x;
+    cmd.y0 = y;
+    cmd.x1 = (uint16_t)(end - 1);
+    cmd.y1 = (uint16_t)(y + font->height - 1);
+    cmd.color = color;
+    cmd.bgcolor = bgcolor;
+    cmd.data = font;
+    return display_post(&cmd);
+}
+
+/**
+ * @brief post packed image
+ * @param x, y - top left corner, image must fit on screen
+ * @param img - image, must live until drawn
+ * @return errno - 0 (posted), EBUSY (queue is full), EINVAL (outside of screen)
+ */
+uint16_t display_image(uint16_t x, uint16_t y, const image_t *img)
+{
+    display_cmd_t cmd;
+
+    if ((img->width == 0) || (img->height == 0) ||
+        (x + img->width > ST7789_WIDTH) || (y + img->height > ST7789_HEIGHT))
+    {
+        return EINVAL;
+    }
+    cmd.type = DISPLAY_CMD_IMAGE;
+    cmd.x0 = x;
+    cmd.y0 = y;
+    cmd.x1 = (uint16_t)(x + img->width - 1);
+    cmd.y1 = (uint16_t)(y + img->height - 1);
+    cmd.data = img;
+    return display_post(&cmd);
+}
+
+/**
+ * @brief post scroll start, see {@link #ST7789_SetScrollStart}
+ * @param line - screen row shown at the top of scrolling area, not
+ *               relative to its top
+ * @return errno - 0 (posted), EBUSY (queue is full)
+ */
+uint16_t display_scroll(uint16_t line)
+{
+    display_cmd_t cmd;
+
+    cmd.type = DISPLAY_CMD_SCROLL;
+    cmd.x0 = cmd.y0 = cmd.x1 = cmd.y1 = 0;
+    cmd.color = line;
+    return display_post(&cmd);
+}
+
+/**
+ * @brief post spi clock calibration, see {@link #ST7789_Calibrate}
+ * @return errno - 0 (posted), EBUSY (queue is full)
+ *
+ * Screen is black after it, result is in {@link #display_link}.
+ */
+uint16_t display_calibrate(void)
+{
+    display_cmd_t cmd;
+
+    cmd.type = DISPLAY_CMD_CALIBRATE;
+    cmd.x0 = cmd.y0 = cmd.x1 = cmd.y1 = 0;
+    return display_post(&cmd);
+}
+
+/**
+ * @brief post display link test, see {@link #ST7789_Verify}
+ * @param rounds - screens to write and read back
+ * @return errno - 0 (posted), EBUSY (queue is full)
+ *
+ * Screen is black after it, counters are added to
+ * {@link #display_verify_result}.
+ */
+uint16_t display_verify(uint16_t rounds)
+{
+    display_cmd_t cmd;
+
+    cmd.type = DISPLAY_CMD_VERIFY;
+    cmd.x0 = cmd.y0 = cmd.x1 = cmd.y1 = 0;
+    cmd.color = rounds;
+    return display_post(&cmd);
+}
+
+/**
+ * @brief post switch of drawing check, see {@link #ST7789_CheckEnd}
+ * @param on - TRUE checks following fills, texts and images
+ * @return errno - 0 (posted), EBUSY (queue is full)
+ */
+uint16_t display_check(boolean on)
+{
+    display_cmd_t cmd;
+
+    cmd.type = DISPLAY_CMD_CHECK;
+    cmd.x0 = cmd.y0 = cmd.x1 = cmd.y1 = 0;
+    cmd.color = on ? 1 : 0;
+    return display_post(&cmd);
+}
+
+/**
+ * @brief set drawing origin and clip rectangle of following posts of
+ *        calling task, see {@link #ST7789_SetViewport}
+ * @param x, y - top left corner of viewport on screen
+ * @param w, h - size of viewport, cut to screen
+ * @return errno - 0 (ok), EINVAL (outside of screen), EBUSY (other
+ *         task holds viewport)
+ *
+ * Viewport is held by calling task until {@link #display_viewport_reset}.
+ */
+uint16_t display_viewport(uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+{
+    if ((w == 0) || (h == 0) || (x >= ST7789_WIDTH) || (y >= ST7789_HEIGHT))
+    {
+        return EINVAL;
+    }
+    DISPLAY_LOCK();
+    if (display_view_held && (display_view_task != DISPLAY_SELF()))
+    {
+        DISPLAY_UNLOCK();
+        return EBUSY;
+    }
+    display_view_x0 = x;
+    display_view_y0 = y;
+    display_view_x1 = (x + w < ST7789_WIDTH) ? (uint16_t)(x + w - 1) : ST7789_WIDTH - 1;
+    display_view_y1 = (y + h < ST7789_HEIGHT) ? (uint16_t)(y + h - 1) : ST7789_HEIGHT - 1;
+    display_view_held = TRUE;
+    display_view_task = DISPLAY_SELF();
+    DISPLAY_UNLOCK();
+    return 0;
+}
+
+/**
+ * @brief set viewport of following posts to whole screen
+ *
+ * Viewport held by other task is not touched.
+ */
+void display_viewport_reset(void)
+{
+    DISPLAY_LOCK();
+    if (display_view_task == DISPLAY_SELF())
+    {
+        display_view_held = FALSE;
+    }
+    DISPLAY_UNLOCK();
+}
+
+/**
+ * @brief calibrate spi clock of panel into {@link #display_link}
+ */
+static void display_link_calibrate(void)
+{
+    if (ST7789_Calibrate(&display_link) != 0)
+    {
+        display_link.baudrate = SPI_BAUDRATE_SLOWEST;
+        display_link.clock_hz = 0;
+        display_link.fill_rate = 0;
+    }
+}
+
+/**
+ * @brief count of pending commands
+ */
+uint16_t display_pending(void)
+{
+    return display_count;
+}
+
+/**
+ * @brief take oldest pending command
+ * @param cmd - destination
+ * @return TRUE if command is taken
+ */
+boolean display_take(display_cmd_t *cmd)
+{
+    DISPLAY_LOCK();
+    if (display_count == 0)
+    {
+        DISPLAY_UNLOCK();
+        return FALSE;
+    }
+    *cmd = display_queue[0];
+    display_count--;
+    for (uint16_t i = 0; i < display_count; i++)
+    {
+        display_queue[i] = display_queue[i + 1];
+    }
+    display_stats.drawn++;
+    DISPLAY_UNLOCK();
+    return TRUE;
+}
+
+/**
+ * @brief draw command on ST7789
+ * @param cmd - command
+ *
+ * Fill, text and image are drawn in viewport of command, ST7789 is
+ * left with viewport of whole screen.
+ */
+void display_execute(const display_cmd_t *cmd)
+{
+    boolean draw = (cmd->type == DISPLAY_CMD_FILL) || (cmd->type == DISPLAY_CMD_TEXT) ||
+                   (cmd->type == DISPLAY_CMD_IMAGE);
+    boolean check = display_checking && draw;
+
+    if (check)
+    {
+        ST7789_CheckStart();
+    }
+    if (draw)
+    {
+        ST7789_SetViewport(cmd->vx0, cmd->vy0, (uint16_t)(cmd->vx1 - cmd->vx0 + 1),
+                           (uint16_t)(cmd->vy1 - cmd->vy0 + 1));
+    }
+    switch (cmd->type)
+    {
+    case DISPLAY_CMD_FILL:
+        ST7789_Fill(cmd->x0, cmd->y0, cmd->x1, cmd->y1, cmd->color);
+        break;
+    case DISPLAY_CMD_TEXT:
+        ST7789_WriteString(cmd->x0, cmd->y0, cmd->text, *(const FontDef *)cmd->data,
+                           cmd->color, cmd->bgcolor);
+        break;
+    case DISPLAY_CMD_IMAGE:
+        ST7789_DrawPackedImage(cmd->x0, cmd->y0, (const image_t *)cmd->data);
+        break;
+    case DISPLAY_CMD_SCROLL:
+        ST7789_SetScrollStart(cmd->color);
+        break;
+    case DISPLAY_CMD_CALIBRATE:
+        display_link_calibrate();
+        break;
+    case DISPLAY_CMD_VERIFY:
+        (void)ST7789_Verify(&display_verify_result, cmd->color);
+        break;
+    case DISPLAY_CMD_CHECK:
+        display_checking = (cmd->color != 0);
+        break;
+    default:
+        break;
+    }
+    if (draw)
+    {
+        /* calibration, test and direct drawing are in screen coordinates */
+        ST7789_ResetViewport();
+    }
+    if (check)
+    {
+        (void)ST7789_CheckEnd(&display_check_result);
+    }
+}
+
+/**
+ * @brief set drawing synchronized with TE pulses
+ * @param fps - max frames per second, 0 - draw at once without sync
+ * @return errno - 0 (ok), EINVAL (fps above {@link #DISPLAY_PANEL_FPS})
+ *
+ * Frames are drawn on every n-th TE pulse, n is rounded up, so real
+ * frame rate never exceeds fps.
+ */
+uint16_t display_sync(uint8_t fps)
+{
+    if (fps > DISPLAY_PANEL_FPS)
+    {
+        return EINVAL;
+    }
+    DISPLAY_LOCK();
+    display_divider = fps ? (uint8_t)((DISPLAY_PANEL_FPS + fps - 1) / fps) : 0;
+    /* next TE pulse may start frame */
+    display_frame_te = display_stats.te - display_divider;
+    display_waiting = FALSE;
+    DISPLAY_UNLOCK();
+
+#ifndef UNITTEST
+    /* render task switches TE line of panel */
+    if (display_task != NULL)
+    {
+        xTaskNotify(display_task, DISPLAY_EVENT_POST, eSetBits);
+    }
+#endif
+    return 0;
+}
+
+/**
+ * @brief count TE pulse and wake render task, called from interrupt
+ *
+ * Task is woken only if something waits for drawing, idle screen
+ * costs nothing but counter increment.
+ */
+void display_te_irq(void)
+{
+    display_stats.te++;
+#ifndef UNITTEST
+    if ((display_task != NULL) && display_divider && display_count)
+    {
+        BaseType_t woken = pdFALSE;
+        xTaskNotifyFromISR(display_task, DISPLAY_EVENT_TE, eSetBits, &woken);
+        portYIELD_FROM_ISR(woken);
+    }
+#endif
+}
+
+/**
+ * @brief decide if pending commands are drawn now
+ * @param events - DISPLAY_EVENT_... bits, 0 at timeout of waiting
+ * @param now - current tick
+ * @return TRUE if frame is started and queue must be drained
+ *
+ * Without sync frame starts at once. With sync frame starts at TE pulse
+ * allowed by frame rate cap, or after {@link #DISPLAY_TE_TIMEOUT} ticks
+ * of waiting if TE line is silent.
+ */
+boolean display_frame_begin(uint32_t events, uint32_t now)
+{
+    if (display_count == 0)
+    {
+        display_waiting = FALSE;
+        return FALSE;
+    }
+    if (display_divider == 0)
+    {
+        return TRUE;
+    }
+    if ((events & DISPLAY_EVENT_TE) &&
+        (display_stats.te - display_frame_te >= display_divider))
+    {
+        display_stats.frames++;
+    }
+    else
+    {
+        if (!display_waiting)
+        {
+            display_waiting = TRUE;
+            display_wait_since = now;
+        }
+        if (now - display_wait_since < DISPLAY_TE_TIMEOUT)
+        {
+            return FALSE;
+        }
+        display_stats.unsynced++;
+    }
+    display_waiting = FALSE;
+    display_frame_te = display_stats.te;
+    return TRUE;
+}
+
+/**
+ * @brief end of frame started by {@link #display_frame_begin}
+ *
+ * Must be called after last pixel is sent.
+ */
+void display_frame_end(void)
+{
+    if (display_divider && (display_stats.te != display_frame_te))
+    {
+        /* panel scan has overtaken drawing */
+        display_stats.missed++;
+    }
+}
+
+#ifndef UNITTEST
+
+/**
+ * @addtogroup rtos
+ * @brief render task, draws posted commands
+ * @param args - no parameters used
+ */
+static void task_display(void *args __attribute((unused)))
+{
+    display_cmd_t cmd;
+    uint32_t events;
+    boolean tear = FALSE;
+
+    ST7789_Init();
+    display_link_calibrate();
+    for (;;)
+    {
+        /* wait for TE pulse only while something is pending */
+        TickType_t wait = (display_divider && display_count) ? DISPLAY_TE_TIMEOUT : portMAX_DELAY;
+        if (xTaskNotifyWait(0, UINT32_MAX, &events, wait) == pdFALSE)
+        {
+            events = 0;
+        }
+        if (tear != (display_divider != 0))
+        {
+            tear = !tear;
+            ST7789_TearEffect(tear);
+        }
+        if (!display_frame_begin(events, xTaskGetTickCount()))
+        {
+            continue;
+        }
+        while (display_take(&cmd))
+        {
+            display_execute(&cmd);
+        }
+        /* release panel until next command */
+        ST7789_WaitIdle();
+        display_frame_end();
+    }
+}
+
+/**
+ * @brief init ST7789 and start render task
+ */
+void display_start(void)
+{
+    display_init();
+    xTaskCreate(task_display, "display", DISPLAY_STACK, NULL, DISPLAY_PRIORITY,
+                &display_task);
+}
+
+#endif
+
+/** @}*/
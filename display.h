@@ -0,0 +1,295 @@
+/** @weakgroup hardware
+ *  @{
+ */
+/**
+ * @file display.h
+ * @brief queue of drawing commands and render task owning ST7789
+ *
+ * Copyright 2020 Stanislav V. Vlasov <stanislav.v.v@gmail.com>
+ *
+ * Producers post compact commands and return at once, render task
+ * takes them in order and draws. Posted command makes redundant every
+ * pending one which lies inside of its bounds (all commands draw
+ * opaque rectangles), so widget updates faster than spi are merged
+ * into the last one. Only render task may call st7789.c after
+ * {@link #display_start}.
+ *
+ * display_fill(), display_text() and other post functions take task
+ * critical section and notify render task, so they may be called from
+ * tasks only. Interrupt handlers, ex. of encoder, post prepared
+ * command by {@link #display_post_from_isr}.
+ *
+ * With {@link #display_sync} pending commands are drawn as one frame
+ * started by tearing effect (TE) pulse of panel, so drawing goes behind
+ * panel scan and does not tear. Frame which is not drawn before next
+ * TE pulse is counted as missed.
+ *
+ * Spi clock of panel is calibrated by render task at start and by
+ * {@link #display_calibrate}, result is in {@link #display_link}.
+ *
+ * Commands posted after {@link #display_viewport} take coordinates
+ * relative to its corner and are cut by it, so widget may be drawn in
+ * its local coordinates. Every command carries its viewport, so render
+ * task keeps no viewport between commands and pending commands are
+ * coalesced by their screen bounds. Viewport belongs to the task which
+ * set it, posts of other tasks and interrupts are in screen coordinates.
+ */
+
+#ifndef DISPLAY_H_
+#define DISPLAY_H_
+
+#include <stdint.h>
+#include "bool.h"
+#include "fonts.h"
+#include "image.h"
+#include "st7789.h"
+
+/**
+ * pending commands in queue
+ */
+#define DISPLAY_QUEUE_SIZE 16
+
+/**
+ * max chars of text command
+ */
+#define DISPLAY_TEXT_LEN 20
+
+/**
+ * render task stack in words and priority
+ * @{
+ */
+#define DISPLAY_STACK    200
+#define DISPLAY_PRIORITY 2
+/**
+ * @}
+ */
+
+/**
+ * panel frame rate, set by FRCTRL2 in {@link #ST7789_Init}
+ */
+#define DISPLAY_PANEL_FPS 60
+
+/**
+ * ticks to wait for TE pulse before drawing without it
+ */
+#define DISPLAY_TE_TIMEOUT 100
+
+/**
+ * events of render task, bits of task notification
+ * @{
+ */
+#define DISPLAY_EVENT_POST 1
+#define DISPLAY_EVENT_TE   2
+/**
+ * @}
+ */
+
+/**
+ * types of commands
+ * @{
+ */
+#define DISPLAY_CMD_FILL   1
+#define DISPLAY_CMD_TEXT   2
+#define DISPLAY_CMD_IMAGE  3
+#define DISPLAY_CMD_SCROLL 4
+#define DISPLAY_CMD_CALIBRATE 5
+#define DISPLAY_CMD_VERIFY 6
+#define DISPLAY_CMD_CHECK  7
+/**
+ * @}
+ */
+
+/**
+ * drawing command
+ */
+typedef struct //vera++ blamed for single space
+{
+    uint8_t type;             /** DISPLAY_CMD_... */
+    uint16_t x0, y0, x1, y1;  /** bounds in viewport coordinates, inclusive */
+    uint16_t vx0, vy0, vx1, vy1; /** viewport on screen, inclusive, origin at its corner */
+    uint16_t color;           /** fill and text color, scroll line, verify rounds, check on */
+    uint16_t bgcolor;         /** text background */
+    const void *data;         /** FontDef of text or image_t */
+    char text[DISPLAY_TEXT_LEN + 1];
+} display_cmd_t;
+
+/**
+ * queue counters
+ */
+typedef struct //vera++ blamed for single space
+{
+    uint32_t posted;          /** commands accepted */
+    uint32_t coalesced;       /** pending commands made redundant */
+    uint32_t rejected;        /** commands not posted, queue was full */
+    uint32_t drawn;           /** commands taken by render task */
+    uint32_t te;              /** TE pulses of panel */
+    uint32_t frames;          /** frames started by TE pulse */
+    uint32_t missed;          /** frames not finished before next TE pulse */
+    uint32_t unsynced;        /** frames drawn after TE timeout */
+} display_stats_t;
+
+extern display_stats_t display_stats;
+
+/**
+ * spi link to panel, clock_hz is 0 before calibration or if it failed
+ */
+extern st7789_link_t display_link;
+
+/**
+ * counters of display link tests posted by {@link #display_verify}
+ */
+extern st7789_verify_t display_verify_result;
+
+/**
+ * counters of drawing checks switched on by {@link #display_check}
+ */
+extern st7789_check_t display_check_result;
+
+/**
+ * @brief clean queue and counters
+ */
+void display_init(void);
+
+/**
+ * @brief post filled rectangle
+ * @param x0, y0, x1, y1 - corners, inclusive, clipped to screen
+ * @param color - RGB565 color
+ * @return errno - 0 (posted), EBUSY (queue is full), EINVAL (outside of screen)
+ */
+uint16_t display_fill(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1,
+                      uint16_t color);
+
+/**
+ * @brief post single line of text
+ * @param x, y - top left corner
+ * @param str - text, chars beyond DISPLAY_TEXT_LEN or screen are cut
+ * @param font - font, must live until drawn
+ * @param color, bgcolor - RGB565 colors
+ * @return errno - 0 (posted), EBUSY (queue is full), EINVAL (outside of screen)
+ */
+uint16_t display_text(uint16_t x, uint16_t y, const char *str, const FontDef *font,
+                      uint16_t color, uint16_t bgcolor);
+
+/**
+ * @brief post packed image
+ * @param x, y - top left corner, image must fit on screen
+ * @param img - image, must live until drawn
+ * @return errno - 0 (posted), EBUSY (queue is full), EINVAL (outside of screen)
+ */
+uint16_t display_image(uint16_t x, uint16_t y, const image_t *img);
+
+/**
+ * @brief post scroll start, see {@link #ST7789_SetScrollStart}
+ * @param line - screen row shown at the top of scrolling area, not
+ *               relative to its top
+ * @return errno - 0 (posted), EBUSY (queue is full)
+ */
+uint16_t display_scroll(uint16_t line);
+
+/**
+ * @brief post spi clock calibration, see {@link #ST7789_Calibrate}
+ * @return errno - 0 (posted), EBUSY (queue is full)
+ *
+ * Screen is black after it, result is in {@link #display_link}.
+ */
+uint16_t display_calibrate(void);
+
+/**
+ * @brief post display link test, see {@link #ST7789_Verify}
+ * @param rounds - screens to write and read back
+ * @return errno - 0 (posted), EBUSY (queue is full)
+ *
+ * Screen is black after it, counters are added to
+ * {@link #display_verify_result}.
+ */
+uint16_t display_verify(uint16_t rounds);
+
+/**
+ * @brief post switch of drawing check, see {@link #ST7789_CheckEnd}
+ * @param on - TRUE checks following fills, texts and images
+ * @return errno - 0 (posted), EBUSY (queue is full)
+ *
+ * Every checked command is read back after drawing and CRC of its
+ * window is compared with CRC of sent pixels, counters are added to
+ * {@link #display_check_result}. Commands are never coalesced across
+ * check switch.
+ */
+uint16_t display_check(boolean on);
+
+/**
+ * @brief set drawing origin and clip rectangle of following posts of
+ *        calling task, see {@link #ST7789_SetViewport}
+ * @param x, y - top left corner of viewport on screen
+ * @param w, h - size of viewport, cut to screen
+ * @return errno - 0 (ok), EINVAL (outside of screen)
+ */
+uint16_t display_viewport(uint16_t x, uint16_t y, uint16_t w, uint16_t h);
+
+/**
+ * @brief set viewport of following posts to whole screen
+ */
+void display_viewport_reset(void);
+
+/**
+ * @brief post command from interrupt and wake render task
+ * @param cmd - command with bounds inside of screen, text and image
+ *              data must live until drawn
+ * @return errno - 0 (posted), EBUSY (queue is full)
+ *
+ * Command is drawn in screen coordinates, its viewport is ignored.
+ * Pending commands are coalesced as by task posts. Interrupt priority
+ * must be {@link #IRQ_PRIORITY_RTOS} or lower.
+ */
+uint16_t display_post_from_isr(const display_cmd_t *cmd);
+
+/**
+ * @brief count of pending commands
+ */
+uint16_t display_pending(void);
+
+/**
+ * @brief take oldest pending command
+ * @param cmd - destination
+ * @return TRUE if command is taken
+ */
+boolean display_take(display_cmd_t *cmd);
+
+/**
+ * @brief draw command on ST7789
+ * @param cmd - command
+ */
+void display_execute(const display_cmd_t *cmd);
+
+/**
+ * @brief set drawing synchronized with TE pulses
+ * @param fps - max frames per second, 0 - draw at once without sync
+ * @return errno - 0 (ok), EINVAL (fps above {@link #DISPLAY_PANEL_FPS})
+ */
+uint16_t display_sync(uint8_t fps);
+
+/**
+ * @brief count TE pulse and wake render task, called from interrupt
+ */
+void display_te_irq(void);
+
+/**
+ * @brief decide if pending commands are drawn now
+ * @param events - DISPLAY_EVENT_... bits, 0 at timeout of waiting
+ * @param now - current tick
+ * @return TRUE if frame is started and queue must be drained
+ */
+boolean display_frame_begin(uint32_t events, uint32_t now);
+
+/**
+ * @brief end of frame started by {@link #display_frame_begin}
+ */
+void display_frame_end(void);
+
+/**
+ * @brief init ST7789 and start render task
+ */
+void display_start(void);
+
+#endif
+
+/** @}*/
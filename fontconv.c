@@ -0,0 +1,354 @@
+/** @weakgroup tools
+ *  @{
+ */
+/**
+ * @file fontconv.c
+ * @brief font compiler, packs fonts_raw.c into FontDef format of fonts.h
+ *
+ * Copyright 2020 Stanislav V. Vlasov <stanislav.v.v@gmail.com>
+ *
+ * Runs on build host, C source of packed fonts is written to stdout.
+ * Blank columns around every glyph are cut off, so row of 1bpp glyph
+ * takes 1 or 2 whole bytes and is read by index of cell row, without
+ * shifts or range checks. Blank rows above and below of glyph are
+ * shared with its neighbours, so punctuation takes a few bytes.
+ * Anti-aliased fonts are cut at all sides and stored as bit stream.
+ *
+ * Anti-aliased variants are made from the same bitmaps: glyph is
+ * scaled up by Scale2x, which rounds stair steps of diagonals, 2x for
+ * 2bpp and 4x (two passes) for 4bpp, and coverage of every 2x2 or 4x4
+ * block is stored as level. Scale2x changes at most one subpixel of
+ * every pixel, so levels from half up give original bitmap back.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "fonts.h"
+#include "fonts_raw.h"
+
+/**
+ * font to convert
+ */
+typedef struct //vera++ blamed for single space
+{
+    const char *name;       /** name of raw table */
+    const char *def;        /** name of FontDef */
+    const uint16_t *raw;
+    uint8_t width;
+    uint8_t height;
+    uint8_t bpp;            /** bits per pixel: 1, 2 or 4 */
+} fontconv_src_t;
+
+static const fontconv_src_t fontconv_list[] =
+{
+    {"Font7x10", "Font_7x10", Font7x10, 7, 10, 1},
+    {"Font11x18", "Font_11x18", Font11x18, 11, 18, 1},
+    {"Font16x26", "Font_16x26", Font16x26, 16, 26, 1},
+    {"Font11x18a", "Font_11x18a", Font11x18, 11, 18, 2},
+    {"Font16x26a", "Font_16x26a", Font16x26, 16, 26, 4},
+};
+
+
+#define FONTCONV_FIRST ' '
+#define FONTCONV_COUNT ('~' - ' ' + 1)
+
+/**
+ * @brief pixel of glyph, outside of cell is blank
+ * @param rows - glyph rows, MSB is the left pixel
+ * @param src - font
+ * @param r, c - row and column
+ * @return 1 if pixel is set
+ */
+static int fontconv_pixel(const uint16_t *rows, const fontconv_src_t *src, int r, int c)
+{
+    if ((r < 0) || (r >= src->height) || (c < 0) || (c >= src->width))
+    {
+        return 0;
+    }
+    return (rows[r] >> (15 - c)) & 1;
+}
+
+/**
+ * @brief Scale2x of 3x3 pixels around e
+ * @param b, d, e, f, h - pixels above, left, center, right and below
+ * @param q - quarter of e: 0 top left, 1 top right, 2 bottom left, 3 bottom right
+ * @return subpixel
+ */
+static int fontconv_scale2x(int b, int d, int e, int f, int h, int q)
+{
+    switch (q)
+    {
+    case 0:
+        return ((d == b) && (b != f) && (d != h)) ? d : e;
+    case 1:
+        return ((b == f) && (b != d) && (f != h)) ? f : e;
+    case 2:
+        return ((d == h) && (d != b) && (h != f)) ? d : e;
+    default:
+        return ((h == f) && (d != h) && (b != f)) ? f : e;
+    }
+}
+
+/**
+ * @brief pixel of glyph scaled up 2x, outside of cell is blank
+ * @param rows - glyph rows, MSB is the left pixel
+ * @param src - font
+ * @param r, c - row and column of 2x bitmap
+ * @return 1 if subpixel is set
+ */
+static int fontconv_pixel2x(const uint16_t *rows, const fontconv_src_t *src, int r, int c)
+{
+    int y = r >> 1, x = c >> 1;
+
+    if ((r < 0) || (c < 0))
+    {
+        return 0;
+    }
+    return fontconv_scale2x(fontconv_pixel(rows, src, y - 1, x),
+                            fontconv_pixel(rows, src, y, x - 1),
+                            fontconv_pixel(rows, src, y, x),
+                            fontconv_pixel(rows, src, y, x + 1),
+                            fontconv_pixel(rows, src, y + 1, x),
+                            ((r & 1) << 1) | (c & 1));
+}
+
+/**
+ * @brief pixel of glyph scaled up 4x by Scale2x done twice
+ * @param rows - glyph rows, MSB is the left pixel
+ * @param src - font
+ * @param r, c - row and column of 4x bitmap, not negative
+ * @return 1 if subpixel is set
+ */
+static int fontconv_pixel4x(const uint16_t *rows, const fontconv_src_t *src, int r, int c)
+{
+    int y = r >> 1, x = c >> 1;
+
+    return fontconv_scale2x(fontconv_pixel2x(rows, src, y - 1, x),
+                            fontconv_pixel2x(rows, src, y, x - 1),
+                            fontconv_pixel2x(rows, src, y, x),
+                            fontconv_pixel2x(rows, src, y, x + 1),
+                            fontconv_pixel2x(rows, src, y + 1, x),
+                            ((r & 1) << 1) | (c & 1));
+}
+
+/**
+ * @brief level of pixel in font of src->bpp bits
+ * @param rows - glyph rows, MSB is the left pixel
+ * @param src - font
+ * @param r, c - row and column
+ * @return 0..2^bpp-1, 1 for set pixel of 1bpp font
+ *
+ * 2bpp level is coverage of 2x2 Scale2x subpixels, 4bpp one is of 4x4
+ * subpixels of Scale2x done twice. Every pass changes at most one
+ * subpixel of every pixel, so set pixel covers at least 9/16 and
+ * clear one at most 7/16.
+ */
+static int fontconv_level(const uint16_t *rows, const fontconv_src_t *src, int r, int c)
+{
+    int max = (1 << src->bpp) - 1;
+    int cover = 0;
+
+    if (src->bpp == 1)
+    {
+        return fontconv_pixel(rows, src, r, c);
+    }
+    if (src->bpp == 2)
+    {
+        for (int q = 0; q < 4; q++)
+        {
+            cover += fontconv_pixel2x(rows, src, r * 2 + (q >> 1), c * 2 + (q & 1));
+        }
+        return (cover * max + 2) / 4;
+    }
+    for (int q = 0; q < 16; q++)
+    {
+        cover += fontconv_pixel4x(rows, src, r * 4 + (q >> 2), c * 4 + (q & 3));
+    }
+    return (cover * max + 8) / 16;
+}
+
+/**
+ * @brief find bitmap box of glyph
+ * @param rows - glyph rows, MSB is the left pixel
+ * @param src - font
+ * @param g - destination, offset is not set
+ */
+static void fontconv_box(const uint16_t *rows, const fontconv_src_t *src, FontGlyph *g)
+{
+    uint16_t mask = (uint16_t)(0xffff << (16 - src->width));
+    uint16_t all = 0;
+    int top = -1, bottom = -1;
+
+    for (int r = 0; r < src->height; r++)
+    {
+        uint16_t b = 0;
+        for (int c = 0; c < src->width; c++)
+        {
+            if (fontconv_level(rows, src, r, c))
+            {
+                b |= (uint16_t)(0x8000 >> c);
+            }
+        }
+        b &= mask;
+        if (b)
+        {
+            if (top < 0)
+            {
+                top = r;
+            }
+            bottom = r;
+            all |= b;
+        }
+    }
+    if (top < 0)
+    {
+        g->left = g->top = g->cols = g->rows = 0;
+        return;
+    }
+    int left = 0, right = 15;
+    while (!(all & (0x8000 >> left)))
+    {
+        left++;
+    }
+    while (!(all & (0x8000 >> right)))
+    {
+        right--;
+    }
+    g->left = (uint8_t)left;
+    g->top = (uint8_t)top;
+    g->cols = (uint8_t)(right - left + 1);
+    g->rows = (uint8_t)(bottom - top + 1);
+}
+
+/**
+ * @brief pack and print one font
+ * @param src - font
+ * @return size of packed font in bytes
+ */
+static unsigned fontconv_font(const fontconv_src_t *src)
+{
+    static uint8_t data[65536];
+    FontGlyph glyphs[FONTCONV_COUNT];
+    uint8_t widths[FONTCONV_COUNT];
+    uint32_t size = 0;
+    uint32_t blank = 0;
+
+    memset(data, 0, sizeof(data));
+    for (int i = 0; i < FONTCONV_COUNT; i++)
+    {
+        const uint16_t *rows = &src->raw[i * src->height];
+        FontGlyph *g = &glyphs[i];
+        uint32_t bit = 0;
+
+        fontconv_box(rows, src, g);
+        if (src->bpp == 1)
+        {
+            /*
+             * 1bpp: whole cell rows of 1 or 2 bytes, offset is of cell
+             * row 0. Blank rows above and below of bitmap are zero
+             * bytes shared with neighbour glyphs.
+             */
+            uint32_t stride = (g->cols > 8) ? 2 : 1;
+            uint32_t above = g->top * stride;
+            uint32_t start = size + (blank > above ? blank : above);
+            g->offset = (uint16_t)(start - above);
+            for (int r = g->top; r < g->top + g->rows; r++)
+            {
+                uint16_t b = 0;
+                for (int c = g->left; c < g->left + g->cols; c++)
+                {
+                    b |= (uint16_t)(fontconv_level(rows, src, r, c) << (15 - (c - g->left)));
+                }
+                data[g->offset + r * stride] = (uint8_t)(b >> 8);
+                if (stride == 2)
+                {
+                    data[g->offset + r * stride + 1] = (uint8_t)b;
+                }
+            }
+            if (g->rows)
+            {
+                size = g->offset + (g->top + g->rows) * stride;
+                blank = (src->height - g->top - g->rows) * stride;
+            }
+            else
+            {
+                /* empty glyph takes zeros behind previous one */
+                g->offset = (uint16_t)size;
+                blank = blank > src->height ? blank : src->height;
+            }
+        }
+        else
+        {
+            g->offset = (uint16_t)size;
+            for (int r = g->top; r < g->top + g->rows; r++)
+            {
+                for (int c = g->left; c < g->left + g->cols; c++)
+                {
+                    int level = fontconv_level(rows, src, r, c);
+                    data[size + (bit >> 3)] |= (uint8_t)(level << (8 - src->bpp - (bit & 7)));
+                    bit += src->bpp;
+                }
+            }
+            size += (bit + 7) >> 3;
+        }
+
+        /* proportional: bitmap and one blank column, space is half of cell */
+        widths[i] = g->cols ? (uint8_t)(g->cols + 1) : (uint8_t)(src->width / 2);
+        if (widths[i] > src->width)
+        {
+            widths[i] = src->width;
+        }
+    }
+    /* blank rows of last glyph, anti-aliased row renderer may read ahead */
+    size += blank + 2;
+
+    printf("\nstatic const uint8_t %s_data[%u] =\n{", src->name, size);
+    for (uint32_t i = 0; i < size; i++)
+    {
+        printf("%s0x%02x,", (i % 16) ? " " : "\n    ", data[i]);
+    }
+    printf("\n};\n");
+
+    printf("\nstatic const FontGlyph %s_glyphs[%d] =\n{\n", src->name, FONTCONV_COUNT);
+    for (int i = 0; i < FONTCONV_COUNT; i++)
+    {
+        const FontGlyph *g = &glyphs[i];
+        printf("    {%u, %u, %u, %u, %u}, /* %c */\n", g->offset, g->left, g->top,
+               g->cols, g->rows, i + FONTCONV_FIRST);
+    }
+    printf("};\n");
+
+    printf("\nstatic const uint8_t %s_widths[%d] =\n{", src->name, FONTCONV_COUNT);
+    for (int i = 0; i < FONTCONV_COUNT; i++)
+    {
+        printf("%s%u,", (i % 16) ? " " : "\n    ", widths[i]);
+    }
+    printf("\n};\n");
+
+    printf("\nFontDef %s = {%u, %u, %u, %u, %s_glyphs, NULL, %s_data, %u};\n",
+           src->def, src->width, src->height, FONTCONV_FIRST, FONTCONV_COUNT,
+           src->name, src->name, src->bpp);
+    printf("FontDef %sp = {%u, %u, %u, %u, %s_glyphs, %s_widths, %s_data, %u};\n",
+           src->def, src->width, src->height, FONTCONV_FIRST, FONTCONV_COUNT,
+           src->name, src->name, src->name, src->bpp);
+
+    return (unsigned)(size + sizeof(glyphs));
+}
+
+int main(void)
+{
+    printf("/* packed fonts, made by fontconv from fonts_raw.c, do not edit */\n");
+    printf("#include \"fonts.h\"\n");
+    for (unsigned i = 0; i < sizeof(fontconv_list) / sizeof(fontconv_list[0]); i++)
+    {
+        const fontconv_src_t *src = &fontconv_list[i];
+        unsigned packed = fontconv_font(src);
+        fprintf(stderr, "%-10s %5u bytes, packed %5u bytes\n", src->name,
+                (unsigned)(FONTCONV_COUNT * src->height * sizeof(uint16_t) * src->bpp),
+                packed);
+    }
+    return 0;
+}
+
+/** @}*/
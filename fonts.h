@@ -8,35 +8,135 @@
 #ifndef FONT_H_
 #define FONT_H_
 
-#include "stdint.h"
+#include <stddef.h>
+#include <stdint.h>
 
+/**
+ * placement of glyph bitmap in font cell, blank columns around of
+ * bitmap are not stored
+ */
+typedef struct //vera++ blamed for single space
+{
+    uint16_t offset;   /** first byte of cell row 0 (1bpp) or bitmap in FontDef data */
+    uint8_t left;      /** blank columns at the left */
+    uint8_t top;       /** blank rows at the top */
+    uint8_t cols;      /** columns of bitmap */
+    uint8_t rows;      /** rows of bitmap */
+} FontGlyph;
+
+/**
+ * packed font, pixels are MSB first. 1bpp glyph has all rows of cell,
+ * 1 byte each up to 8 cols, else 2 bytes, blank rows are shared with
+ * neighbour glyphs. Bitmap of anti-aliased glyph is a bit stream of
+ * rows inside of its box, pixel is level of bpp bits, 0 - background,
+ * 2^bpp-1 - text color.
+ */
 typedef struct //vera++ blamed for single space
 {
-    const uint8_t width;
-    uint8_t height;
-    const uint16_t *data;
+    uint8_t width;            /** cell width */
+    uint8_t height;           /** cell height */
+    uint8_t first;            /** code of first glyph */
+    uint8_t count;            /** count of glyphs */
+    const FontGlyph *glyphs;
+    const uint8_t *widths;    /** advance of every glyph, NULL for monospace */
+    const uint8_t *data;      /** bitmaps, followed by 2 padding bytes */
+    uint8_t bpp;              /** bits per pixel: 1, 2 or 4 */
 } FontDef;
 
+/**
+ * @brief Find glyph of char
+ * @param font -> font
+ * @param ch -> char, chars without glyph are shown as first glyph
+ * @return glyph
+ */
+static inline const FontGlyph *Font_Glyph(const FontDef *font, char ch)
+{
+    uint8_t i = (uint8_t)((uint8_t)ch - font->first);
+    return &font->glyphs[i < font->count ? i : 0];
+}
+
+/**
+ * @brief Width of glyph with spacing
+ * @param font -> font
+ * @param glyph -> glyph from {@link #Font_Glyph}
+ * @return columns from this glyph to next one
+ */
+static inline uint8_t Font_Advance(const FontDef *font, const FontGlyph *glyph)
+{
+    return font->widths ? font->widths[glyph - font->glyphs] : font->width;
+}
+
+/**
+ * @brief Get pixel level of anti-aliased glyph
+ * @param font -> font
+ * @param glyph -> glyph from {@link #Font_Glyph}
+ * @param r -> row of glyph bitmap, less than glyph->rows
+ * @param c -> column of glyph bitmap, less than glyph->cols
+ * @return level 0..2^bpp-1
+ */
+static inline uint8_t Font_Level(const FontDef *font, const FontGlyph *glyph,
+                                 uint16_t r, uint8_t c)
+{
+    uint32_t bit = ((uint32_t)r * glyph->cols + c) * font->bpp;
+    uint8_t b = font->data[glyph->offset + (bit >> 3)];
+    return (uint8_t)((b >> (8 - font->bpp - (bit & 7))) & ((1 << font->bpp) - 1));
+}
+
+/**
+ * @brief Get row of glyph
+ * @param font -> font
+ * @param glyph -> glyph from {@link #Font_Glyph}
+ * @param row -> row in font cell, less than font height
+ * @return row bits, MSB is the left pixel of cell (of advance
+ *         for proportional font)
+ *
+ * Row of 1bpp font is taken by index, so text may be rendered row by
+ * row over many glyphs as fast as from plain table. Pixels of
+ * anti-aliased font are set from half of max level, as they are in
+ * its 1bpp source.
+ */
+static inline uint16_t Font_Row(const FontDef *font, const FontGlyph *glyph,
+                                uint16_t row)
+{
+    const uint8_t *p = &font->data[glyph->offset];
+    uint16_t bits = 0;
+
+    if (font->bpp == 1)
+    {
+        if (glyph->cols <= 8)
+        {
+            return (uint16_t)((p[row] << 8) >> (font->widths ? 0 : glyph->left));
+        }
+        p += row * 2;
+        return (uint16_t)(((p[0] << 8) | p[1]) >> (font->widths ? 0 : glyph->left));
+    }
+    if ((uint16_t)(row - glyph->top) < glyph->rows)
+    {
+        uint8_t half = (uint8_t)(1 << (font->bpp - 1));
+        for (uint8_t c = 0; c < glyph->cols; c++)
+        {
+            if (Font_Level(font, glyph, (uint16_t)(row - glyph->top), c) >= half)
+            {
+                bits |= (uint16_t)(0x8000U >> c);
+            }
+        }
+    }
+    return font->widths ? bits : (uint16_t)(bits >> glyph->left);
+}
+
 //Font lib.
 extern FontDef Font_7x10;
 extern FontDef Font_11x18;
 extern FontDef Font_16x26;
 
-//16-bit(RGB565) Image lib.
-/*******************************************
- *             CAUTION:
- *   If the MCU onchip flash cannot
- *  store such huge image data,please
- *           do not use it.
- * These pics are for test purpose only.
- *******************************************/
-
-/* 128x128 pixel RGB565 image */
-extern const uint16_t saber[][128];
-
-/* 240x240 pixel RGB565 image
-extern const uint16_t knky[][240];
-extern const uint16_t tek[][240];
-extern const uint16_t adi1[][240];
-*/
+//proportional variants, glyphs are shared with fonts above
+extern FontDef Font_7x10p;
+extern FontDef Font_11x18p;
+extern FontDef Font_16x26p;
+//anti-aliased variants: 2bpp and 4bpp
+extern FontDef Font_11x18a;
+extern FontDef Font_16x26a;
+extern FontDef Font_11x18ap;
+extern FontDef Font_16x26ap;
+
 #endif
@@ -0,0 +1,24 @@
+/**
+ * @file fonts_raw.h
+ * @brief source bitmaps of fonts for font compiler
+ *
+ * Copyright https://github.com/Floyd-Fish/ST7789-STM32
+ *
+ */
+#ifndef FONTS_RAW_H_
+#define FONTS_RAW_H_
+
+#include <stdint.h>
+
+/**
+ * glyphs of chars ' '..'~', height rows of uint16_t per glyph
+ * @{
+ */
+extern const uint16_t Font7x10[];
+extern const uint16_t Font11x18[];
+extern const uint16_t Font16x26[];
+/**
+ * @}
+ */
+
+#endif
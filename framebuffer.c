@@ -0,0 +1,423 @@
+/** @weakgroup hardware
+ *  @{
+ */
+/**
+ * @file framebuffer.c
+ * @brief partial update framebuffer with dirty rectangles for ST7789
+ *
+ * Copyright 2020 Stanislav V. Vlasov <stanislav.v.v@gmail.com>
+ */
+
+#include <stdint.h>
+#include "bool.h"
+#include "st7789.h"
+#include "framebuffer.h"
+
+/**
+ * 4bpp shadow of screen region, even pixel in high nibble
+ */
+static uint8_t fb_shadow[FB_HEIGHT][FB_WIDTH / 2];
+
+/**
+ * palette, RGB565
+ */
+static uint16_t fb_palette[FB_COLORS];
+
+/**
+ * dirty rectangles list
+ * @{
+ */
+static fb_rect_t fb_dirty[FB_MAX_DIRTY];
+static uint16_t fb_dirty_n = 0;
+/**
+ * @}
+ */
+
+/**
+ * bounding box of pixels changed by current drawing function
+ * @{
+ */
+static fb_rect_t fb_changed;
+static boolean fb_changed_any = FALSE;
+/**
+ * @}
+ */
+
+/**
+ * two RGB565 pixel rows, one is filled while other is sent
+ */
+static uint16_t fb_row[2][FB_WIDTH];
+
+/**
+ * @brief area of rectangle
+ * @param r - rectangle
+ * @return area in pixels
+ */
+static uint32_t fb_rect_area(const fb_rect_t *r)
+{
+    return (uint32_t)(r->x1 - r->x0 + 1) * (uint32_t)(r->y1 - r->y0 + 1);
+}
+
+/**
+ * @brief union of two rectangles
+ * @param a, b - rectangles
+ * @return bounding rectangle of both
+ */
+static fb_rect_t fb_rect_union(const fb_rect_t *a, const fb_rect_t *b)
+{
+    fb_rect_t r;
+    r.x0 = a->x0 < b->x0 ? a->x0 : b->x0;
+    r.y0 = a->y0 < b->y0 ? a->y0 : b->y0;
+    r.x1 = a->x1 > b->x1 ? a->x1 : b->x1;
+    r.y1 = a->y1 > b->y1 ? a->y1 : b->y1;
+    return r;
+}
+
+/**
+ * @brief check that rectangles intersect
+ * @param a, b - rectangles
+ * @return TRUE if rectangles have common pixels
+ */
+static boolean fb_rect_overlap(const fb_rect_t *a, const fb_rect_t *b)
+{
+    return (a->x0 <= b->x1) && (b->x0 <= a->x1) &&
+           (a->y0 <= b->y1) && (b->y0 <= a->y1);
+}
+
+/**
+ * @brief check that rectangles are better sent as one
+ * @param a, b - rectangles
+ * @return TRUE if rectangles overlap or union adds few pixels
+ */
+static boolean fb_rect_should_merge(const fb_rect_t *a, const fb_rect_t *b)
+{
+    if (fb_rect_overlap(a, b))
+    {
+        return TRUE;
+    }
+    fb_rect_t u = fb_rect_union(a, b);
+    return fb_rect_area(&u) <= fb_rect_area(a) + fb_rect_area(b) + FB_MERGE_SLACK;
+}
+
+/**
+ * @brief remove rectangle from dirty list
+ * @param i - rectangle number
+ */
+static void fb_dirty_remove(uint16_t i)
+{
+    fb_dirty_n--;
+    fb_dirty[i] = fb_dirty[fb_dirty_n];
+}
+
+/**
+ * @brief add rectangle to dirty list with merging
+ * @param r - rectangle inside of framebuffer
+ */
+static void fb_add_dirty(fb_rect_t r)
+{
+    uint16_t i = 0;
+
+    /* union may touch rectangles checked before, so restart after merge */
+    while (i < fb_dirty_n)
+    {
+        if (fb_rect_should_merge(&fb_dirty[i], &r))
+        {
+            r = fb_rect_union(&fb_dirty[i], &r);
+            fb_dirty_remove(i);
+            i = 0;
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    if (fb_dirty_n == FB_MAX_DIRTY)
+    {
+        /* no place - merge with rectangle which grows least */
+        uint16_t best = 0;
+        uint32_t best_growth = UINT32_MAX;
+        for (i = 0; i < fb_dirty_n; i++)
+        {
+            fb_rect_t u = fb_rect_union(&fb_dirty[i], &r);
+            uint32_t growth = fb_rect_area(&u) - fb_rect_area(&fb_dirty[i]);
+            if (growth < best_growth)
+            {
+                best = i;
+                best_growth = growth;
+            }
+        }
+        r = fb_rect_union(&fb_dirty[best], &r);
+        fb_dirty_remove(best);
+        fb_add_dirty(r);
+        return;
+    }
+    fb_dirty[fb_dirty_n++] = r;
+}
+
+/**
+ * @brief start collecting changed pixels for drawing function
+ */
+static void fb_begin(void)
+{
+    fb_changed_any = FALSE;
+}
+
+/**
+ * @brief add changed pixels of drawing function to dirty list
+ */
+static void fb_end(void)
+{
+    if (fb_changed_any)
+    {
+        fb_add_dirty(fb_changed);
+    }
+}
+
+/**
+ * @brief check that point is inside of framebuffer
+ * @param x, y - screen coordinates
+ * @return TRUE if inside
+ */
+static inline boolean fb_inside(uint16_t x, uint16_t y)
+{
+    /* relative to origin and signed, origin may be 0 */
+    int32_t fx = (int32_t)x - FB_X;
+    int32_t fy = (int32_t)y - FB_Y;
+    return (fx >= 0) && (fx < FB_WIDTH) && (fy >= 0) && (fy < FB_HEIGHT);
+}
+
+/**
+ * @brief set pixel and remember it if changed
+ * @param x, y - screen coordinates inside of framebuffer
+ * @param color - palette index
+ */
+static inline void fb_put(uint16_t x, uint16_t y, uint8_t color)
+{
+    uint16_t fx = (uint16_t)(x - FB_X);
+    uint8_t *p = &fb_shadow[y - FB_Y][fx >> 1];
+    uint8_t shift = (fx & 1) ? 0 : 4;
+
+    if (((*p >> shift) & 0x0f) == color)
+    {
+        return;
+    }
+    *p = (uint8_t)((*p & ~(0x0f << shift)) | ((color & 0x0f) << shift));
+
+    if (!fb_changed_any)
+    {
+        fb_changed.x0 = fb_changed.x1 = x;
+        fb_changed.y0 = fb_changed.y1 = y;
+        fb_changed_any = TRUE;
+        return;
+    }
+    if (x < fb_changed.x0) { fb_changed.x0 = x; }
+    if (x > fb_changed.x1) { fb_changed.x1 = x; }
+    if (y < fb_changed.y0) { fb_changed.y0 = y; }
+    if (y > fb_changed.y1) { fb_changed.y1 = y; }
+}
+
+/**
+ * @brief init palette and fill framebuffer with color
+ * @param color - palette index
+ *
+ * Whole framebuffer is dirty after init.
+ */
+void fb_init(uint8_t color)
+{
+    static const uint16_t palette[FB_COLORS] =
+    {
+        BLACK, WHITE, RED, GREEN, BLUE, YELLOW, CYAN, MAGENTA,
+        GRAY, LGRAY, BROWN, DARKBLUE, LIGHTBLUE, GRAYBLUE, BRRED, LIGHTGREEN
+    };
+    uint8_t fill = (uint8_t)(((color & 0x0f) << 4) | (color & 0x0f));
+
+    for (uint8_t i = 0; i < FB_COLORS; i++)
+    {
+        fb_palette[i] = palette[i];
+    }
+    for (uint16_t y = 0; y < FB_HEIGHT; y++)
+    {
+        for (uint16_t x = 0; x < FB_WIDTH / 2; x++)
+        {
+            fb_shadow[y][x] = fill;
+        }
+    }
+    fb_dirty_n = 0;
+    fb_mark_dirty(FB_X, FB_Y, FB_X + FB_WIDTH - 1, FB_Y + FB_HEIGHT - 1);
+}
+
+/**
+ * @brief set palette entry
+ * @param index - palette index
+ * @param color - RGB565 color
+ *
+ * Pixels with this index may be anywhere, so whole framebuffer is dirty.
+ */
+void fb_set_palette(uint8_t index, uint16_t color)
+{
+    if ((index < FB_COLORS) && (fb_palette[index] != color))
+    {
+        fb_palette[index] = color;
+        fb_mark_dirty(FB_X, FB_Y, FB_X + FB_WIDTH - 1, FB_Y + FB_HEIGHT - 1);
+    }
+}
+
+/**
+ * @brief get pixel from framebuffer
+ * @param x, y - screen coordinates inside of framebuffer
+ * @return palette index
+ */
+uint8_t fb_get_pixel(uint16_t x, uint16_t y)
+{
+    uint16_t fx = (uint16_t)(x - FB_X);
+    uint8_t b = fb_shadow[y - FB_Y][fx >> 1];
+    return (fx & 1) ? (b & 0x0f) : (uint8_t)(b >> 4);
+}
+
+/**
+ * @brief draw pixel
+ * @param x, y - screen coordinates
+ * @param color - palette index
+ */
+void fb_draw_pixel(uint16_t x, uint16_t y, uint8_t color)
+{
+    if (fb_inside(x, y))
+    {
+        fb_begin();
+        fb_put(x, y, color);
+        fb_end();
+    }
+}
+
+/**
+ * @brief fill rectangle
+ * @param x, y - top left corner
+ * @param w, h - size
+ * @param color - palette index
+ */
+void fb_fill_rect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint8_t color)
+{
+    uint16_t x0 = ((int32_t)x - FB_X < 0) ? FB_X : x;
+    uint16_t y0 = ((int32_t)y - FB_Y < 0) ? FB_Y : y;
+    uint32_t x1 = (uint32_t)x + w;
+    uint32_t y1 = (uint32_t)y + h;
+
+    if (x1 > FB_X + FB_WIDTH) { x1 = FB_X + FB_WIDTH; }
+    if (y1 > FB_Y + FB_HEIGHT) { y1 = FB_Y + FB_HEIGHT; }
+
+    fb_begin();
+    for (uint16_t j = y0; j < y1; j++)
+    {
+        for (uint16_t i = x0; i < x1; i++)
+        {
+            fb_put(i, j, color);
+        }
+    }
+    fb_end();
+}
+
+/**
+ * @brief write string without line wrapping
+ * @param x, y - top left corner
+ * @param str - string
+ * @param font - font
+ * @param color, bgcolor - palette indexes
+ */
+void fb_write_string(uint16_t x, uint16_t y, const char *str, FontDef font,
+                     uint8_t color, uint8_t bgcolor)
+{
+    fb_begin();
+    while (*str)
+    {
+        const FontGlyph *glyph = Font_Glyph(&font, *str);
+        uint8_t width = Font_Advance(&font, glyph);
+
+        for (uint16_t i = 0; i < font.height; i++)
+        {
+            uint16_t b = Font_Row(&font, glyph, i);
+            for (uint16_t j = 0; j < width; j++)
+            {
+                uint16_t px = (uint16_t)(x + j);
+                uint16_t py = (uint16_t)(y + i);
+                if (fb_inside(px, py))
+                {
+                    fb_put(px, py, ((b << j) & 0x8000) ? color : bgcolor);
+                }
+            }
+        }
+        x = (uint16_t)(x + width);
+        str++;
+    }
+    fb_end();
+}
+
+/**
+ * @brief add rectangle to dirty list
+ * @param x0, y0, x1, y1 - rectangle, will be clipped to framebuffer
+ */
+void fb_mark_dirty(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1)
+{
+    fb_rect_t r;
+    if ((x0 > x1) || (y0 > y1) ||
+        ((int32_t)x1 - FB_X < 0) || ((int32_t)y1 - FB_Y < 0) ||
+        (x0 >= FB_X + FB_WIDTH) || (y0 >= FB_Y + FB_HEIGHT))
+    {
+        return;
+    }
+    r.x0 = ((int32_t)x0 - FB_X < 0) ? FB_X : x0;
+    r.y0 = ((int32_t)y0 - FB_Y < 0) ? FB_Y : y0;
+    r.x1 = x1 >= FB_X + FB_WIDTH ? FB_X + FB_WIDTH - 1 : x1;
+    r.y1 = y1 >= FB_Y + FB_HEIGHT ? FB_Y + FB_HEIGHT - 1 : y1;
+    fb_add_dirty(r);
+}
+
+/**
+ * @brief get count of dirty rectangles
+ * @return count
+ */
+uint16_t fb_dirty_count(void)
+{
+    return fb_dirty_n;
+}
+
+/**
+ * @brief get dirty rectangle
+ * @param i - rectangle number, less than {@link #fb_dirty_count}
+ * @return pointer to rectangle
+ */
+const fb_rect_t *fb_dirty_rect(uint16_t i)
+{
+    return &fb_dirty[i];
+}
+
+/**
+ * @brief send dirty rectangles to display and clean dirty list
+ *
+ * Each rectangle is one address window, its rows are expanded from
+ * palette into two row buffers by turns while other one is sent.
+ */
+void fb_flush(void)
+{
+    uint8_t n = 0;
+    for (uint16_t r = 0; r < fb_dirty_n; r++)
+    {
+        const fb_rect_t *d = &fb_dirty[r];
+        ST7789_StartWrite(d->x0, d->y0, d->x1, d->y1);
+        for (uint16_t y = d->y0; y <= d->y1; y++)
+        {
+            uint16_t *row = fb_row[n];
+            uint16_t c = 0;
+            for (uint16_t x = d->x0; x <= d->x1; x++)
+            {
+                row[c++] = fb_palette[fb_get_pixel(x, y)];
+            }
+            ST7789_WritePixels(row, c);
+            n ^= 1;
+        }
+    }
+    ST7789_WaitIdle();
+    fb_dirty_n = 0;
+}
+
+/** @}*/
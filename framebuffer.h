@@ -0,0 +1,136 @@
+/** @weakgroup hardware
+ *  @{
+ */
+/**
+ * @file framebuffer.h
+ * @brief partial update framebuffer with dirty rectangles for ST7789
+ *
+ * Copyright 2020 Stanislav V. Vlasov <stanislav.v.v@gmail.com>
+ *
+ * Full RGB565 screen does not fit in STM32F103 RAM, so framebuffer is
+ * a 4bpp palette shadow of screen region {@link #FB_X}, {@link #FB_Y},
+ * {@link #FB_WIDTH} x {@link #FB_HEIGHT}. Drawing changes shadow only,
+ * pixels which really changed are collected in dirty rectangles and
+ * sent to display by {@link #fb_flush}.
+ */
+
+#ifndef FRAMEBUFFER_H_
+#define FRAMEBUFFER_H_
+
+#include <stdint.h>
+#include "fonts.h"
+#include "st7789.h"
+
+/**
+ * framebuffer region on screen
+ * @{
+ */
+#define FB_X      0
+#define FB_Y      0
+#define FB_WIDTH  ST7789_WIDTH
+#define FB_HEIGHT 64
+/**
+ * @}
+ */
+
+/**
+ * colors in palette
+ */
+#define FB_COLORS 16
+
+/**
+ * max dirty rectangles, on overflow nearest rectangles are merged
+ */
+#define FB_MAX_DIRTY 8
+
+/**
+ * rectangles are merged if union has no more than this count of
+ * not changed pixels, it is cheaper than one more address window
+ */
+#define FB_MERGE_SLACK 16
+
+/**
+ * rectangle in screen coordinates, last column and row included
+ */
+typedef struct //vera++ blamed for single space
+{
+    uint16_t x0;
+    uint16_t y0;
+    uint16_t x1;
+    uint16_t y1;
+} fb_rect_t;
+
+/**
+ * @brief init palette and fill framebuffer with color
+ * @param color - palette index
+ *
+ * Whole framebuffer is dirty after init.
+ */
+void fb_init(uint8_t color);
+
+/**
+ * @brief set palette entry
+ * @param index - palette index
+ * @param color - RGB565 color
+ */
+void fb_set_palette(uint8_t index, uint16_t color);
+
+/**
+ * @brief get pixel from framebuffer
+ * @param x, y - screen coordinates inside of framebuffer
+ * @return palette index
+ */
+uint8_t fb_get_pixel(uint16_t x, uint16_t y);
+
+/**
+ * @brief draw pixel
+ * @param x, y - screen coordinates
+ * @param color - palette index
+ */
+void fb_draw_pixel(uint16_t x, uint16_t y, uint8_t color);
+
+/**
+ * @brief fill rectangle
+ * @param x, y - top left corner
+ * @param w, h - size
+ * @param color - palette index
+ */
+void fb_fill_rect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint8_t color);
+
+/**
+ * @brief write string without line wrapping
+ * @param x, y - top left corner
+ * @param str - string
+ * @param font - font
+ * @param color, bgcolor - palette indexes
+ */
+void fb_write_string(uint16_t x, uint16_t y, const char *str, FontDef font,
+                     uint8_t color, uint8_t bgcolor);
+
+/**
+ * @brief add rectangle to dirty list
+ * @param x0, y0, x1, y1 - rectangle, will be clipped to framebuffer
+ */
+void fb_mark_dirty(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1);
+
+/**
+ * @brief get count of dirty rectangles
+ * @return count
+ */
+uint16_t fb_dirty_count(void);
+
+/**
+ * @brief get dirty rectangle
+ * @param i - rectangle number, less than {@link #fb_dirty_count}
+ * @return pointer to rectangle
+ */
+const fb_rect_t *fb_dirty_rect(uint16_t i);
+
+/**
+ * @brief send dirty rectangles to display and clean dirty list
+ */
+void fb_flush(void);
+
+#endif
+
+/** @}*/
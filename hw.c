@@ -12,30 +12,311 @@
 #include "config_hw.h"
 #include "bool.h"
 #include <libopencm3/cm3/nvic.h>
+#include <libopencm3/cm3/scb.h>
 #include <libopencm3/stm32/rcc.h>
 #include <libopencm3/stm32/gpio.h>
 #include <libopencm3/stm32/usart.h>
 #include <libopencm3/stm32/spi.h>
+#include <libopencm3/stm32/dma.h>
+#include <libopencm3/stm32/exti.h>
 #include <libopencm3/stm32/timer.h>
 #include <errno.h>
 #include "FreeRTOS.h"
 #include "task.h"
+#include "semphr.h"
 #include "strings_local.h"
+#include "ring.h"
 #include "hw.h"
 
+/**
+ * uart transmit buffers: one is filled by tasks while other is sent
+ * by dma
+ * @{
+ */
+static uint8_t uart_tx_buffer[2][UART_TX_SIZE];
+static uint8_t uart_tx_filled = 0;              /** buffer filled by tasks */
+static uint16_t uart_tx_fill = 0;               /** bytes in it */
+static volatile boolean uart_tx_active = FALSE; /** dma sends other buffer */
+/**
+ * @}
+ */
+
+/**
+ * given from dma interrupt at the end of every transfer
+ */
+static SemaphoreHandle_t uart_tx_done = NULL;
+
+/**
+ * @brief check if uart output may be queued and waited for
+ * @return FALSE before scheduler start and in interrupt
+ */
+static inline boolean uart_tx_async(void)
+{
+    return (uart_tx_done != NULL) &&
+           (xTaskGetSchedulerState() == taskSCHEDULER_RUNNING) &&
+           ((SCB_ICSR & SCB_ICSR_VECTACTIVE) == 0);
+}
+
+/**
+ * @brief send filled buffer by dma and switch filling to other one
+ *
+ * Called with dma interrupt masked or from it, dma must be idle.
+ */
+static void uart_tx_start(void)
+{
+    dma_channel_reset(DMA1, UART_TX_DMA);
+    dma_set_peripheral_address(DMA1, UART_TX_DMA, (uint32_t)&USART_DR(UART));
+    dma_set_memory_address(DMA1, UART_TX_DMA, (uint32_t)uart_tx_buffer[uart_tx_filled]);
+    dma_set_number_of_data(DMA1, UART_TX_DMA, uart_tx_fill);
+    dma_set_read_from_memory(DMA1, UART_TX_DMA);
+    dma_enable_memory_increment_mode(DMA1, UART_TX_DMA);
+    dma_set_peripheral_size(DMA1, UART_TX_DMA, DMA_CCR_PSIZE_8BIT);
+    dma_set_memory_size(DMA1, UART_TX_DMA, DMA_CCR_MSIZE_8BIT);
+    dma_set_priority(DMA1, UART_TX_DMA, DMA_CCR_PL_LOW);
+    dma_enable_transfer_complete_interrupt(DMA1, UART_TX_DMA);
+    uart_tx_active = TRUE;
+    uart_tx_filled ^= 1;
+    uart_tx_fill = 0;
+    /* uart TXE requests start the transfer */
+    dma_enable_channel(DMA1, UART_TX_DMA);
+}
+
+/**
+ * @brief dma interrupt processing for uart transmit
+ *
+ * Buffer filled meanwhile is sent at once.
+ */
+void uart_tx_irq_handler(void)
+{
+    BaseType_t woken = pdFALSE;
+
+    dma_clear_interrupt_flags(DMA1, UART_TX_DMA, DMA_TCIF | DMA_TEIF | DMA_HTIF | DMA_GIF);
+    dma_disable_channel(DMA1, UART_TX_DMA);
+    uart_tx_active = FALSE;
+    if (uart_tx_fill != 0)
+    {
+        uart_tx_start();
+    }
+    if (uart_tx_done != NULL)
+    {
+        xSemaphoreGiveFromISR(uart_tx_done, &woken);
+    }
+    portYIELD_FROM_ISR(woken);
+}
+
+/**
+ * @brief send bytes by polling, for boot and fault messages
+ * @param data - bytes
+ * @param len - count of bytes
+ *
+ * Active dma transfer is finished first, buffer queued after it is
+ * sent later by interrupt.
+ */
+static void uart_send_polled(const char *data, uint16_t len)
+{
+    while (uart_tx_active && (DMA_CNDTR(DMA1, UART_TX_DMA) != 0))
+    {
+    }
+    for (uint16_t i = 0; i < len; i++)
+    {
+        usart_send_blocking(UART, (uint16_t)(uint8_t)data[i]);
+    }
+}
+
+/**
+ * @brief queue bytes for uart transmit without waiting
+ * @param data - bytes
+ * @param len - count of bytes
+ * @return count of queued bytes, less than len if buffers are full
+ */
+uint16_t uart_send(const char *data, uint16_t len)
+{
+    uint16_t n;
+
+    if (!uart_tx_async())
+    {
+        uart_send_polled(data, len);
+        return len;
+    }
+    taskENTER_CRITICAL();
+    n = (uint16_t)(UART_TX_SIZE - uart_tx_fill);
+    n = (n < len) ? n : len;
+    for (uint16_t i = 0; i < n; i++)
+    {
+        uart_tx_buffer[uart_tx_filled][uart_tx_fill + i] = (uint8_t)data[i];
+    }
+    uart_tx_fill = (uint16_t)(uart_tx_fill + n);
+    if (!uart_tx_active && (uart_tx_fill != 0))
+    {
+        uart_tx_start();
+    }
+    taskEXIT_CRITICAL();
+    return n;
+}
+
+/**
+ * @brief wait until queued bytes leave uart
+ * @param timeout - timeout in ticks, portMAX_DELAY - forever
+ * @return errno - 0 (ok), ETIME (timeout)
+ */
+uint16_t uart_flush(TickType_t timeout)
+{
+    TickType_t start = xTaskGetTickCount();
+
+    if (!uart_tx_async())
+    {
+        uart_send_polled(NULL, 0);
+    }
+    else
+    {
+        while (uart_tx_active || (uart_tx_fill != 0))
+        {
+            if ((timeout != portMAX_DELAY) && (xTaskGetTickCount() - start >= timeout))
+            {
+                return ETIME;
+            }
+            /* other waiter may take the give, so recheck every tick */
+            xSemaphoreTake(uart_tx_done, 1);
+        }
+    }
+    /* last byte leaves shift register */
+    while (!(USART_SR(UART) & USART_SR_TC))
+    {
+    }
+    return 0;
+}
+
+/**
+ * @brief send char to uart
+ * @param c - char for sending to uart
+ * @return none
+ */
+void send_char(char c)
+{
+    while (uart_send(&c, 1) == 0)
+    {
+        xSemaphoreTake(uart_tx_done, 1);
+    }
+}
+
 /**
  * @brief send null-terminated string to uart
  * @param s[] - string for sending to uart
  * @return none
+ *
+ * String is queued for dma, task waits only while both buffers are
+ * full. Before scheduler start and from interrupt it is sent at once.
  */
 void send_string(const char s[])
 {
-    uint16_t i = 0;
-    while (s[i] != 0)
+    send_buffer(s, strlen_local(s));
+}
+
+/**
+ * @brief send bytes to uart, waiting while buffers are full
+ * @param data - bytes
+ * @param len - count of bytes
+ */
+void send_buffer(const char *data, uint16_t len)
+{
+    while (len != 0)
+    {
+        uint16_t n = uart_send(data, len);
+        data += n;
+        len = (uint16_t)(len - n);
+        if (len != 0)
+        {
+            xSemaphoreTake(uart_tx_done, 1);
+        }
+    }
+}
+
+uart_rx_stats_t uart_rx_stats;
+
+/**
+ * received bytes, put by interrupt and taken by {@link #uart_recv}
+ * @{
+ */
+static uint8_t uart_rx_data[UART_RX_SIZE];
+static ring_t uart_rx_ring = {uart_rx_data, UART_RX_SIZE - 1, 0, 0};
+/**
+ * @}
+ */
+
+/**
+ * task blocked in {@link #uart_recv}, NULL if nobody waits
+ */
+static TaskHandle_t volatile uart_rx_waiting = NULL;
+
+/**
+ * @brief uart receive interrupt processing, puts byte to ring
+ *
+ * Waiting task is notified once, bytes received while it works are
+ * only put to ring.
+ */
+void uart_rx_irq_handler(void)
+{
+    uint32_t sr = USART_SR(UART);
+    TaskHandle_t task;
+
+    if (!(sr & (USART_SR_RXNE | USART_SR_ORE)))
+    {
+        return;
+    }
+    /* reading of DR after SR clears RXNE and ORE */
+    uint8_t byte = (uint8_t)USART_DR(UART);
+    if (sr & USART_SR_ORE)
+    {
+        uart_rx_stats.overruns++;
+    }
+    if (ring_put(&uart_rx_ring, byte))
+    {
+        uart_rx_stats.received++;
+    }
+    else
+    {
+        uart_rx_stats.dropped++;
+    }
+    task = uart_rx_waiting;
+    if (task != NULL)
+    {
+        BaseType_t woken = pdFALSE;
+        uart_rx_waiting = NULL;
+        vTaskNotifyGiveFromISR(task, &woken);
+        portYIELD_FROM_ISR(woken);
+    }
+}
+
+/**
+ * @brief take received char, waiting for it
+ * @param c - destination
+ * @param timeout - timeout in ticks, portMAX_DELAY - forever
+ * @return errno - 0 (ok), ETIME (timeout)
+ *
+ * Calling task is blocked while ring is empty. Ring is checked again
+ * after task is marked as waiting, so byte put in between is not
+ * missed.
+ */
+uint16_t uart_recv(char *c, TickType_t timeout)
+{
+    uint8_t byte;
+
+    while (!ring_get(&uart_rx_ring, &byte))
     {
-        send_char(s[i]);
-        i++;
+        uart_rx_waiting = xTaskGetCurrentTaskHandle();
+        if (ring_get(&uart_rx_ring, &byte))
+        {
+            uart_rx_waiting = NULL;
+            break;
+        }
+        if (ulTaskNotifyTake(pdTRUE, timeout) == 0)
+        {
+            uart_rx_waiting = NULL;
+            return ETIME;
+        }
     }
+    *c = (char)byte;
+    return 0;
 }
 
 /**
@@ -75,7 +356,7 @@ void send_named_bin(char name[], uint32_t data, uint8_t nibbles)
  *
  * Transmit buffer with given length to spi in two-wire 8-bit mode with timeout
  */
-uint16_t spi_send_buffer_2wire_8bit(uint32_t spi, uint8_t *buffer,
+uint16_t spi_send_buffer_2wire_8bit(uint32_t spi, const uint8_t *buffer,
                             uint16_t length, TickType_t timeout)
 {
     TickType_t tickstart = xTaskGetTickCount();
@@ -111,9 +392,486 @@ uint16_t spi_send_buffer_2wire_8bit(uint32_t spi, uint8_t *buffer,
             }
         }
     }
+    /* last byte still in shift register */
+    while (SPI_SR(spi) & SPI_SR_BSY)
+    {
+    }
+    return 0;
+}
+
+/**
+ * @brief set clock and mode of spi
+ * @param spi  spi port, SPI1 or SPI2
+ * @param cfg  new parameters
+ * @return errno - 0 (ok), EINVAL (bad baudrate), EBUSY (dma transfer active)
+ *
+ * Waits for the end of current frame, spi is disabled while changed.
+ */
+uint16_t spi_configure(uint32_t spi, const spi_config_t *cfg)
+{
+    uint32_t cr1;
+
+    if (cfg->baudrate > SPI_BAUDRATE_SLOWEST)
+    {
+        return EINVAL;
+    }
+    if (spi_dma_busy(spi))
+    {
+        return EBUSY;
+    }
+    while (SPI_SR(spi) & SPI_SR_BSY)
+    {
+    }
+    spi_disable(spi);
+    cr1 = SPI_CR1(spi) & ~(SPI_CR1_BAUDRATE_FPCLK_DIV_256 | SPI_CR1_CPOL | SPI_CR1_CPHA);
+    cr1 |= (uint32_t)cfg->baudrate << 3;
+    if (cfg->cpol)
+    {
+        cr1 |= SPI_CR1_CPOL;
+    }
+    if (cfg->cpha)
+    {
+        cr1 |= SPI_CR1_CPHA;
+    }
+    SPI_CR1(spi) = cr1;
+    spi_enable(spi);
+    return 0;
+}
+
+/**
+ * @brief get current clock and mode of spi
+ * @param spi  spi port, SPI1 or SPI2
+ * @param cfg  destination
+ */
+void spi_get_config(uint32_t spi, spi_config_t *cfg)
+{
+    uint32_t cr1 = SPI_CR1(spi);
+    cfg->baudrate = (uint8_t)((cr1 >> 3) & 7);
+    cfg->cpol = (cr1 & SPI_CR1_CPOL) != 0;
+    cfg->cpha = (cr1 & SPI_CR1_CPHA) != 0;
+}
+
+/**
+ * @brief spi clock for baudrate setting
+ * @param spi  spi port, SPI1 (apb2) or SPI2 (apb1)
+ * @param baudrate  0..7
+ * @return clock in Hz
+ */
+uint32_t spi_clock_hz(uint32_t spi, uint8_t baudrate)
+{
+    uint32_t fpclk = (spi == SPI1) ? rcc_apb2_frequency : rcc_apb1_frequency;
+    return fpclk >> (baudrate + 1);
+}
+
+/**
+ * @brief busy wait for at least one spi clock period
+ * @param spi  spi port, ex. SPI1 in libopencm3
+ *
+ * Spi clock is fpclk / 2^(BR + 1) and every loop pass takes several
+ * cpu clocks, so 2^(BR + 1) passes cover one spi clock even for SPI2 on
+ * apb1 and stay well inside of the last 8-bit frame.
+ */
+static void spi_wait_clock(uint32_t spi)
+{
+    volatile uint32_t n = 2UL << ((SPI_CR1(spi) >> 3) & 7);
+    while (n)
+    {
+        n--;
+    }
+}
+
+/**
+ * @brief wait for received byte with polls limit
+ * @param spi  spi port, ex. SPI1 in libopencm3
+ * @return TRUE if byte is in data register
+ */
+static boolean spi_wait_rxne(uint32_t spi)
+{
+    for (uint32_t n = 0; n < SPI_RX_SPIN; n++)
+    {
+        if (SPI_SR(spi) & SPI_SR_RXNE)
+        {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/**
+ * @brief receive bytes with interrupts masked
+ * @param spi  spi port, disabled and in receive-only mode
+ * @param buffer  destination
+ * @param length  count of bytes, 1..SPI_RX_CHUNK
+ * @return errno - 0 (ok), ETIME (no clock)
+ *
+ * Master clocks continuously while enabled in receive-only mode, so
+ * clock is stopped by RM0008 sequence: wait for byte n-1, wait one spi
+ * clock and disable spi, last frame is completed and received.
+ */
+static uint16_t spi_receive_chunk(uint32_t spi, uint8_t *buffer, uint16_t length)
+{
+    uint16_t status = 0;
+
+    taskENTER_CRITICAL();
+    spi_enable(spi);
+    for (uint16_t i = 0; i + 1U < length; i++)
+    {
+        if (!spi_wait_rxne(spi))
+        {
+            status = ETIME;
+            break;
+        }
+        buffer[i] = (uint8_t)SPI_DR(spi);
+    }
+    spi_wait_clock(spi);
+    spi_disable(spi);
+    if ((status == 0) && spi_wait_rxne(spi))
+    {
+        buffer[length - 1U] = (uint8_t)SPI_DR(spi);
+    }
+    else
+    {
+        status = ETIME;
+    }
+    taskEXIT_CRITICAL();
+    return status;
+}
+
+/**
+ * @brief receive bytes from spi in bidirectional mode
+ * @param spi  spi port, ex. SPI1 in libopencm3
+ * @param buffer  destination
+ * @param length  count of bytes
+ * @param timeout  timeout in ticks, portMAX_DELAY and 0 - switch off
+ * @return errno - 0 (ok), ETIME (timeout), EIO (bad parameters)
+ *
+ * MOSI line is switched to input and stays input until
+ * spi_receive_2wire_end(). Bytes are received by chunks of ~50us with
+ * interrupts masked, clock is stopped between them.
+ */
+uint16_t spi_receive_2wire_8bit(uint32_t spi, uint8_t *buffer,
+                                uint16_t length, TickType_t timeout)
+{
+    TickType_t tickstart = xTaskGetTickCount();
+    uint32_t chunk;
+    uint16_t status = 0;
+
+    /* bad parameters */
+    if ((buffer == NULL) || (length == 0U))
+    {
+        return EIO;
+    }
+    if (SPI_CR1(spi) & SPI_CR1_BIDIOE)
+    {
+        /* line is output: let last frame go, then turn it */
+        while (SPI_SR(spi) & SPI_SR_BSY)
+        {
+        }
+        spi_disable(spi);
+        spi_set_bidirectional_receive_only_mode(spi);
+        /* drop stale byte */
+        (void)SPI_DR(spi);
+    }
+
+    /* 8 clocks per byte, ~50us per chunk */
+    chunk = spi_clock_hz(spi, (uint8_t)((SPI_CR1(spi) >> 3) & 7)) / 160000UL;
+    chunk = (chunk == 0) ? 1 : ((chunk > SPI_RX_CHUNK) ? SPI_RX_CHUNK : chunk);
+    while (length)
+    {
+        uint16_t n = (length < chunk) ? length : (uint16_t)chunk;
+        if (((xTaskGetTickCount() - tickstart) >= timeout) &&
+            (timeout != portMAX_DELAY) &&
+            (timeout != (TickType_t)0))
+        {
+            return ETIME;
+        }
+        status = spi_receive_chunk(spi, buffer, n);
+        if (status)
+        {
+            return status;
+        }
+        buffer += n;
+        length = (uint16_t)(length - n);
+    }
+    return status;
+}
+
+/**
+ * @brief switch MOSI line back to output after spi_receive_2wire_8bit()
+ * @param spi  spi port, ex. SPI1 in libopencm3
+ */
+void spi_receive_2wire_end(uint32_t spi)
+{
+    if (SPI_CR1(spi) & SPI_CR1_BIDIOE)
+    {
+        return;
+    }
+    spi_set_bidirectional_transmit_only_mode(spi);
+    (void)SPI_DR(spi);
+    spi_enable(spi);
+}
+
+/**
+ * @brief switch spi between 8-bit and 16-bit data frames
+ * @param spi  spi port, ex. SPI1 in libopencm3
+ * @param wide  TRUE for 16-bit frames
+ *
+ * DFF may be changed only while spi is disabled, so waits for the end
+ * of current frame. Does nothing if mode is already set.
+ */
+void spi_set_frame_16bit(uint32_t spi, boolean wide)
+{
+    if (((SPI_CR1(spi) & SPI_CR1_DFF) != 0) == wide)
+    {
+        return;
+    }
+    while (SPI_SR(spi) & SPI_SR_BSY)
+    {
+    }
+    spi_disable(spi);
+    if (wide)
+    {
+        spi_set_dff_16bit(spi);
+    }
+    else
+    {
+        spi_set_dff_8bit(spi);
+    }
+    spi_enable(spi);
+}
+
+/**
+ * spi dma transfer is active
+ */
+static volatile boolean spi_dma_active = FALSE;
+
+/**
+ * result of last spi dma transfer
+ */
+static volatile uint16_t spi_dma_status = 0;
+
+/**
+ * given from dma interrupt at the end of transfer
+ */
+static SemaphoreHandle_t spi_dma_done = NULL;
+
+/**
+ * user callback for the end of transfer
+ */
+static spi_dma_callback_t spi_dma_callback = NULL;
+
+/**
+ * @brief get dma channel used for spi transmit
+ * @param spi  spi port, SPI1 or SPI2
+ * @return dma1 channel number
+ */
+static inline uint8_t spi_dma_channel(uint32_t spi)
+{
+    return (spi == SPI2) ? DMA_CHANNEL5 : DMA_CHANNEL3;
+}
+
+/**
+ * @brief stop dma channel and spi dma requests
+ * @param spi  spi port, SPI1 or SPI2
+ */
+static void spi_dma_stop(uint32_t spi)
+{
+    uint8_t channel = spi_dma_channel(spi);
+    spi_disable_tx_dma(spi);
+    dma_disable_channel(DMA1, channel);
+    dma_clear_interrupt_flags(DMA1, channel, DMA_TCIF | DMA_TEIF | DMA_HTIF | DMA_GIF);
+    spi_dma_active = FALSE;
+}
+
+/**
+ * @brief init dma for spi transmitting
+ * @param spi  spi port, SPI1 (dma1 channel 3) or SPI2 (dma1 channel 5)
+ *
+ * Must be called once after spi initialization.
+ */
+void spi_dma_init(uint32_t spi)
+{
+    uint8_t irq = (spi == SPI2) ? NVIC_DMA1_CHANNEL5_IRQ : NVIC_DMA1_CHANNEL3_IRQ;
+
+    rcc_periph_clock_enable(RCC_DMA1);
+    if (spi_dma_done == NULL)
+    {
+        spi_dma_done = xSemaphoreCreateBinary();
+    }
+    nvic_set_priority(irq, IRQ_PRIORITY_RTOS);
+    nvic_enable_irq(irq);
+}
+
+/**
+ * @brief program dma channel and start spi transmit requests
+ * @param spi  spi port, SPI1 or SPI2
+ * @param buffer  address of data
+ * @param length  count of frames
+ * @param size  DMA_CCR_PSIZE_8BIT or DMA_CCR_PSIZE_16BIT, the same for memory
+ * @param increment  FALSE sends the first frame length times
+ * @return errno - 0 (started), EBUSY (previous transfer active), EIO (bad parameters)
+ */
+static uint16_t spi_dma_start(uint32_t spi, const void *buffer, uint16_t length,
+                              uint32_t size, boolean increment)
+{
+    uint8_t channel = spi_dma_channel(spi);
+
+    /* bad parameters */
+    if ((buffer == NULL) || (length == 0U))
+    {
+        return EIO;
+    }
+    if (spi_dma_active)
+    {
+        return EBUSY;
+    }
+
+    spi_dma_active = TRUE;
+    spi_dma_status = 0;
+
+    /* transmit to spi now */
+    spi_set_bidirectional_transmit_only_mode(spi);
+
+    dma_channel_reset(DMA1, channel);
+    dma_set_peripheral_address(DMA1, channel, (uint32_t)&SPI_DR(spi));
+    dma_set_memory_address(DMA1, channel, (uint32_t)buffer);
+    dma_set_number_of_data(DMA1, channel, length);
+    dma_set_read_from_memory(DMA1, channel);
+    if (increment)
+    {
+        dma_enable_memory_increment_mode(DMA1, channel);
+    }
+    dma_set_peripheral_size(DMA1, channel, size);
+    dma_set_memory_size(DMA1, channel, (size == DMA_CCR_PSIZE_16BIT) ?
+                        DMA_CCR_MSIZE_16BIT : DMA_CCR_MSIZE_8BIT);
+    dma_set_priority(DMA1, channel, DMA_CCR_PL_HIGH);
+    dma_enable_transfer_complete_interrupt(DMA1, channel);
+    dma_enable_transfer_error_interrupt(DMA1, channel);
+    dma_enable_channel(DMA1, channel);
+
+    /* spi requests start the transfer */
+    spi_enable_tx_dma(spi);
     return 0;
 }
 
+/**
+ * @brief start sending buffer to spi by dma
+ * @param spi  spi port, SPI1 or SPI2
+ * @param buffer  buffer of bytes for sending, must live until transfer end
+ * @param length  length of buffer
+ * @return errno - 0 (started), EBUSY (previous transfer active), EIO (bad parameters)
+ *
+ * Only one dma transfer may be active at a time. Returns immediately,
+ * end of transfer will be signalled to {@link #spi_dma_wait} and
+ * to callback from {@link #spi_dma_set_callback}.
+ */
+uint16_t spi_dma_send_start(uint32_t spi, const uint8_t *buffer, uint16_t length)
+{
+    return spi_dma_start(spi, buffer, length, DMA_CCR_PSIZE_8BIT, TRUE);
+}
+
+/**
+ * @brief start sending 16-bit words to spi by dma
+ * @param spi  spi port in 16-bit frame mode, see {@link #spi_set_frame_16bit}
+ * @param buffer  words for sending, must live until transfer end
+ * @param length  count of words
+ * @param repeat  TRUE sends buffer[0] length times
+ * @return errno - 0 (started), EBUSY (previous transfer active), EIO (bad parameters)
+ *
+ * As {@link #spi_dma_send_start}, but every word is one spi frame,
+ * high byte goes first.
+ */
+uint16_t spi_dma_send16_start(uint32_t spi, const uint16_t *buffer, uint16_t length,
+                              boolean repeat)
+{
+    return spi_dma_start(spi, buffer, length, DMA_CCR_PSIZE_16BIT, !repeat);
+}
+
+/**
+ * @brief wait for end of spi dma transfer
+ * @param spi  spi port, SPI1 or SPI2
+ * @param timeout  timeout in ticks, portMAX_DELAY and 0 - switch off
+ * @return errno - 0 (ok), ETIME (timeout, transfer aborted), EIO (dma error)
+ *
+ * Calling task is blocked while waiting, so cpu is free for other tasks.
+ * Returns after last byte leaves spi shift register.
+ */
+uint16_t spi_dma_wait(uint32_t spi, TickType_t timeout)
+{
+    TickType_t tickstart = xTaskGetTickCount();
+    boolean forever = (timeout == portMAX_DELAY) || (timeout == (TickType_t)0);
+    boolean can_block = (spi_dma_done != NULL) &&
+        (xTaskGetSchedulerState() == taskSCHEDULER_RUNNING);
+
+    while (spi_dma_active)
+    {
+        TickType_t elapsed = xTaskGetTickCount() - tickstart;
+        if (!forever && (elapsed >= timeout))
+        {
+            spi_dma_stop(spi);
+            return ETIME;
+        }
+        if (can_block)
+        {
+            /* semaphore may be left from previous transfer - check state again */
+            xSemaphoreTake(spi_dma_done, forever ? portMAX_DELAY : (timeout - elapsed));
+        }
+    }
+
+    /* last byte still in shift register */
+    while (SPI_SR(spi) & SPI_SR_BSY)
+    {
+    }
+    return spi_dma_status;
+}
+
+/**
+ * @brief return state of spi dma transfer
+ * @param spi  spi port, SPI1 or SPI2
+ * @return TRUE while transfer is active
+ */
+boolean spi_dma_busy(uint32_t spi)
+{
+    (void)(spi);
+    return spi_dma_active;
+}
+
+/**
+ * @brief set callback for end of spi dma transfer
+ * @param callback - function called from interrupt or NULL
+ */
+void spi_dma_set_callback(spi_dma_callback_t callback)
+{
+    spi_dma_callback = callback;
+}
+
+/**
+ * @brief dma interrupt processing for spi transfer
+ * @param spi  spi port, SPI1 or SPI2
+ */
+void spi_dma_irq_handler(uint32_t spi)
+{
+    BaseType_t woken = pdFALSE;
+    uint8_t channel = spi_dma_channel(spi);
+
+    if (dma_get_interrupt_flag(DMA1, channel, DMA_TEIF))
+    {
+        spi_dma_status = EIO;
+    }
+    spi_dma_stop(spi);
+
+    /* callback may start next transfer */
+    if (spi_dma_callback != NULL)
+    {
+        spi_dma_callback(spi_dma_status);
+    }
+    if (spi_dma_done != NULL)
+    {
+        xSemaphoreGiveFromISR(spi_dma_done, &woken);
+    }
+    portYIELD_FROM_ISR(woken);
+}
+
 
 /**
  * @brief set gpio and other hardware modes
@@ -173,7 +931,16 @@ void init_gpio(void)
     usart_set_flow_control(UART, USART_FLOWCONTROL_NONE);
     usart_set_mode(UART, USART_MODE_TX_RX);
 
-    /* enable uart */
+    /* enable uart, received bytes are taken by interrupt */
+    usart_enable_rx_interrupt(UART);
+    nvic_set_priority(UART_IRQ, IRQ_PRIORITY_RTOS);
+    nvic_enable_irq(UART_IRQ);
+    /* sent bytes are given by dma after scheduler start */
+    rcc_periph_clock_enable(RCC_DMA1);
+    uart_tx_done = xSemaphoreCreateBinary();
+    usart_enable_tx_dma(UART);
+    nvic_set_priority(UART_TX_DMA_IRQ, IRQ_PRIORITY_RTOS);
+    nvic_enable_irq(UART_TX_DMA_IRQ);
     usart_enable(UART);
 
 #if BOOT_VERBOSE==1
@@ -184,6 +951,15 @@ void init_gpio(void)
     gpio_set_mode(ST7789_SPI_PORT, GPIO_MODE_OUTPUT_50_MHZ,
             GPIO_CNF_OUTPUT_ALTFN_PUSHPULL, ST7789_SCK | ST7789_SDA);
 
+    /* TE pulse of display, rising edge at start of vertical blanking */
+    gpio_set_mode(ST7789_TE_PORT, GPIO_MODE_INPUT,
+            GPIO_CNF_INPUT_FLOAT, ST7789_TE_PIN);
+    exti_select_source(ST7789_TE_EXTI, ST7789_TE_PORT);
+    exti_set_trigger(ST7789_TE_EXTI, EXTI_TRIGGER_RISING);
+    exti_enable_request(ST7789_TE_EXTI);
+    nvic_set_priority(ST7789_TE_IRQ, IRQ_PRIORITY_RTOS);
+    nvic_enable_irq(ST7789_TE_IRQ);
+
 #if BOOT_VERBOSE==1
     send_string("spi gpio initalized\r\n");
 #endif
@@ -205,7 +981,7 @@ void init_gpio(void)
      *
      * LSBFIRST = 0 (MSB first)
      * SPE = 0 (SPI enable) -- switch to 1 at the end of init
-     * BR[2:0] = 101 (fpclk/64)
+     * BR[2:0] = 111 (fpclk/256, raised by spi_configure() later)
      * MSTR = 1 (spi master)
      * CPOL = 1 (clock polarity 1 when idle)
      * CPHA = 1 (second clock transition is the first data capture)
@@ -217,7 +993,7 @@ void init_gpio(void)
      * ERRIE = 0 (error int disable)
      * [4:3] - reserved
      * SSOE = 0 (SS output disabled)
-     * TXDMA = 0 (tx dma disabled)
+     * TXDMA = 0 (tx dma disabled, enabled by spi_dma_send_start())
      * RXDMA = 0 (rx dma disabled)
      *
      * I2SCFGR:
@@ -249,6 +1025,7 @@ void init_gpio(void)
 #endif
 
     spi_enable(ST7789_SPI);
+    spi_dma_init(ST7789_SPI);
 
 #if BOOT_VERBOSE==1
     send_string("spi enable:\r\n");
@@ -9,6 +9,10 @@
  *
  */
 
+#ifndef HW_H_
+#define HW_H_
+
+#include "bool.h"
 
 #ifndef UNITTEST
 // NORMAL WORK
@@ -37,12 +41,6 @@
  */
 #define LED_state() (GPIO_ODR(LED_PORT) && LED_PIN)
 
-/**
- * @brief receive char from uart
- * @return received char
- */
-#define recv_char() (char)(0xff & usart_recv_blocking(UART))
-
 /**
  * @brief fakeable gpio_set_mode
  */
@@ -67,23 +65,35 @@ static inline void config_gpio_input(uint32_t gpioport, uint16_t gpios)
         gpio_set_mode(gpioport, GPIO_MODE_OUTPUT_50_MHZ, GPIO_CNF_INPUT_FLOAT, gpios);
 }
 
+/**
+ * bytes of each of two uart transmit buffers
+ */
+#define UART_TX_SIZE 256
+
 /**
  * @brief send char to uart
  * @param c - char for sending to uart
  * @return none
+ *
+ * Char is queued, see {@link #send_string}.
  */
-static inline void send_char(char c)
-{
-    usart_send_blocking(UART, (uint16_t)(c));
-}
+void send_char(char c);
 
 /**
  * @brief send null-terminated string to uart
  * @param s[] - string for sending to uart
  * @return none
+ *
+ * String is queued for dma, task waits only while both buffers are
+ * full. Before scheduler start and from interrupt it is sent at once.
  */
 void send_string(const char s[]);
 
+/**
+ * @brief dma interrupt processing for uart transmit
+ */
+void uart_tx_irq_handler(void);
+
 /**
  * @brief send named number in human-readable binary
  * @param name - name (max char[10])
@@ -93,10 +103,36 @@ void send_string(const char s[]);
 void send_named_bin(char name[], uint32_t data, uint8_t nibbles);
 
 /**
- * @brief return true if uart has received char in register
- * @return bool char received state
+ * bytes of uart receive ring, power of two
  */
-#define char_is_recv() (USART_SR(UART) & USART_SR_RXNE) != 0
+#define UART_RX_SIZE 128
+
+/**
+ * uart receive counters
+ */
+typedef struct //vera++ blamed for single space
+{
+    uint32_t received;      /** bytes put to ring */
+    uint32_t dropped;       /** bytes lost, ring was full */
+    uint32_t overruns;      /** bytes lost by uart before interrupt */
+} uart_rx_stats_t;
+
+extern uart_rx_stats_t uart_rx_stats;
+
+/**
+ * @brief uart receive interrupt processing, puts byte to ring
+ */
+void uart_rx_irq_handler(void);
+
+/**
+ * @brief take received char, waiting for it
+ * @param c - destination
+ * @param timeout - timeout in ticks, portMAX_DELAY - forever
+ * @return errno - 0 (ok), ETIME (timeout)
+ *
+ * Calling task is blocked while ring is empty.
+ */
+uint16_t uart_recv(char *c, TickType_t timeout);
 
 
 /**
@@ -109,6 +145,15 @@ static inline void delay_ms(uint16_t ms)
     vTaskDelay(pdMS_TO_TICKS(ms));
 }
 
+/**
+ * @brief time since scheduler start
+ * @return milliseconds
+ */
+static inline uint32_t hw_time_ms(void)
+{
+    return (uint32_t)(xTaskGetTickCount() * portTICK_PERIOD_MS);
+}
+
 /**
  * @brief delay to given time in rtos ticks
  * @param ticks  time in ticks up to portMAX_DELAY
@@ -119,6 +164,134 @@ static inline void delay_ticks(TickType_t ticks)
     vTaskDelay(ticks);
 }
 
+/**
+ * @brief return true if uart has received char in register
+ * @return bool char received state
+ */
+void init_gpio(void);
+
+#else
+// UNIT TESTS
+#include <stdint.h>
+
+// host backend with fake uart, gpio, spi and dma
+#include "hw_fake.h"
+
+//ToDo: make test mocks for this defs
+#define LED_on()
+#define LED_off()
+#define LED_state() 1
+
+#endif
+
+/**
+ * @brief queue bytes for uart transmit without waiting
+ * @param data - bytes
+ * @param len - count of bytes
+ * @return count of queued bytes, less than len if buffers are full
+ */
+uint16_t uart_send(const char *data, uint16_t len);
+
+/**
+ * @brief send bytes to uart, waiting while buffers are full
+ * @param data - bytes
+ * @param len - count of bytes
+ */
+void send_buffer(const char *data, uint16_t len);
+
+/**
+ * @brief wait until queued bytes leave uart
+ * @param timeout - timeout in ticks, portMAX_DELAY - forever
+ * @return errno - 0 (ok), ETIME (timeout)
+ */
+uint16_t uart_flush(TickType_t timeout);
+
+/**
+ * @brief spi dma transfer end callback
+ * @param status - errno of transfer: 0 (ok) or EIO (dma error)
+ *
+ * Called from dma interrupt, so must be short and use only
+ * FromISR rtos functions.
+ */
+typedef void (*spi_dma_callback_t)(uint16_t status);
+
+/**
+ * spi bus parameters changed at runtime
+ */
+typedef struct //vera++ blamed for single space
+{
+    uint8_t baudrate;       /** clock is fpclk / 2^(baudrate + 1), 0..7 */
+    boolean cpol;           /** clock is 1 when idle */
+    boolean cpha;           /** data captured on second clock edge */
+} spi_config_t;
+
+/**
+ * slowest spi clock, fpclk/256
+ */
+#define SPI_BAUDRATE_SLOWEST 7
+
+/**
+ * @brief set clock and mode of spi
+ * @param spi  spi port, SPI1 or SPI2
+ * @param cfg  new parameters
+ * @return errno - 0 (ok), EINVAL (bad baudrate), EBUSY (dma transfer active)
+ *
+ * Waits for the end of current frame, spi is disabled while changed.
+ */
+uint16_t spi_configure(uint32_t spi, const spi_config_t *cfg);
+
+/**
+ * @brief get current clock and mode of spi
+ * @param spi  spi port, SPI1 or SPI2
+ * @param cfg  destination
+ */
+void spi_get_config(uint32_t spi, spi_config_t *cfg);
+
+/**
+ * @brief spi clock for baudrate setting
+ * @param spi  spi port, SPI1 (apb2) or SPI2 (apb1)
+ * @param baudrate  0..7
+ * @return clock in Hz
+ */
+uint32_t spi_clock_hz(uint32_t spi, uint8_t baudrate);
+
+/**
+ * longest run of bytes received with interrupts masked, about 50us of
+ * clock, so overrun is not caused by interrupt handlers
+ */
+#define SPI_RX_CHUNK 64
+
+/**
+ * polls of RXNE before receive gives up inside critical section, where
+ * tick count does not advance. Slowest clock gives byte in ~2000 polls
+ */
+#define SPI_RX_SPIN 0x10000UL
+
+/**
+ * @brief receive bytes from spi in bidirectional mode
+ * @param spi  spi port, ex. SPI1 in libopencm3
+ * @param buffer  destination
+ * @param length  count of bytes
+ * @param timeout  timeout in ticks, portMAX_DELAY and 0 - switch off
+ * @return errno - 0 (ok), ETIME (timeout), EIO (bad parameters)
+ *
+ * MOSI line is switched to input and stays input until
+ * spi_receive_2wire_end(), so one read command may be received by
+ * several calls. Each call clocks exactly length bytes, the clock is
+ * stopped by RM0008 sequence. Spi must be in 8-bit frames.
+ */
+uint16_t spi_receive_2wire_8bit(uint32_t spi, uint8_t *buffer,
+                                uint16_t length, TickType_t timeout);
+
+/**
+ * @brief switch MOSI line back to output after spi_receive_2wire_8bit()
+ * @param spi  spi port, ex. SPI1 in libopencm3
+ *
+ * Must be called after chip select is released, may clock one more
+ * byte on some chips.
+ */
+void spi_receive_2wire_end(uint32_t spi);
+
 /**
  * @brief send buffer to spi with timeout
  * @param spi  spi port, ex. SPI1 in libopencm3
@@ -129,53 +302,83 @@ static inline void delay_ticks(TickType_t ticks)
  *
  * Transmit buffer with given length to spi in two-wire 8-bit mode with timeout
  */
-uint16_t spi_send_buffer_2wire_8bit(uint32_t spi, uint8_t *buffer,
+uint16_t spi_send_buffer_2wire_8bit(uint32_t spi, const uint8_t *buffer,
                                     uint16_t length, TickType_t timeout);
 
 /**
- * @brief return true if uart has received char in register
- * @return bool char received state
+ * @brief switch spi between 8-bit and 16-bit data frames
+ * @param spi  spi port, ex. SPI1 in libopencm3
+ * @param wide  TRUE for 16-bit frames
+ *
+ * DFF may be changed only while spi is disabled, so waits for the end
+ * of current frame. Does nothing if mode is already set.
  */
-void init_gpio(void);
+void spi_set_frame_16bit(uint32_t spi, boolean wide);
 
-#else
-// UNIT TESTS
-#include <stdint.h>
-
-//ToDo: make mocks for this functions
-// dummy realisation for tests.c
-char recv_char(void);
-void send_char(char c);
-void send_string(const char s[]);
-uint16_t char_is_recv(void);
-void init_gpio(void);
+/**
+ * @brief init dma for spi transmitting
+ * @param spi  spi port, SPI1 (dma1 channel 3) or SPI2 (dma1 channel 5)
+ *
+ * Must be called once after spi initialization.
+ */
+void spi_dma_init(uint32_t spi);
 
-char recv_char(void)
-{
-    return ' ';
-}
+/**
+ * @brief start sending buffer to spi by dma
+ * @param spi  spi port, SPI1 or SPI2
+ * @param buffer  buffer of bytes for sending, must live until transfer end
+ * @param length  length of buffer
+ * @return errno - 0 (started), EBUSY (previous transfer active), EIO (bad parameters)
+ *
+ * Only one dma transfer may be active at a time. Returns immediately,
+ * end of transfer will be signalled to {@link #spi_dma_wait} and
+ * to callback from {@link #spi_dma_set_callback}.
+ */
+uint16_t spi_dma_send_start(uint32_t spi, const uint8_t *buffer, uint16_t length);
 
-void send_char(char c)
-{
-}
+/**
+ * @brief start sending 16-bit words to spi by dma
+ * @param spi  spi port in 16-bit frame mode, see {@link #spi_set_frame_16bit}
+ * @param buffer  words for sending, must live until transfer end
+ * @param length  count of words
+ * @param repeat  TRUE sends buffer[0] length times
+ * @return errno - 0 (started), EBUSY (previous transfer active), EIO (bad parameters)
+ *
+ * As {@link #spi_dma_send_start}, but every word is one spi frame,
+ * high byte goes first.
+ */
+uint16_t spi_dma_send16_start(uint32_t spi, const uint16_t *buffer, uint16_t length,
+                              boolean repeat);
 
-void send_string(const char s[])
-{
-}
+/**
+ * @brief wait for end of spi dma transfer
+ * @param spi  spi port, SPI1 or SPI2
+ * @param timeout  timeout in ticks, portMAX_DELAY and 0 - switch off
+ * @return errno - 0 (ok), ETIME (timeout, transfer aborted), EIO (dma error)
+ *
+ * Calling task is blocked while waiting, so cpu is free for other tasks.
+ * Returns after last byte leaves spi shift register.
+ */
+uint16_t spi_dma_wait(uint32_t spi, TickType_t timeout);
 
-uint16_t char_is_recv(void)
-{
-    return (1==0);
-}
+/**
+ * @brief return state of spi dma transfer
+ * @param spi  spi port, SPI1 or SPI2
+ * @return TRUE while transfer is active
+ */
+boolean spi_dma_busy(uint32_t spi);
 
-void init_gpio(void)
-{
-}
+/**
+ * @brief set callback for end of spi dma transfer
+ * @param callback - function called from interrupt or NULL
+ */
+void spi_dma_set_callback(spi_dma_callback_t callback);
 
-//ToDo: make test mocks for this defs
-#define LED_on()
-#define LED_off()
-#define LED_state() 1
+/**
+ * @brief dma interrupt processing for spi transfer
+ * @param spi  spi port, SPI1 or SPI2
+ */
+void spi_dma_irq_handler(uint32_t spi);
 
 #endif
 
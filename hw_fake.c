@@ -0,0 +1,457 @@
+/** @weakgroup tests
+ *  @{
+ */
+/**
+ * @file hw_fake.c
+ * @brief host backend for hardware interface functions
+ *
+ * Copyright 2020 Stanislav V. Vlasov <stanislav.v.v@gmail.com>
+ *
+ * Spi is "sent" to counters and sink, dma transfers end only in
+ * spi_dma_wait() or fake_spi_dma_irq(), as on real hardware they end
+ * some time later. Cpu time line runs along bus time: blocking
+ * transfers and waits for dma move it to the end of bus traffic,
+ * dma goes on while cpu does {@link #fake_cpu_work}.
+ */
+
+#include <errno.h>
+#include <stddef.h>
+#include "config_hw.h"
+#include "bool.h"
+#include "hw.h"
+
+fake_spi_stats_t fake_spi_stats;
+fake_spi_sink_t fake_spi_sink = NULL;
+fake_spi_source_t fake_spi_source = NULL;
+boolean fake_spi_dma_hang = FALSE;
+uint32_t fake_spi_max_hz = 0;
+
+/**
+ * DC line state
+ */
+static boolean fake_dc = FALSE;
+
+/**
+ * spi frame mode, TRUE for 16-bit frames
+ */
+static boolean fake_wide = FALSE;
+
+/**
+ * MOSI line is input between spi_receive_2wire_8bit() and
+ * spi_receive_2wire_end()
+ */
+static boolean fake_rx = FALSE;
+
+/**
+ * spi bus parameters, reset state is fpclk/256
+ */
+static spi_config_t fake_config = {SPI_BAUDRATE_SLOWEST, TRUE, TRUE};
+
+/**
+ * time of all spi traffic, ns
+ */
+static uint64_t fake_time_ns = 0;
+
+/**
+ * cpu time line and time of the end of queued bus traffic on it, ns
+ * @{
+ */
+static uint64_t fake_wall_ns = 0;
+static uint64_t fake_bus_free_ns = 0;
+/**
+ * @}
+ */
+
+/**
+ * data bytes sent above {@link #fake_spi_max_hz}
+ */
+static uint32_t fake_fast_bytes = 0;
+
+/**
+ * active dma transfer state
+ */
+static boolean fake_dma_active = FALSE;
+static uint16_t fake_dma_status = 0;
+static spi_dma_callback_t fake_dma_callback = NULL;
+
+char fake_uart_out[FAKE_UART_SIZE + 1];
+uint32_t fake_uart_sent = 0;
+
+/**
+ * @brief forget captured uart output
+ */
+void fake_uart_reset(void)
+{
+    fake_uart_sent = 0;
+    fake_uart_out[0] = 0;
+}
+
+/**
+ * @brief capture bytes sent to uart
+ * @param data - bytes
+ * @param len - count of bytes
+ * @return len, capture never is full
+ */
+uint16_t uart_send(const char *data, uint16_t len)
+{
+    for (uint16_t i = 0; i < len; i++)
+    {
+        if (fake_uart_sent < FAKE_UART_SIZE)
+        {
+            fake_uart_out[fake_uart_sent] = data[i];
+            fake_uart_out[fake_uart_sent + 1] = 0;
+        }
+        fake_uart_sent++;
+    }
+    return len;
+}
+
+uint16_t uart_flush(TickType_t timeout)
+{
+    (void)(timeout);
+    return 0;
+}
+
+void send_char(char c)
+{
+    uart_send(&c, 1);
+}
+
+void send_buffer(const char *data, uint16_t len)
+{
+    uart_send(data, len);
+}
+
+void send_string(const char s[])
+{
+    uint16_t len = 0;
+    while (s[len] != 0)
+    {
+        len++;
+    }
+    send_buffer(s, len);
+}
+
+void init_gpio(void)
+{
+}
+
+void delay_ms(uint16_t ms)
+{
+    (void)(ms);
+}
+
+void gpio_set(uint32_t gpioport, uint16_t gpios)
+{
+    if ((gpioport == ST7789_DC_PORT) && (gpios & ST7789_DC_PIN))
+    {
+        fake_dc = TRUE;
+        fake_spi_stats.transactions++;
+    }
+}
+
+void gpio_clear(uint32_t gpioport, uint16_t gpios)
+{
+    if ((gpioport == ST7789_DC_PORT) && (gpios & ST7789_DC_PIN))
+    {
+        fake_dc = FALSE;
+        fake_spi_stats.transactions++;
+    }
+}
+
+/**
+ * @brief put traffic on bus after already queued one
+ * @param ns - time of traffic
+ */
+static void fake_spi_bus(uint64_t ns)
+{
+    uint64_t start = fake_wall_ns > fake_bus_free_ns ? fake_wall_ns : fake_bus_free_ns;
+    fake_bus_free_ns = start + ns;
+    fake_time_ns += ns;
+}
+
+/**
+ * @brief wait on cpu time line for the end of bus traffic
+ */
+static void fake_spi_bus_wait(void)
+{
+    if (fake_wall_ns < fake_bus_free_ns)
+    {
+        fake_wall_ns = fake_bus_free_ns;
+    }
+}
+
+/**
+ * @brief count sent bytes and give them to sink
+ * @param buffer, length - sent data
+ */
+static void fake_spi_push(const uint8_t *buffer, uint16_t length)
+{
+    uint32_t hz = spi_clock_hz(SPI1, fake_config.baudrate);
+    boolean fast = (fake_spi_max_hz != 0) && (hz > fake_spi_max_hz);
+
+    for (uint16_t i = 0; i < length; i++)
+    {
+        uint8_t b = buffer[i];
+        if (fake_dc)
+        {
+            fake_spi_stats.data_bytes++;
+            /* too fast link flips a bit now and then */
+            if (fast && (++fake_fast_bytes % 97 == 0))
+            {
+                b ^= 0x10;
+            }
+        }
+        else
+        {
+            fake_spi_stats.cmd_bytes++;
+        }
+        if (fake_spi_sink != NULL)
+        {
+            fake_spi_sink(b, fake_dc);
+        }
+    }
+    fake_spi_stats.bytes += length;
+    fake_spi_bus((uint64_t)length * 8U * 1000000000U / hz);
+}
+
+/**
+ * @brief time of spi traffic at configured clock since start
+ * @return milliseconds
+ */
+uint32_t hw_time_ms(void)
+{
+    return (uint32_t)(fake_time_ns / 1000000U);
+}
+
+uint16_t spi_configure(uint32_t spi, const spi_config_t *cfg)
+{
+    (void)(spi);
+    if (cfg->baudrate > SPI_BAUDRATE_SLOWEST)
+    {
+        return EINVAL;
+    }
+    if (fake_dma_active)
+    {
+        return EBUSY;
+    }
+    fake_config = *cfg;
+    return 0;
+}
+
+void spi_get_config(uint32_t spi, spi_config_t *cfg)
+{
+    (void)(spi);
+    *cfg = fake_config;
+}
+
+uint32_t spi_clock_hz(uint32_t spi, uint8_t baudrate)
+{
+    /* SPI1 on 72 MHz apb2, SPI2 on 36 MHz apb1 */
+    return (spi == SPI2 ? 36000000UL : 72000000UL) >> (baudrate + 1);
+}
+
+uint16_t spi_receive_2wire_8bit(uint32_t spi, uint8_t *buffer,
+                                uint16_t length, TickType_t timeout)
+{
+    (void)(timeout);
+    if ((buffer == NULL) || (length == 0U) || fake_wide)
+    {
+        return EIO;
+    }
+    fake_rx = TRUE;
+    for (uint16_t i = 0; i < length; i++)
+    {
+        buffer[i] = (fake_spi_source != NULL) ? fake_spi_source() : 0xff;
+    }
+    fake_spi_stats.transfers++;
+    fake_spi_stats.frames += length;
+    fake_spi_bus((uint64_t)length * 8U * 1000000000U / spi_clock_hz(spi, fake_config.baudrate));
+    fake_spi_bus_wait();
+    return 0;
+}
+
+void spi_receive_2wire_end(uint32_t spi)
+{
+    /* worst case of stop: one more byte is clocked out of panel */
+    if (fake_rx && (fake_spi_source != NULL))
+    {
+        (void)fake_spi_source();
+        fake_spi_bus((uint64_t)8U * 1000000000U / spi_clock_hz(spi, fake_config.baudrate));
+    }
+    fake_rx = FALSE;
+}
+
+/**
+ * @brief reset spi counters, bus parameters and dma state
+ */
+void fake_spi_reset(void)
+{
+    fake_spi_stats = (fake_spi_stats_t){0, 0, 0, 0, 0, 0, 0};
+    fake_config = (spi_config_t){SPI_BAUDRATE_SLOWEST, TRUE, TRUE};
+    fake_dma_active = FALSE;
+    fake_dma_status = 0;
+    fake_rx = FALSE;
+    fake_spi_dma_hang = FALSE;
+    fake_spi_max_hz = 0;
+    fake_fast_bytes = 0;
+    fake_wall_ns = 0;
+    fake_bus_free_ns = 0;
+}
+
+/**
+ * @brief spend cpu time, dma transfers go on meanwhile
+ * @param ns - time of work
+ */
+void fake_cpu_work(uint32_t ns)
+{
+    fake_wall_ns += ns;
+}
+
+/**
+ * @brief cpu time line since {@link #fake_spi_reset}
+ * @return microseconds
+ */
+uint32_t fake_wall_us(void)
+{
+    return (uint32_t)(fake_wall_ns / 1000U);
+}
+
+/**
+ * @brief estimated time of recorded spi traffic
+ * @return microseconds at {@link #FAKE_SPI_CLOCK}
+ */
+uint32_t fake_spi_time_us(void)
+{
+    uint64_t ns = (uint64_t)fake_spi_stats.bytes * 8U * 1000000000U / FAKE_SPI_CLOCK;
+    ns += (uint64_t)fake_spi_stats.transactions * FAKE_SPI_TRANSACTION_NS;
+    return (uint32_t)(ns / 1000U);
+}
+
+uint16_t spi_send_buffer_2wire_8bit(uint32_t spi, const uint8_t *buffer,
+                                    uint16_t length, TickType_t timeout)
+{
+    (void)(spi);
+    (void)(timeout);
+    /* byte in 16-bit frame would be garbage on wire, input line sends nothing */
+    if ((buffer == NULL) || (length == 0U) || fake_wide || fake_rx)
+    {
+        return EIO;
+    }
+    fake_spi_stats.transfers++;
+    fake_spi_stats.frames += length;
+    fake_spi_push(buffer, length);
+    fake_spi_bus_wait();
+    return 0;
+}
+
+void spi_set_frame_16bit(uint32_t spi, boolean wide)
+{
+    (void)(spi);
+    fake_wide = wide;
+}
+
+void spi_dma_init(uint32_t spi)
+{
+    (void)(spi);
+}
+
+uint16_t spi_dma_send_start(uint32_t spi, const uint8_t *buffer, uint16_t length)
+{
+    (void)(spi);
+    if ((buffer == NULL) || (length == 0U) || fake_wide || fake_rx)
+    {
+        return EIO;
+    }
+    if (fake_dma_active)
+    {
+        return EBUSY;
+    }
+    fake_dma_active = TRUE;
+    fake_dma_status = 0;
+    fake_spi_stats.transfers++;
+    fake_spi_stats.dma_transfers++;
+    fake_spi_stats.frames += length;
+    fake_spi_push(buffer, length);
+    return 0;
+}
+
+uint16_t spi_dma_send16_start(uint32_t spi, const uint16_t *buffer, uint16_t length,
+                              boolean repeat)
+{
+    (void)(spi);
+    if ((buffer == NULL) || (length == 0U) || !fake_wide || fake_rx)
+    {
+        return EIO;
+    }
+    if (fake_dma_active)
+    {
+        return EBUSY;
+    }
+    fake_dma_active = TRUE;
+    fake_dma_status = 0;
+    fake_spi_stats.transfers++;
+    fake_spi_stats.dma_transfers++;
+    fake_spi_stats.frames += length;
+    for (uint16_t i = 0; i < length; i++)
+    {
+        uint16_t w = repeat ? buffer[0] : buffer[i];
+        uint8_t b[2] = {(uint8_t)(w >> 8), (uint8_t)(w & 0xFF)};
+        fake_spi_push(b, 2);
+    }
+    return 0;
+}
+
+/**
+ * @brief end active dma transfer as from dma interrupt
+ */
+void fake_spi_dma_irq(void)
+{
+    spi_dma_irq_handler(SPI1);
+}
+
+uint16_t spi_dma_wait(uint32_t spi, TickType_t timeout)
+{
+    (void)(timeout);
+    if (fake_dma_active && !fake_spi_dma_hang)
+    {
+        fake_spi_bus_wait();
+    }
+    while (fake_dma_active)
+    {
+        if (fake_spi_dma_hang)
+        {
+            fake_dma_active = FALSE;
+            return ETIME;
+        }
+        spi_dma_irq_handler(spi);
+    }
+    return fake_dma_status;
+}
+
+boolean spi_dma_busy(uint32_t spi)
+{
+    (void)(spi);
+    return fake_dma_active;
+}
+
+void spi_dma_set_callback(spi_dma_callback_t callback)
+{
+    fake_dma_callback = callback;
+}
+
+void spi_dma_irq_handler(uint32_t spi)
+{
+    (void)(spi);
+    if (!fake_dma_active)
+    {
+        return;
+    }
+    fake_dma_active = FALSE;
+    if (fake_dma_callback != NULL)
+    {
+        fake_dma_callback(fake_dma_status);
+    }
+}
+
+/** @}*/
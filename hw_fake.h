@@ -0,0 +1,185 @@
+/** @weakgroup tests
+ *  @{
+ */
+/**
+ * @file hw_fake.h
+ * @brief host backend for hardware interface functions
+ *
+ * Copyright 2020 Stanislav V. Vlasov <stanislav.v.v@gmail.com>
+ *
+ * Used instead of libopencm3 and FreeRTOS in unit tests (UNITTEST defined).
+ * Spi and dma functions do not send anything, but record transfers
+ * to {@link #fake_spi_stats} and give sent bytes to {@link #fake_spi_sink}.
+ */
+
+#ifndef HW_FAKE_H_
+#define HW_FAKE_H_
+
+#include <stdint.h>
+#include "bool.h"
+
+/**
+ * libopencm3 ports and pins used in config_hw.h
+ * @{
+ */
+#define GPIOA  0x0a
+#define GPIOB  0x0b
+#define GPIOC  0x0c
+#define GPIO2  (1 << 2)
+#define GPIO3  (1 << 3)
+#define GPIO4  (1 << 4)
+#define GPIO5  (1 << 5)
+#define GPIO7  (1 << 7)
+#define GPIO13 (1 << 13)
+#define GPIO14 (1 << 14)
+#define GPIO15 (1 << 15)
+#define SPI1   0x1
+#define SPI2   0x2
+#define USART1 0x1
+/**
+ * @}
+ */
+
+/**
+ * FreeRTOS time, base type and task handle definitions
+ * @{
+ */
+typedef uint32_t TickType_t;
+typedef uint32_t UBaseType_t;
+typedef void *TaskHandle_t;
+#define portMAX_DELAY (TickType_t)0xffffffffUL
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+/**
+ * @}
+ */
+
+/**
+ * recorded spi traffic
+ */
+typedef struct //vera++ blamed for single space
+{
+    uint32_t transactions;  /** DC line writes, one per command or data burst */
+    uint32_t transfers;     /** calls of spi send functions */
+    uint32_t dma_transfers; /** started dma transfers */
+    uint32_t bytes;         /** all sent bytes */
+    uint32_t cmd_bytes;     /** bytes sent with DC=0 */
+    uint32_t data_bytes;    /** bytes sent with DC=1 */
+    uint32_t frames;        /** spi frames (DR writes), 8 or 16 bit */
+} fake_spi_stats_t;
+
+/**
+ * spi clock for estimation of transfer time, Hz
+ */
+#define FAKE_SPI_CLOCK 18000000UL
+
+/**
+ * cost of transaction: wait for end of transfer and DC line switch, ns
+ */
+#define FAKE_SPI_TRANSACTION_NS 1000UL
+
+/**
+ * source of received bytes, called for every clocked byte
+ * @return byte on data line
+ */
+typedef uint8_t (*fake_spi_source_t)(void);
+
+/**
+ * receiver of every sent byte
+ * @param byte - sent byte
+ * @param data - DC line state, FALSE for command
+ */
+typedef void (*fake_spi_sink_t)(uint8_t byte, boolean data);
+
+/**
+ * spi traffic counters
+ */
+extern fake_spi_stats_t fake_spi_stats;
+
+/**
+ * byte receiver, NULL if not used
+ */
+extern fake_spi_sink_t fake_spi_sink;
+
+/**
+ * byte source for spi receive, NULL gives idle line (0xff)
+ */
+extern fake_spi_source_t fake_spi_source;
+
+/**
+ * if TRUE, dma transfers never end and waiting will timeout
+ */
+extern boolean fake_spi_dma_hang;
+
+/**
+ * max spi clock of reliable link, Hz, 0 - no limit
+ *
+ * Above it some pixel data bytes are corrupted, as on long wires.
+ */
+extern uint32_t fake_spi_max_hz;
+
+/**
+ * @brief reset spi counters, bus parameters and dma state
+ */
+void fake_spi_reset(void);
+
+/**
+ * @brief end active dma transfer as from dma interrupt
+ */
+void fake_spi_dma_irq(void);
+
+/**
+ * @brief estimated time of recorded spi traffic
+ * @return microseconds at {@link #FAKE_SPI_CLOCK}
+ */
+uint32_t fake_spi_time_us(void);
+
+/**
+ * @brief time of spi traffic at configured clock since start
+ * @return milliseconds
+ */
+uint32_t hw_time_ms(void);
+
+/**
+ * @brief spend cpu time, dma transfers go on meanwhile
+ * @param ns - time of work
+ */
+void fake_cpu_work(uint32_t ns);
+
+/**
+ * @brief cpu time line since {@link #fake_spi_reset}
+ * @return microseconds
+ */
+uint32_t fake_wall_us(void);
+
+/**
+ * bytes of captured uart output
+ */
+#define FAKE_UART_SIZE 4096
+
+/**
+ * uart output since {@link #fake_uart_reset}, null-terminated, bytes
+ * beyond FAKE_UART_SIZE are not stored
+ */
+extern char fake_uart_out[FAKE_UART_SIZE + 1];
+
+/**
+ * bytes sent to uart since {@link #fake_uart_reset}
+ */
+extern uint32_t fake_uart_sent;
+
+/**
+ * @brief forget captured uart output
+ */
+void fake_uart_reset(void);
+
+// dummy realisation for tests.c
+void send_char(char c);
+void send_string(const char s[]);
+void init_gpio(void);
+void delay_ms(uint16_t ms);
+void gpio_set(uint32_t gpioport, uint16_t gpios);
+void gpio_clear(uint32_t gpioport, uint16_t gpios);
+
+#endif
+
+/** @}*/
@@ -13,10 +13,13 @@
 #include <libopencm3/cm3/nvic.h>
 #include <libopencm3/stm32/timer.h>
 #include <libopencm3/stm32/gpio.h>
+#include <libopencm3/stm32/spi.h>
+#include <libopencm3/stm32/exti.h>
 #include "FreeRTOS.h"
 #include "rtos/queue.h"
 #include "bool.h"
 #include "hw.h"
+#include "display.h"
 
 /*void wwdg_isr(void)
 {
@@ -246,6 +249,48 @@ void exti15_10_isr(void)
 //void can2_rx1_isr(void)
 //void can2_sce_isr(void)
 //void otg_fs_isr(void)
+
+/**
+ * @brief SPI1 tx dma interrupt
+ */
+void dma1_channel3_isr(void)
+{
+    spi_dma_irq_handler(SPI1);
+}
+
+/**
+ * @brief SPI2 tx dma interrupt
+ */
+void dma1_channel5_isr(void)
+{
+    spi_dma_irq_handler(SPI2);
+}
+
+/**
+ * @brief uart transmit dma interrupt
+ */
+void dma1_channel4_isr(void)
+{
+    uart_tx_irq_handler();
+}
+
+/**
+ * @brief uart receive interrupt
+ */
+void usart1_isr(void)
+{
+    uart_rx_irq_handler();
+}
+
+/**
+ * @brief display TE pulse interrupt
+ */
+void exti4_isr(void)
+{
+    exti_reset_request(ST7789_TE_EXTI);
+    display_te_irq();
+}
+
 void hard_fault_handler(void)
 {
     send_string("--- hard_fault_handler int ---\r\n");
@@ -0,0 +1,117 @@
+/** @weakgroup hardware
+ *  @{
+ */
+/**
+ * @file image.c
+ * @brief packed RGB565 images and their streaming decoder
+ *
+ * Copyright 2020 Stanislav V. Vlasov <stanislav.v.v@gmail.com>
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include "image.h"
+
+/**
+ * @brief start decoding of image
+ * @param dec - decoder state
+ * @param img - image
+ */
+void image_decode_start(image_decoder_t *dec, const image_t *img)
+{
+    dec->p = img->data;
+    dec->end = img->data + img->size;
+    dec->prev = 0;
+    dec->run = 0;
+    for (uint16_t i = 0; i < IMAGE_INDEX_SIZE; i++)
+    {
+        dec->index[i] = 0;
+    }
+}
+
+/**
+ * @brief change channels of color, every channel wraps around
+ * @param c - RGB565 color
+ * @param dr, dg, db - changes of channels
+ * @return new color
+ */
+static inline uint16_t image_add(uint16_t c, int16_t dr, int16_t dg, int16_t db)
+{
+    uint16_t r = (uint16_t)(((c >> 11) + dr) & 0x1f);
+    uint16_t g = (uint16_t)((((c >> 5) & 0x3f) + dg) & 0x3f);
+    uint16_t b = (uint16_t)(((c & 0x1f) + db) & 0x1f);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+/**
+ * @brief decode next pixels
+ * @param dec - decoder state
+ * @param dst - RGB565 pixels
+ * @param pixels - count of pixels
+ * @return count of decoded pixels, less than requested at end of data
+ */
+uint16_t image_decode(image_decoder_t *dec, uint16_t *dst, uint16_t pixels)
+{
+    uint16_t n = 0;
+    uint16_t c = dec->prev;
+
+    while (n < pixels)
+    {
+        if (dec->run == 0)
+        {
+            uint8_t op;
+            if (dec->p >= dec->end)
+            {
+                break;
+            }
+            op = *dec->p++;
+            if (op == IMAGE_OP_COLOR)
+            {
+                if (dec->end - dec->p < 2)
+                {
+                    dec->p = dec->end;
+                    break;
+                }
+                c = (uint16_t)((dec->p[0] << 8) | dec->p[1]);
+                dec->p += 2;
+            }
+            else if ((op & IMAGE_OP_MASK) == IMAGE_OP_INDEX)
+            {
+                c = dec->index[op];
+            }
+            else if ((op & IMAGE_OP_MASK) == IMAGE_OP_DIFF)
+            {
+                c = image_add(c, (int16_t)(((op >> 4) & 3) - 2),
+                              (int16_t)(((op >> 2) & 3) - 2), (int16_t)((op & 3) - 2));
+            }
+            else if ((op & IMAGE_OP_MASK) == IMAGE_OP_LUMA)
+            {
+                int16_t dg = (int16_t)((op & 0x3f) - 32);
+                uint8_t rb;
+                if (dec->p >= dec->end)
+                {
+                    break;
+                }
+                rb = *dec->p++;
+                c = image_add(c, (int16_t)(dg / 2 + (rb >> 4) - 8), dg,
+                              (int16_t)(dg / 2 + (rb & 0x0f) - 8));
+            }
+            else
+            {
+                dec->run = (uint8_t)((op & 0x3f) + 1);
+            }
+            if (dec->run == 0)
+            {
+                dec->index[IMAGE_HASH(c)] = c;
+                dec->run = 1;
+            }
+        }
+        dec->run--;
+        *dst++ = c;
+        n++;
+    }
+    dec->prev = c;
+    return n;
+}
+
+/** @}*/
@@ -0,0 +1,111 @@
+/** @weakgroup hardware
+ *  @{
+ */
+/**
+ * @file image.h
+ * @brief packed RGB565 images and their streaming decoder
+ *
+ * Copyright 2020 Stanislav V. Vlasov <stanislav.v.v@gmail.com>
+ *
+ * Format is QOI-like, adapted to RGB565. Every pixel is one of:
+ *
+ * | code       | bytes | pixel                                            |
+ * |------------|-------|--------------------------------------------------|
+ * | 00iiiiii   | 1     | color from index of recent colors                |
+ * | 01rrggbb   | 1     | previous color, r, g, b changed by -2..1         |
+ * | 10gggggg   | 2     | g changed by -32..31, next byte: r-g/2, b-g/2    |
+ * | 11llllll   | 1     | run of previous color, 1..62 pixels              |
+ * | 11111110   | 3     | color, high byte first                           |
+ *
+ * Green has one bit more than red and blue, so their changes in 2-byte
+ * op are stored relative to half of green change, in range -8..7.
+ * Every decoded color except runs is put into index at {@link #IMAGE_HASH}.
+ * Previous color is 0 at start, index is zeroed.
+ */
+
+#ifndef IMAGE_H_
+#define IMAGE_H_
+
+#include <stdint.h>
+
+/**
+ * ops of packed image
+ * @{
+ */
+#define IMAGE_OP_INDEX 0x00
+#define IMAGE_OP_DIFF  0x40
+#define IMAGE_OP_LUMA  0x80
+#define IMAGE_OP_RUN   0xc0
+#define IMAGE_OP_COLOR 0xfe
+#define IMAGE_OP_MASK  0xc0
+/**
+ * @}
+ */
+
+/**
+ * size of index of recent colors
+ */
+#define IMAGE_INDEX_SIZE 64
+
+/**
+ * max length of run
+ */
+#define IMAGE_MAX_RUN 62
+
+/**
+ * position of RGB565 color in index
+ */
+#define IMAGE_HASH(c) \
+    ((((c) >> 11) * 3 + (((c) >> 5) & 0x3f) * 5 + ((c) & 0x1f) * 7) % IMAGE_INDEX_SIZE)
+
+/**
+ * packed image in flash
+ */
+typedef struct //vera++ blamed for single space
+{
+    uint16_t width;
+    uint16_t height;
+    uint32_t size;          /** bytes of data */
+    const uint8_t *data;
+} image_t;
+
+/**
+ * state of decoder between calls
+ */
+typedef struct //vera++ blamed for single space
+{
+    const uint8_t *p;       /** next byte */
+    const uint8_t *end;     /** end of data */
+    uint16_t prev;          /** previous color */
+    uint8_t run;            /** pixels left in current run */
+    uint16_t index[IMAGE_INDEX_SIZE];
+} image_decoder_t;
+
+/**
+ * @brief start decoding of image
+ * @param dec - decoder state
+ * @param img - image
+ */
+void image_decode_start(image_decoder_t *dec, const image_t *img);
+
+/**
+ * @brief decode next pixels
+ * @param dec - decoder state
+ * @param dst - RGB565 pixels
+ * @param pixels - count of pixels
+ * @return count of decoded pixels, less than requested at end of data
+ */
+uint16_t image_decode(image_decoder_t *dec, uint16_t *dst, uint16_t pixels);
+
+/**
+ * packed images, made by imgconv from images_raw.c
+ * @{
+ */
+extern const image_t image_saber;
+/**
+ * @}
+ */
+
+#endif
+
+/** @}*/
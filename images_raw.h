@@ -0,0 +1,30 @@
+/**
+ * @file images_raw.h
+ * @brief source RGB565 images for image compiler
+ *
+ * Copyright https://github.com/Floyd-Fish/ST7789-STM32
+ *
+ */
+#ifndef IMAGES_RAW_H_
+#define IMAGES_RAW_H_
+
+#include <stdint.h>
+
+//16-bit(RGB565) Image lib.
+/*******************************************
+ *             CAUTION:
+ *   If the MCU onchip flash cannot
+ *  store such huge image data,please
+ *           do not use it.
+ * These pics are for test purpose only.
+ *******************************************/
+
+/* 128x128 pixel RGB565 image */
+extern const uint16_t saber[][128];
+
+/* 240x240 pixel RGB565 image
+extern const uint16_t knky[][240];
+extern const uint16_t tek[][240];
+extern const uint16_t adi1[][240];
+*/
+#endif
@@ -0,0 +1,156 @@
+/** @weakgroup tools
+ *  @{
+ */
+/**
+ * @file imgconv.c
+ * @brief image compiler, packs images_raw.c into format of image.h
+ *
+ * Copyright 2020 Stanislav V. Vlasov <stanislav.v.v@gmail.com>
+ *
+ * Runs on build host, C source of packed images is written to stdout.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include "image.h"
+#include "images_raw.h"
+
+/**
+ * image to convert
+ */
+typedef struct //vera++ blamed for single space
+{
+    const char *name;       /** name of image_t */
+    const uint16_t *raw;    /** pixels in spi byte order of little endian cpu */
+    uint16_t width;
+    uint16_t height;
+} imgconv_src_t;
+
+static const imgconv_src_t imgconv_list[] =
+{
+    {"image_saber", &saber[0][0], 128, 128},
+};
+
+/**
+ * packed data of current image
+ * @{
+ */
+static uint8_t imgconv_data[4 * 320 * 240];
+static uint32_t imgconv_size = 0;
+/**
+ * @}
+ */
+
+/**
+ * @brief add byte to packed data
+ * @param b - byte
+ */
+static void imgconv_put(uint8_t b)
+{
+    imgconv_data[imgconv_size++] = b;
+}
+
+/**
+ * @brief wrap difference of channel into signed range
+ * @param d - difference
+ * @param bits - bits of channel
+ * @return difference in -2^(bits-1)..2^(bits-1)-1
+ */
+static int imgconv_wrap(int d, int bits)
+{
+    int m = 1 << bits;
+    d = ((d % m) + m) % m;
+    return d >= m / 2 ? d - m : d;
+}
+
+/**
+ * @brief pack one image
+ * @param src - image
+ */
+static void imgconv_pack(const imgconv_src_t *src)
+{
+    uint16_t index[IMAGE_INDEX_SIZE] = {0};
+    uint16_t prev = 0;
+    uint32_t run = 0;
+    uint32_t count = (uint32_t)src->width * src->height;
+
+    imgconv_size = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint16_t c = (uint16_t)((src->raw[i] >> 8) | (src->raw[i] << 8));
+        if (c == prev)
+        {
+            run++;
+            if ((run == IMAGE_MAX_RUN) || (i == count - 1))
+            {
+                imgconv_put((uint8_t)(IMAGE_OP_RUN | (run - 1)));
+                run = 0;
+            }
+            continue;
+        }
+        if (run)
+        {
+            imgconv_put((uint8_t)(IMAGE_OP_RUN | (run - 1)));
+            run = 0;
+        }
+
+        uint16_t h = IMAGE_HASH(c);
+        if (index[h] == c)
+        {
+            imgconv_put((uint8_t)(IMAGE_OP_INDEX | h));
+        }
+        else
+        {
+            int dr = imgconv_wrap((c >> 11) - (prev >> 11), 5);
+            int dg = imgconv_wrap(((c >> 5) & 0x3f) - ((prev >> 5) & 0x3f), 6);
+            int db = imgconv_wrap((c & 0x1f) - (prev & 0x1f), 5);
+            int dr_dg = imgconv_wrap(dr - dg / 2, 5);
+            int db_dg = imgconv_wrap(db - dg / 2, 5);
+
+            index[h] = c;
+            if ((dr >= -2) && (dr <= 1) && (dg >= -2) && (dg <= 1) &&
+                (db >= -2) && (db <= 1))
+            {
+                imgconv_put((uint8_t)(IMAGE_OP_DIFF | ((dr + 2) << 4) |
+                                      ((dg + 2) << 2) | (db + 2)));
+            }
+            else if ((dr_dg >= -8) && (dr_dg <= 7) && (db_dg >= -8) && (db_dg <= 7))
+            {
+                imgconv_put((uint8_t)(IMAGE_OP_LUMA | (dg + 32)));
+                imgconv_put((uint8_t)(((dr_dg + 8) << 4) | (db_dg + 8)));
+            }
+            else
+            {
+                imgconv_put(IMAGE_OP_COLOR);
+                imgconv_put((uint8_t)(c >> 8));
+                imgconv_put((uint8_t)(c & 0xff));
+            }
+        }
+        prev = c;
+    }
+}
+
+int main(void)
+{
+    printf("/* packed images, made by imgconv from images_raw.c, do not edit */\n");
+    printf("#include \"image.h\"\n");
+    for (unsigned i = 0; i < sizeof(imgconv_list) / sizeof(imgconv_list[0]); i++)
+    {
+        const imgconv_src_t *src = &imgconv_list[i];
+        imgconv_pack(src);
+
+        printf("\nstatic const uint8_t %s_data[%u] =\n{", src->name, imgconv_size);
+        for (uint32_t j = 0; j < imgconv_size; j++)
+        {
+            printf("%s0x%02x,", (j % 16) ? " " : "\n    ", imgconv_data[j]);
+        }
+        printf("\n};\n");
+        printf("\nconst image_t %s = {%u, %u, %u, %s_data};\n", src->name,
+               src->width, src->height, imgconv_size, src->name);
+        fprintf(stderr, "%-10s %6u bytes, packed %6u bytes\n", src->name,
+                (unsigned)(src->width * src->height * sizeof(uint16_t)), imgconv_size);
+    }
+    return 0;
+}
+
+/** @}*/
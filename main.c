@@ -18,6 +18,7 @@
 #include "hw.h"
 
 #include "shell.h"
+#include "display.h"
 
 #if(  configCHECK_FOR_STACK_OVERFLOW > 0 )
 /**
@@ -44,6 +45,7 @@ int main(void)
 
     init_gpio();
 
+    display_start();
     xTaskCreate(task_process_shell, "shell", 500, NULL, 1, NULL);
     vTaskStartScheduler();
 
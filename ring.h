@@ -0,0 +1,108 @@
+/** @weakgroup utils
+ *  @{
+ */
+/**
+ * @file ring.h
+ * @brief lock-free byte ring for one producer and one consumer
+ *
+ * Copyright 2020 Stanislav V. Vlasov <stanislav.v.v@gmail.com>
+ *
+ * Producer (interrupt) writes only head, consumer (task) writes only
+ * tail, so no lock is needed. Indexes run freely and are masked on
+ * access, so all slots are used. Barriers keep data and index stores
+ * in order on the other side.
+ */
+
+#ifndef RING_H_
+#define RING_H_
+
+#include <stdint.h>
+#include "bool.h"
+
+/**
+ * memory barrier between data and index accesses
+ */
+#define RING_BARRIER() __sync_synchronize()
+
+/**
+ * byte ring, size is power of two up to 32768
+ */
+typedef struct //vera++ blamed for single space
+{
+    uint8_t *data;              /** storage */
+    uint16_t mask;              /** size - 1 */
+    volatile uint16_t head;     /** next byte to write, written by producer */
+    volatile uint16_t tail;     /** next byte to read, written by consumer */
+} ring_t;
+
+/**
+ * @brief init empty ring
+ * @param r - ring
+ * @param data - storage
+ * @param size - bytes of storage, power of two
+ */
+static inline void ring_init(ring_t *r, uint8_t *data, uint16_t size)
+{
+    r->data = data;
+    r->mask = (uint16_t)(size - 1);
+    r->head = 0;
+    r->tail = 0;
+}
+
+/**
+ * @brief count of bytes in ring
+ * @param r - ring
+ * @return bytes, exact for caller side, may grow or shrink by other one
+ */
+static inline uint16_t ring_count(const ring_t *r)
+{
+    return (uint16_t)(r->head - r->tail);
+}
+
+/**
+ * @brief put byte, for producer only
+ * @param r - ring
+ * @param byte - byte
+ * @return FALSE if ring is full and byte is dropped
+ */
+static inline boolean ring_put(ring_t *r, uint8_t byte)
+{
+    uint16_t head = r->head;
+
+    if ((uint16_t)(head - r->tail) > r->mask)
+    {
+        return FALSE;
+    }
+    r->data[head & r->mask] = byte;
+    /* byte is stored before it is shown to consumer */
+    RING_BARRIER();
+    r->head = (uint16_t)(head + 1);
+    return TRUE;
+}
+
+/**
+ * @brief get byte, for consumer only
+ * @param r - ring
+ * @param byte - destination
+ * @return FALSE if ring is empty
+ */
+static inline boolean ring_get(ring_t *r, uint8_t *byte)
+{
+    uint16_t tail = r->tail;
+
+    if (r->head == tail)
+    {
+        return FALSE;
+    }
+    /* head is read before the byte behind it */
+    RING_BARRIER();
+    *byte = r->data[tail & r->mask];
+    /* byte is read before slot is given back to producer */
+    RING_BARRIER();
+    r->tail = (uint16_t)(tail + 1);
+    return TRUE;
+}
+
+#endif
+
+/** @}*/
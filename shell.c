@@ -16,19 +16,13 @@
 #include "shell.h"
 
 /**
- * @brief send content of {@link #shell_output_buffer} to uart
- * will send to uart {@link #shell_output_buffer} and clean
- * {@link #shell_input_buffer} and {@link #shell_output_buffer}
+ * @brief end shell output and clean input
+ * will send to uart rest of shell output and clean
+ * {@link #shell_input_buffer}
  */
 void shell_send_result(void)
 {
-#if SHELL_ECHO==1
-    send_string("\r\n"); // shift output down
-#endif
-    send_string(shell_output_buffer);
-    /* cleaning */
-    shell_out_lastchar = 0;
-    shell_output_buffer[0] = 0;
+    shell_out_flush();
     shell_in_lastchar = 0;
     shell_input_buffer[0] = 0;
 }
@@ -37,33 +31,37 @@ void shell_send_result(void)
  * @addtogroup rtos
  * @brief shell processing rtos task
  * @param args - no parameters used
+ *
+ * Task sleeps until uart interrupt gives received char.
  */
 void task_process_shell(void *args __attribute((unused)))
 {
     send_string("shell started\r\n");
+    if (!shell_cmd_check())
+    {
+        send_string("shell: command table is not sorted\r\n");
+    }
+    /* output of commands goes to uart by chunks */
+    shell_out_set_sink(send_buffer);
     for (;;)
     {
-        if (char_is_recv())
+        char c;
+        if (uart_recv(&c, portMAX_DELAY) != 0)
         {
-            char c = recv_char();
+            continue;
+        }
 #if SHELL_ECHO==1
-            send_char(c);
+        send_char(c);
 #endif
-            if (c != 0xa && c != 0xd && shell_in_buffer_add(c))
-            {
-                taskYIELD();
-            }
-            else
-            {
-                // at end of line or buffer overflow - process string
-                // and send result.
-                shell_process();
-                shell_send_result();
-            }
-        }
-        else
+        if (c == 0xa || c == 0xd || !shell_in_buffer_add(c))
         {
-            taskYIELD();
+            // at end of line or buffer overflow - process string
+            // and send result.
+#if SHELL_ECHO==1
+            send_string("\r\n"); // shift output down
+#endif
+            shell_process();
+            shell_send_result();
         }
     }
 }
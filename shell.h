@@ -18,9 +18,9 @@
 void task_process_shell(void *args __attribute((unused)));
 
 /**
- * @brief send content of {@link #shell_output_buffer} to uart
- * will send to uart {@link #shell_output_buffer} and clean
- * {@link #shell_input_buffer} and {@link #shell_output_buffer}
+ * @brief end shell output and clean input
+ * will send to uart rest of shell output and clean
+ * {@link #shell_input_buffer}
  */
 void shell_send_result(void);
 
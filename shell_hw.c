@@ -20,15 +20,11 @@
 
 #include "FreeRTOS.h"
 #include "st7789.h"
+#include "display.h"
 
 // for spi debug command
 #include <libopencm3/stm32/spi.h>
 
-/**
- * lcd initialization flag
- */
-boolean lcd_inited = FALSE;
-
 #endif
 
 /**
@@ -63,11 +59,11 @@ void shell_led_state(char* argv[], uint16_t argc)
     (void)(argc);
     if (LED_state() == 0)
     {
-        shell_out_buffer_add("LED on\r\n");
+        shell_out_const("LED on\r\n");
     }
     else
     {
-        shell_out_buffer_add("LED off\r\n");
+        shell_out_const("LED off\r\n");
     }
 }
 
@@ -98,81 +94,209 @@ void shell_led(char* argv[], uint16_t argc)
 #ifndef UNITTEST
 // Can't be tested without uC
 
+/**
+ * @brief add counter line to shell buffer
+ * @param name - counter name, constant string
+ * @param n - value
+ */
+static void shell_lcd_counter(const char *name, uint32_t n)
+{
+    char s[20] = "\0";
+    itoa_u32(n, s);
+    shell_out_const(name);
+    shell_out_buffer_add(s);
+    shell_out_const("\r\n");
+}
+
+/**
+ * @brief post test screen of lcdtest
+ * @return errno - 0 (posted), EBUSY (queue is full)
+ */
+static uint16_t shell_lcd_scene(void)
+{
+    uint16_t err = 0;
+
+    err |= display_fill(0, 0, ST7789_WIDTH - 1, ST7789_HEIGHT - 1, WHITE);
+    err |= display_text(10, 10, "Font test.", &Font_16x26, GBLUE, WHITE);
+    err |= display_text(10, 50, "Hello Steve!", &Font_7x10, RED, WHITE);
+    err |= display_text(10, 75, "Hello Steve!", &Font_11x18, YELLOW, WHITE);
+    err |= display_image(0, 100, &image_saber);
+    return err;
+}
+
 /**
  * @brief start lcd test
- * @param argv, argc - any may be given, none used
+ * @param argv, argc - 'check' draws test screen and reads back every
+ *                     command, 'verify [rounds]' posts test of display
+ *                     link by read back, 'result' shows their counters
+ *
+ * Drawing is posted to render task, command returns at once.
  */
 void shell_lcd_test(char* argv[], uint16_t argc)
 {
-    (void)(argv);
-    (void)(argc);
-    send_string("lcdtest begin\r\n");
-    if (!lcd_inited)
+    uint16_t err = 0;
+
+    if ((argc > 0) && compare_strings(argv[0], "verify"))
+    {
+        uint16_t rounds = 1;
+        if ((argc > 1) && (!atoi_u16(argv[1], &rounds) || (rounds == 0) || (rounds > 1000)))
+        {
+            shell_out_const("USAGE: lcdtest verify [1..1000]\r\n");
+            return;
+        }
+        shell_out_const(display_verify(rounds) ? "lcd queue is full\r\n" :
+                             "lcd verify posted\r\n");
+        return;
+    }
+    if ((argc > 0) && compare_strings(argv[0], "result"))
+    {
+        const st7789_verify_t *v = &display_verify_result;
+        const st7789_check_t *c = &display_check_result;
+        shell_lcd_counter("rounds: ", v->rounds);
+        shell_lcd_counter("crc errors: ", v->errors);
+        shell_lcd_counter("status errors: ", v->status_errors);
+        if (v->rounds != 0)
+        {
+            shell_out_const(((v->status & ST7789_STATUS_CHECK) == ST7789_STATUS_RUNNING) ?
+                                 "panel running\r\n" : "panel not running\r\n");
+        }
+        shell_lcd_counter("checked: ", c->checked);
+        shell_lcd_counter("check errors: ", c->errors);
+        shell_lcd_counter("check skipped: ", c->skipped);
+        return;
+    }
+    if ((argc > 0) && compare_strings(argv[0], "check"))
+    {
+        err |= display_check(TRUE);
+        err |= shell_lcd_scene();
+        err |= display_check(FALSE);
+        shell_out_const(err ? "lcd queue is full\r\n" : "lcd check posted\r\n");
+        return;
+    }
+    err |= shell_lcd_scene();
+    shell_out_const(err ? "lcd queue is full\r\n" : "lcd test posted\r\n");
+}
+
+/**
+ * @brief set frame rate cap of display and show frame stats
+ * @param argv, argc - optional fps, 0 switches TE sync off
+ */
+void shell_lcd_sync(char* argv[], uint16_t argc)
+{
+    if (argc > 0)
+    {
+        uint16_t fps = 0;
+        if (!atoi_u16(argv[0], &fps) || (fps > 255) || display_sync((uint8_t)fps))
+        {
+            shell_out_const("fps must be 0..60\r\n");
+        }
+    }
+    shell_lcd_counter("te: ", display_stats.te);
+    shell_lcd_counter("frames: ", display_stats.frames);
+    shell_lcd_counter("missed: ", display_stats.missed);
+    shell_lcd_counter("unsynced: ", display_stats.unsynced);
+    shell_lcd_counter("coalesced: ", display_stats.coalesced);
+}
+
+/**
+ * @brief show spi link to display and may calibrate it
+ * @param argv, argc - 'cal' posts calibration, screen is cleared by it
+ */
+void shell_lcd_spi(char* argv[], uint16_t argc)
+{
+    if ((argc > 0) && compare_strings(argv[0], "cal"))
     {
-        send_string("lcd init... ");
-        ST7789_Init();
-        lcd_inited = TRUE;
-        send_string("done\r\n");
+        shell_out_const(display_calibrate() ? "lcd queue is full\r\n" :
+                             "lcd calibration posted\r\n");
+        return;
     }
-    send_string("lcd testing...\r\n");
-    ST7789_Test();
-    send_string("lcd end\r\n");
+    if (display_link.clock_hz == 0)
+    {
+        shell_out_const("lcd spi is not calibrated\r\n");
+        return;
+    }
+    shell_lcd_counter("baudrate: ", display_link.baudrate);
+    shell_lcd_counter("clock, Hz: ", display_link.clock_hz);
+    shell_lcd_counter("fill, pixels/s: ", display_link.fill_rate);
+}
+
+/**
+ * @brief add spi register line to shell output
+ * @param name - register name, constant string
+ * @param data - register value, low 16 bits are shown
+ */
+static void shell_spi_reg(const char *name, uint32_t data)
+{
+    char s[20] = "\0";
+    i2bin(data, s, 4);
+    shell_out_const(name);
+    shell_out_const(": ");
+    shell_out_buffer_add(s);
+    shell_out_const("\r\n");
 }
 
 /**
  * @brief show spi registers and may test spi transfer
  * @param argv, argc 'test' will be test spi transfer
+ *
+ * Progress of test is flushed to uart before every sequence.
  */
 void shell_spi_command(char* argv[], uint16_t argc)
 {
-    send_string("spi regs:\r\n");
+    shell_out_const("spi regs:\r\n");
     uint32_t cr1 = SPI_CR1(ST7789_SPI);
     uint32_t cr2 = SPI_CR2(ST7789_SPI);
     uint32_t sr = SPI_SR(ST7789_SPI);
     uint32_t dr = SPI_DR(ST7789_SPI);
     uint32_t i2scfgr = SPI_I2SCFGR(ST7789_SPI);
-    send_named_bin("CR1", cr1, 4);
-    send_named_bin("CR2", cr2, 4);
-    send_named_bin(" SR", sr, 4);
-    send_named_bin(" DR", dr, 4);
-    send_named_bin("i2s", i2scfgr, 4);
+    shell_spi_reg("CR1", cr1);
+    shell_spi_reg("CR2", cr2);
+    shell_spi_reg(" SR", sr);
+    shell_spi_reg(" DR", dr);
+    shell_spi_reg("i2s", i2scfgr);
     if (argc > 0)
     {
         if (compare_strings(argv[0], "test"))
         {
-            send_string("sending test sequence 0... ");
+            shell_out_const("sending test sequence 0... ");
+            shell_out_flush();
             for (uint16_t i = 0; i<=65534; i++)
             {
                 spi_send(ST7789_SPI, 0);
             }
-            send_string("0xff... ");
+            shell_out_const("0xff... ");
+            shell_out_flush();
             for (uint16_t i = 0; i<=65534; i++)
             {
                 spi_send(ST7789_SPI, 0xff);
             }
-            send_string("0x55... ");
+            shell_out_const("0x55... ");
+            shell_out_flush();
             for (uint16_t i = 0; i<=65534; i++)
             {
                 spi_send(ST7789_SPI, 0x55);
             }
-            send_string("0xAA... ");
+            shell_out_const("0xAA... ");
+            shell_out_flush();
             for (uint16_t i = 0; i<=65534; i++)
             {
                 spi_send(ST7789_SPI, 0xAA);
             }
-            send_string("0x0F... ");
+            shell_out_const("0x0F... ");
+            shell_out_flush();
             for (uint16_t i = 0; i<=65534; i++)
             {
                 spi_send(ST7789_SPI, 0x0F);
             }
-            send_string("0xF0... ");
+            shell_out_const("0xF0... ");
+            shell_out_flush();
             for (uint16_t i = 0; i<=65534; i++)
             {
                 spi_send(ST7789_SPI, 0xF0);
             }
         }
     }
-    send_string("end\r\n");
+    shell_out_const("end\r\n");
 }
 
 /**
@@ -185,23 +309,23 @@ void shell_rtos_heap_cmd(char* argv[], uint16_t argc)
     (void)(argc);
     HeapStats_t stats;
     char s[20] = "\0";
-    shell_out_buffer_add("rtos heap stats:");
+    shell_out_const("rtos heap stats:");
     vPortGetHeapStats(&stats);
 
     itoa_u16((uint16_t)stats.xAvailableHeapSpaceInBytes, s);
-    shell_out_buffer_add("Avail: ");
+    shell_out_const("Avail: ");
     shell_out_buffer_add(s);
-    shell_out_buffer_add("\r\n");
+    shell_out_const("\r\n");
 
     itoa_u16((uint16_t)stats.xSizeOfLargestFreeBlockInBytes, s);
-    shell_out_buffer_add("Largest free block bytes: ");
+    shell_out_const("Largest free block bytes: ");
     shell_out_buffer_add(s);
-    shell_out_buffer_add("\r\n");
+    shell_out_const("\r\n");
 
     itoa_u16((uint16_t)stats.xMinimumEverFreeBytesRemaining, s);
-    shell_out_buffer_add("Min free bytes: ");
+    shell_out_const("Min free bytes: ");
     shell_out_buffer_add(s);
-    shell_out_buffer_add("\r\n");
+    shell_out_const("\r\n");
 }
 
 
@@ -48,10 +48,23 @@ void shell_led(char* argv[], uint16_t argc);
 
 /**
  * @brief start lcd test
- * @param argv, argc - any may be given, none used
+ * @param argv, argc - 'verify [rounds]' posts test of display link by
+ *                     read back, 'result' shows its counters
  */
 void shell_lcd_test(char* argv[], uint16_t argc);
 
+/**
+ * @brief set frame rate cap of display and show frame stats
+ * @param argv, argc - optional fps, 0 switches TE sync off
+ */
+void shell_lcd_sync(char* argv[], uint16_t argc);
+
+/**
+ * @brief show spi link to display and may calibrate it
+ * @param argv, argc - 'cal' posts calibration, screen is cleared by it
+ */
+void shell_lcd_spi(char* argv[], uint16_t argc);
+
 /**
  * @brief show spi registers and may test spi transfer
  * @param argv, argc 'test' will be test spi transfer
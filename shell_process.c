@@ -9,22 +9,17 @@
  *
  */
 
+#include <errno.h>
 #include <stdint.h>
 #include <stdio.h>
 #include "bool.h"
 #include "strings_local.h"
 #include "shell_process.h"
 
-#ifndef UNITTEST
-
-#include "shell_hw.h"
-
-#endif
-
 /**
- * shell input buffer, received from uart
+ * shell input buffer, received from uart, with place for terminating zero
  */
-char shell_input_buffer[SHELL_MAX_CLI_LENGTH] = "\0";
+char shell_input_buffer[SHELL_MAX_CLI_LENGTH + 1] = "\0";
 
 /**
  * shell input buffer length
@@ -32,7 +27,7 @@ char shell_input_buffer[SHELL_MAX_CLI_LENGTH] = "\0";
 uint16_t shell_in_lastchar = 0;
 
 /**
- * shell output buffer, will be sent to uart
+ * shell output buffer, given to sink by chunks
  */
 char shell_output_buffer[SHELL_MAX_OUT_LENGTH] = "\0";
 
@@ -41,64 +36,89 @@ char shell_output_buffer[SHELL_MAX_OUT_LENGTH] = "\0";
  */
 uint16_t shell_out_lastchar = 0;
 
+/**
+ * sink of shell output, NULL - output is kept in buffer and cut
+ */
+static shell_out_sink_t shell_out_sink = NULL;
+
 /* internal functions forward defs */
-void shell_get_cmd(char command_s[]);
-void shell_get_args(uint16_t cmdlen);
 void shell_hello_cmd(char* argv[], uint16_t argc);
+void shell_help_cmd(char* argv[], uint16_t argc);
 void args_cmd(char* argv[], uint16_t argc);
 
 /**
- * shell command handler type
- */
-typedef void (*shell_cmd_handler_t)(char* argv[], uint16_t argc);
-
-/**
- * shell command structure, used in command list
+ * @brief give buffered output to sink
  */
-typedef struct // command + function
+void shell_out_flush(void)
 {
-    const char* cmd_str;
-    shell_cmd_handler_t cmd;
-} shell_cmd_def_t;
+    if ((shell_out_sink != NULL) && (shell_out_lastchar != 0))
+    {
+        shell_out_sink(shell_output_buffer, shell_out_lastchar);
+        shell_out_lastchar = 0;
+        shell_output_buffer[0] = 0;
+    }
+}
 
 /**
- * shell commands list
+ * @brief set sink of shell output, pending output goes to old one
+ * @param sink - sink, NULL - output is kept in {@link #shell_output_buffer}
  */
-static shell_cmd_def_t cmds[] =
+void shell_out_set_sink(shell_out_sink_t sink)
 {
-    {"hello",     shell_hello_cmd},
-    {"ls",        shell_cmds},
-    {"args",      args_cmd},
-#ifndef UNITTEST
-// not include hardware functions in unit test
-
-/* functionality covered by 'led' command
-    {"led_on",    shell_led_on},
-    {"led_off",   shell_led_off},
-    {"led_state", shell_led_state},
-*/
-    {"led",       shell_led},
-    {"lcdtest",   shell_lcd_test},
-    {"spi",       shell_spi_command},
-    {"free",      shell_rtos_heap_cmd},
-#endif
-    {NULL, NULL}
-};
+    shell_out_flush();
+    shell_out_sink = sink;
+}
 
 /**
  * @brief add string to output buffer
  * @param s[] string which content will be added to {@link #shell_output_buffer}
  * @return none
+ *
+ * Full buffer is given to sink, so output has no length limit.
+ * Without sink output is cut at {@link #SHELL_MAX_OUT_LENGTH}.
  */
 void shell_out_buffer_add(const char s[])
 {
     uint16_t i = 0;
-    while (shell_out_lastchar < SHELL_MAX_OUT_LENGTH && s[i] != 0)
+    while (s[i] != 0)
     {
+        if (shell_out_lastchar >= SHELL_MAX_OUT_LENGTH)
+        {
+            if (shell_out_sink == NULL)
+            {
+                return;
+            }
+            shell_out_flush();
+        }
         shell_output_buffer[shell_out_lastchar] = s[i];
         i++;
         shell_out_lastchar++;
     }
+    if (shell_out_lastchar < SHELL_MAX_OUT_LENGTH)
+    {
+        shell_output_buffer[shell_out_lastchar] = 0;
+    }
+}
+
+/**
+ * @brief add constant string to output without copying
+ * @param s[] string which must live until it is sent
+ *
+ * Buffered output is given to sink first, then the string itself.
+ * Strings up to {@link #SHELL_OUT_COPY_MAX} chars are copied, it is
+ * cheaper than call of sink.
+ */
+void shell_out_const(const char s[])
+{
+    uint16_t len = strlen_local(s);
+
+    if ((shell_out_sink == NULL) || (len <= SHELL_OUT_COPY_MAX))
+    {
+        shell_out_buffer_add(s);
+        return;
+    }
+    shell_out_flush();
+    shell_out_sink(s, len);
 }
 
 /**
@@ -109,7 +129,7 @@ void shell_hello_cmd(char* argv[], uint16_t argc)
 {
     (void)(argv);
     (void)(argc);
-    shell_out_buffer_add("Hello world!!!\r\n");
+    shell_out_const("Hello world!!!\r\n");
 }
 
 /**
@@ -120,14 +140,102 @@ void shell_cmds(char* argv[], uint16_t argc)
 {
     (void)(argv);
     (void)(argc);
-    uint16_t i = 0;
-    shell_out_buffer_add("\r\n-- commands --\r\n");
-    while (cmds[i].cmd != NULL)
+    shell_out_const("\r\n-- commands --\r\n");
+    for (uint16_t i = 0; i < shell_cmd_count; i++)
     {
-        shell_out_buffer_add(cmds[i].cmd_str);
-        shell_out_buffer_add("\r\n");
-        i++;
+        if ((shell_cmd_table[i].flags & SHELL_CMD_HIDDEN) == 0)
+        {
+            shell_out_const(shell_cmd_table[i].cmd_str);
+            shell_out_const("\r\n");
+        }
+    }
+}
+
+/**
+ * @brief send usage of command
+ * @param argv, argc -- command name or none for all commands
+ */
+void shell_help_cmd(char* argv[], uint16_t argc)
+{
+    if (argc > 0)
+    {
+        const shell_cmd_def_t *c = shell_cmd_lookup(shell_cmd_table, shell_cmd_count, argv[0]);
+        if (c == NULL)
+        {
+            shell_out_const("UNKNOWN: ");
+            shell_out_buffer_add(argv[0]);
+            shell_out_const("\r\n");
+            return;
+        }
+        shell_out_const(c->help);
+        shell_out_const("\r\n");
+        return;
+    }
+    for (uint16_t i = 0; i < shell_cmd_count; i++)
+    {
+        if ((shell_cmd_table[i].flags & SHELL_CMD_HIDDEN) == 0)
+        {
+            shell_out_const(shell_cmd_table[i].help);
+            shell_out_const("\r\n");
+        }
+    }
+}
+
+/**
+ * @brief find command in table sorted by name
+ * @param table - commands
+ * @param count - count of commands
+ * @param name - command name
+ * @return command or NULL
+ *
+ * Binary search, log2(count) compares of names.
+ */
+const shell_cmd_def_t *shell_cmd_lookup(const shell_cmd_def_t *table, uint16_t count,
+                                        const char *name)
+{
+    uint16_t lo = 0;
+    uint16_t hi = count;
+
+    while (lo < hi)
+    {
+        uint16_t mid = (uint16_t)(lo + (hi - lo) / 2);
+        int16_t order = strcmp_local(name, table[mid].cmd_str);
+        if (order == 0)
+        {
+            return &table[mid];
+        }
+        if (order < 0)
+        {
+            hi = mid;
+        }
+        else
+        {
+            lo = (uint16_t)(mid + 1);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief check that command table is sorted and its metadata is sane
+ * @return TRUE if table is good
+ */
+boolean shell_cmd_check(void)
+{
+    for (uint16_t i = 0; i < shell_cmd_count; i++)
+    {
+        if ((shell_cmd_table[i].cmd == NULL) || (shell_cmd_table[i].help == NULL)
+            || (shell_cmd_table[i].min_args > shell_cmd_table[i].max_args)
+            || (shell_cmd_table[i].max_args > SHELL_MAX_ARGS))
+        {
+            return FALSE;
+        }
+        if ((i > 0) && (strcmp_local(shell_cmd_table[i - 1].cmd_str, shell_cmd_table[i].cmd_str) >= 0))
+        {
+            return FALSE;
+        }
     }
+    return TRUE;
 }
 
 /**
@@ -140,25 +248,26 @@ void args_cmd( char* argv[], uint16_t argc )
 {
     uint16_t i;
     char num[6];
-    shell_out_buffer_add("arguments count: ");
+    shell_out_const("arguments count: ");
     itoa_u16(argc, num);
     shell_out_buffer_add(num);
-    shell_out_buffer_add("\r\n");
+    shell_out_const("\r\n");
     for (i = 0; i< argc; ++i)
     {
-        shell_out_buffer_add("argument ");
+        shell_out_const("argument ");
         itoa_u16(i, num);
         shell_out_buffer_add(num);
-        shell_out_buffer_add(": ");
+        shell_out_const(": ");
         shell_out_buffer_add(argv[i]);
-        shell_out_buffer_add("\r\n");
+        shell_out_const("\r\n");
     }
 }
 
 /**
  * @brief clean shell output buffer
  *
- * clean {@link #shell_output_buffer} for later use
+ * clean {@link #shell_output_buffer} for later use, output not given
+ * to sink is lost
  */
 void shell_cleanup_output(void)
 {
@@ -170,78 +279,149 @@ void shell_cleanup_output(void)
 }
 
 /**
- * @brief get command name
- * @param command_s[] - command name will be place here
- * @return none
- * get first word from shell_input_buffer and place it to command_s */
-void shell_get_cmd(char command_s[])
+ * @brief check for separator of words
+ * @param c - char
+ * @return TRUE for space or tab
+ */
+static inline boolean shell_is_space(char c)
 {
-    uint16_t i = 0;
-    while (i < SHELL_MAX_CLI_LENGTH && (char)shell_input_buffer[i] != ' ')
-    {
-        command_s[i] = shell_input_buffer[i];
-        i++;
-    }
-    command_s[i] = 0;
+    return (c == ' ') || (c == '\t');
 }
 
 /**
- * @brief shell cli processing
- * see in {@link #shell_input_buffer} and run corresponding commands
- * from {@link #cmds} with parameters
+ * @brief split command line to words in place
+ * @param line - line, words are terminated by zero inside it
+ * @param argv - pointers to words will be placed here
+ * @param max - size of argv
+ * @param argc - count of words found
+ * @return errno - 0 (ok), E2BIG (more than max words, rest is not split),
+ *         EINVAL (unterminated quote or escape, last word is cut there)
+ *
+ * Words are separated by any count of spaces or tabs. Text in single
+ * quotes is taken as is, in double quotes spaces are kept, backslash
+ * takes next char as is except in single quotes. Line is read once,
+ * words are written behind read position, so nothing is copied out.
  */
-void shell_process(void)
+uint16_t shell_tokenize(char *line, char *argv[], uint16_t max, uint16_t *argc)
 {
-    char cmd[SHELL_MAX_CLI_LENGTH];
-    char *cmd_argv[SHELL_MAX_ARGS];
-    uint16_t cmd_argc = 0;
-
-    shell_cleanup_output();
-    shell_get_cmd(cmd);
-
-    /* temporary vars */
-    uint16_t known_cmd = FALSE;
-    uint16_t i = 0;
-    char c;
+    char *r = line;
+    char *w = line;
+    char quote = 0;
+    uint16_t n = 0;
+    uint16_t err = 0;
 
-    while (cmds[i].cmd != NULL)
+    while (err == 0)
     {
-        if (compare_strings(cmds[i].cmd_str, cmd))
+        while (shell_is_space(*r))
         {
-            known_cmd = TRUE;
-            uint16_t cmdpos = strlen_local(cmd);
-            /*Ok that is our function! Let's parse args*/
-            do
+            r++;
+        }
+        if (*r == '\0')
+        {
+            break;
+        }
+        if (n >= max)
+        {
+            err = E2BIG;
+            break;
+        }
+        argv[n++] = w;
+        /* one word, ends at separator out of quotes or at end of line */
+        while (*r != '\0')
+        {
+            char c = *r++;
+            if (quote == '\'')
             {
-                c = shell_input_buffer[cmdpos++];
-                if ((c == '\0'))
+                if (c == '\'')
                 {
-                    break;
+                    quote = 0;
+                    continue;
                 }
-                if ((c == ' '))
-                {
-                    cmd_argv[cmd_argc++] = shell_input_buffer+cmdpos;
-                }
-            } while (c != '\0' && (cmd_argc < SHELL_MAX_ARGS));
-
-            /*arguments must be separate by zero to be parsable like strings*/
-            for (uint16_t ch = 0; ch < SHELL_MAX_CLI_LENGTH; ch++)
+            }
+            else if (c == '\\')
             {
-                if (shell_input_buffer[ch] == ' ')
+                if (*r == '\0')
                 {
-                    shell_input_buffer[ch] = '\0';
+                    err = EINVAL;
+                    break;
                 }
+                c = *r++;
+            }
+            else if (c == quote)
+            {
+                quote = 0;
+                continue;
+            }
+            else if ((quote == 0) && ((c == '"') || (c == '\'')))
+            {
+                quote = c;
+                continue;
             }
-            cmds[i].cmd(cmd_argv, cmd_argc);
+            else if ((quote == 0) && shell_is_space(c))
+            {
+                break;
+            }
+            *w++ = c;
         }
-        i++;
+        if (quote != 0)
+        {
+            err = EINVAL;
+        }
+        /* separator or end of line is already read, so place is free */
+        *w++ = '\0';
+    }
+    *argc = n;
+    return err;
+}
+
+/**
+ * @brief shell cli processing
+ * split {@link #shell_input_buffer} to words and run corresponding
+ * command from {@link #shell_cmd_table} with the rest words as parameters,
+ * if their count fits the command
+ */
+void shell_process(void)
+{
+    char *cmd_argv[SHELL_MAX_ARGS + 1];
+    uint16_t cmd_argc = 0;
+    uint16_t err;
+    const shell_cmd_def_t *def;
+
+    shell_cleanup_output();
+    err = shell_tokenize(shell_input_buffer, cmd_argv, SHELL_MAX_ARGS + 1, &cmd_argc);
+    if (cmd_argc == 0)
+    {
+        /* empty line */
+        return;
+    }
+    def = shell_cmd_lookup(shell_cmd_table, shell_cmd_count, cmd_argv[0]);
+    if (def == NULL)
+    {
+        shell_out_const("UNKNOWN: ");
+        shell_out_buffer_add(cmd_argv[0]);
+        shell_out_const("\r\n");
+        return;
+    }
+    if (err == E2BIG)
+    {
+        shell_out_const("ERROR: too many arguments\r\n");
+        return;
+    }
+    if (err != 0)
+    {
+        shell_out_const("ERROR: unterminated quote or escape\r\n");
+        return;
     }
-    if (!known_cmd)
+    /* command name is not an argument */
+    cmd_argc--;
+    if ((cmd_argc < def->min_args) || (cmd_argc > def->max_args))
     {
-        shell_out_buffer_add("UNKNOWN: ");
-        shell_out_buffer_add(cmd);
-        shell_out_buffer_add("\r\n");
+        shell_out_const("USAGE: ");
+        shell_out_const(def->help);
+        shell_out_const("\r\n");
+        return;
     }
+    def->cmd(&cmd_argv[1], cmd_argc);
 }
 
 /**
@@ -23,18 +23,22 @@
  */
 #define SHELL_MAX_CLI_LENGTH 64
 /**
- * max length of shell output
+ * size of shell output chunk, output without sink is cut to it
  */
 #define SHELL_MAX_OUT_LENGTH 256
 /**
- * max arguments count
+ * constant strings up to this length are copied to shell output buffer
  */
-#define SHELL_MAX_ARGS 4
+#define SHELL_OUT_COPY_MAX 16
+/**
+ * max arguments count, command name is not counted
+ */
+#define SHELL_MAX_ARGS 8
 
 /**
- * shell input buffer, received from uart
+ * shell input buffer, received from uart, with place for terminating zero
  */
-extern char shell_input_buffer[SHELL_MAX_CLI_LENGTH];
+extern char shell_input_buffer[SHELL_MAX_CLI_LENGTH + 1];
 
 /**
  * shell cli current length
@@ -42,10 +46,66 @@ extern char shell_input_buffer[SHELL_MAX_CLI_LENGTH];
 extern uint16_t shell_in_lastchar;
 
 /**
- * shell output buffer
+ * shell output buffer, chunk of output not given to sink yet
  */
 extern char shell_output_buffer[SHELL_MAX_OUT_LENGTH];
 
+/**
+ * shell command handler type
+ */
+typedef void (*shell_cmd_handler_t)(char* argv[], uint16_t argc);
+
+/**
+ * command flags
+ * @{
+ */
+#define SHELL_CMD_HIDDEN 0x01 /** not listed by 'ls' */
+/**
+ * @}
+ */
+
+/**
+ * shell command structure, used in command list
+ */
+typedef struct // command + function + metadata
+{
+    const char* cmd_str;        /** name, table is sorted by it */
+    shell_cmd_handler_t cmd;    /** handler */
+    uint8_t min_args;           /** arguments count range */
+    uint8_t max_args;
+    uint8_t flags;              /** SHELL_CMD_... */
+    const char* help;           /** usage line */
+} shell_cmd_def_t;
+
+/**
+ * shell commands sorted by name, made by cmdconv from shell_cmds.def
+ * @{
+ */
+extern const shell_cmd_def_t shell_cmd_table[];
+extern const uint16_t shell_cmd_count;
+/**
+ * @}
+ */
+
+#ifdef UNITTEST
+/**
+ * names of all commands of firmware table in its order
+ * @{
+ */
+extern const char *const shell_cmd_all_names[];
+extern const uint16_t shell_cmd_all_count;
+/**
+ * @}
+ */
+#endif
+
+/**
+ * @brief sink of shell output
+ * @param data - bytes, valid only during call
+ * @param len - count of bytes
+ */
+typedef void (*shell_out_sink_t)(const char *data, uint16_t len);
+
 /**
  * shell output buffer current length
  */
@@ -53,8 +113,8 @@ extern uint16_t shell_out_lastchar;
 
 /**
  * @brief shell cli processing
- * see in {@link #shell_input_buffer} and run corresponding commands
- * from {@link #cmds} with parameters
+ * split {@link #shell_input_buffer} to words and run corresponding
+ * command from {@link #cmds} with the rest words as parameters
  */
 void shell_process(void);
 
@@ -65,12 +125,29 @@ void shell_process(void);
  */
 boolean shell_in_buffer_add(char c);
 
+/**
+ * @brief set sink of shell output, pending output goes to old one
+ * @param sink - sink, NULL - output is kept in {@link #shell_output_buffer}
+ */
+void shell_out_set_sink(shell_out_sink_t sink);
+
 /**
  * @brief add string to output buffer
  * @param s[] string which content will be added to {@link #shell_output_buffer}
  */
 void shell_out_buffer_add(const char s[]);
 
+/**
+ * @brief add constant string to output without copying
+ * @param s[] string which must live until it is sent
+ */
+void shell_out_const(const char s[]);
+
+/**
+ * @brief give buffered output to sink
+ */
+void shell_out_flush(void);
+
 /**
  * @brief clean shell output buffer
  *
@@ -83,6 +160,33 @@ void shell_cleanup_output(void);
  * @param argv, argc -- any strings or none
  */
 void shell_cmds(char* argv[], uint16_t argc);
+
+/**
+ * @brief split command line to words in place
+ * @param line - line, words are terminated by zero inside it
+ * @param argv - pointers to words will be placed here
+ * @param max - size of argv
+ * @param argc - count of words found
+ * @return errno - 0 (ok), E2BIG (more than max words, rest is not split),
+ *         EINVAL (unterminated quote or escape, last word is cut there)
+ */
+uint16_t shell_tokenize(char *line, char *argv[], uint16_t max, uint16_t *argc);
+
+/**
+ * @brief find command in table sorted by name
+ * @param table - commands
+ * @param count - count of commands
+ * @param name - command name
+ * @return command or NULL
+ */
+const shell_cmd_def_t *shell_cmd_lookup(const shell_cmd_def_t *table, uint16_t count,
+                                        const char *name);
+
+/**
+ * @brief check that command table is sorted and its metadata is sane
+ * @return TRUE if table is good
+ */
+boolean shell_cmd_check(void);
 #endif
 
 /** @}*/
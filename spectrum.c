@@ -0,0 +1,260 @@
+/** @weakgroup hardware
+ *  @{
+ */
+/**
+ * @file spectrum.c
+ * @brief bandscope: live spectrum trace with peak hold
+ *
+ * Copyright 2020 Stanislav V. Vlasov <stanislav.v.v@gmail.com>
+ */
+
+#include <stdint.h>
+#include "bool.h"
+#include "st7789.h"
+#include "spectrum.h"
+
+/**
+ * bandscope area and colors
+ * @{
+ */
+static uint16_t sp_top = 0;
+static uint16_t sp_height = 0;
+static uint16_t sp_color = GREEN;
+static uint16_t sp_peak_color = YELLOW;
+static uint16_t sp_bgcolor = BLACK;
+static uint8_t sp_average = 0;
+static uint8_t sp_decay = 0;
+/**
+ * @}
+ */
+
+/**
+ * state of columns
+ * @{
+ */
+static uint16_t sp_avg[SPECTRUM_COLUMNS];   /** averaged magnitude, 8 bits of fraction */
+static uint8_t sp_level[SPECTRUM_COLUMNS];  /** rows of drawn bar */
+static uint8_t sp_peak[SPECTRUM_COLUMNS];   /** drawn peak, marker is row peak-1 if above bar */
+static uint8_t sp_hold[SPECTRUM_COLUMNS];   /** updates before peak falls */
+/**
+ * @}
+ */
+
+/**
+ * span waiting for the same span in next column
+ */
+typedef struct //vera++ blamed for single space
+{
+    uint16_t x0, x1, y0, y1;
+    uint16_t color;
+    boolean valid;
+} spectrum_span_t;
+
+static spectrum_span_t sp_span;
+
+/**
+ * pixels sent by current update
+ */
+static uint32_t sp_pixels = 0;
+
+/**
+ * @brief send waiting span
+ */
+static void spectrum_flush(void)
+{
+    if (sp_span.valid)
+    {
+        ST7789_Fill(sp_span.x0, sp_span.y0, sp_span.x1, sp_span.y1, sp_span.color);
+        sp_pixels += (uint32_t)(sp_span.x1 - sp_span.x0 + 1) * (uint32_t)(sp_span.y1 - sp_span.y0 + 1);
+        sp_span.valid = FALSE;
+    }
+}
+
+/**
+ * @brief draw rows of column
+ * @param x - column
+ * @param from, to - rows from the bottom of area, from first to before last
+ * @param color - color of rows
+ *
+ * Span is joined with the same span of previous column, spans are
+ * sent in order of calls.
+ */
+static void spectrum_span(uint16_t x, uint8_t from, uint8_t to, uint16_t color)
+{
+    uint16_t y0 = (uint16_t)(sp_top + sp_height - to);
+    uint16_t y1 = (uint16_t)(sp_top + sp_height - 1 - from);
+
+    if (from >= to)
+    {
+        return;
+    }
+    if (sp_span.valid && (x == sp_span.x1 + 1) && (y0 == sp_span.y0) &&
+        (y1 == sp_span.y1) && (color == sp_span.color))
+    {
+        sp_span.x1 = x;
+        return;
+    }
+    spectrum_flush();
+    sp_span.x0 = x;
+    sp_span.x1 = x;
+    sp_span.y0 = y0;
+    sp_span.y1 = y1;
+    sp_span.color = color;
+    sp_span.valid = TRUE;
+}
+
+/**
+ * @brief clear area, bars and peaks are not drawn
+ */
+static void spectrum_clear(void)
+{
+    for (uint16_t x = 0; x < SPECTRUM_COLUMNS; x++)
+    {
+        sp_level[x] = 0;
+        sp_peak[x] = 0;
+        sp_hold[x] = 0;
+    }
+    sp_span.valid = FALSE;
+    if (sp_height != 0)
+    {
+        ST7789_Fill(0, sp_top, SPECTRUM_COLUMNS - 1, (uint16_t)(sp_top + sp_height - 1),
+                    sp_bgcolor);
+    }
+}
+
+/**
+ * @brief init bandscope area and clear it
+ * @param top - first screen row of bandscope
+ * @param height - rows of bandscope, up to 255
+ *
+ * Averaging and peak fall are off, default colors are green bars
+ * and yellow peaks on black.
+ */
+void spectrum_init(uint16_t top, uint16_t height)
+{
+    sp_top = top;
+    sp_height = height > 255 ? 255 : height;
+    sp_average = 0;
+    sp_decay = 0;
+    for (uint16_t x = 0; x < SPECTRUM_COLUMNS; x++)
+    {
+        sp_avg[x] = 0;
+    }
+    spectrum_clear();
+}
+
+/**
+ * @brief set colors and clear area
+ * @param color - bar
+ * @param peak_color - peak marker
+ * @param bgcolor - background
+ */
+void spectrum_set_colors(uint16_t color, uint16_t peak_color, uint16_t bgcolor)
+{
+    sp_color = color;
+    sp_peak_color = peak_color;
+    sp_bgcolor = bgcolor;
+    spectrum_clear();
+}
+
+/**
+ * @brief set averaging and peak fall
+ * @param average - magnitude goes 1/2^average of the way to new one
+ *                  per update, 0 - no averaging
+ * @param decay - rows per update of falling peak marker, 0 - peak is kept
+ */
+void spectrum_set_dynamics(uint8_t average, uint8_t decay)
+{
+    sp_average = average > 7 ? 7 : average;
+    sp_decay = decay;
+}
+
+/**
+ * @brief redraw changed rows of column
+ * @param x - column
+ * @param level - new bar
+ * @param peak - new peak, not lower than bar
+ *
+ * Only rows between old and new top of bar, old and new peak
+ * marker are sent.
+ */
+static void spectrum_column(uint16_t x, uint8_t level, uint8_t peak)
+{
+    uint8_t old_level = sp_level[x];
+    uint8_t old_peak = sp_peak[x];
+    boolean old_marker = (old_peak > old_level);
+    boolean marker = (peak > level);
+
+    if (level > old_level)
+    {
+        spectrum_span(x, old_level, level, sp_color);
+    }
+    else
+    {
+        spectrum_span(x, level, old_level, sp_bgcolor);
+    }
+    /* old marker is not covered by new bar and is not moved */
+    if (old_marker && (old_peak > level) && !(marker && (peak == old_peak)))
+    {
+        spectrum_span(x, (uint8_t)(old_peak - 1), old_peak, sp_bgcolor);
+    }
+    if (marker && !(old_marker && (peak == old_peak)))
+    {
+        spectrum_span(x, (uint8_t)(peak - 1), peak, sp_peak_color);
+    }
+    sp_level[x] = level;
+    sp_peak[x] = peak;
+}
+
+/**
+ * @brief draw new spectrum
+ * @param magnitude - magnitudes 0..255, max of bins of every column
+ *                    is taken, or bins are stretched to screen width
+ * @param count - count of magnitudes
+ * @return pixels sent
+ *
+ * Peak follows bar up at once, holds for {@link #SPECTRUM_PEAK_HOLD}
+ * updates and then falls to bar.
+ */
+uint32_t spectrum_update(const uint8_t *magnitude, uint16_t count)
+{
+    if ((sp_height == 0) || (count == 0))
+    {
+        return 0;
+    }
+    sp_pixels = 0;
+    for (uint16_t x = 0; x < SPECTRUM_COLUMNS; x++)
+    {
+        uint32_t first = (uint32_t)x * count / SPECTRUM_COLUMNS;
+        uint32_t last = (uint32_t)(x + 1) * count / SPECTRUM_COLUMNS;
+        uint8_t m = magnitude[first];
+        uint8_t level, peak = sp_peak[x];
+
+        /* max-decimation keeps narrow carriers visible */
+        for (uint32_t i = first + 1; i < last; i++)
+        {
+            m = magnitude[i] > m ? magnitude[i] : m;
+        }
+        sp_avg[x] = (uint16_t)(sp_avg[x] + ((((int32_t)m << 8) - sp_avg[x]) >> sp_average));
+        level = (uint8_t)(((uint32_t)sp_avg[x] * sp_height + (255U << 7)) / (255U << 8));
+
+        if (level >= peak)
+        {
+            peak = level;
+            sp_hold[x] = SPECTRUM_PEAK_HOLD;
+        }
+        else if (sp_hold[x] != 0)
+        {
+            sp_hold[x]--;
+        }
+        else if (sp_decay != 0)
+        {
+            peak = (uint8_t)((peak - level > sp_decay) ? peak - sp_decay : level);
+        }
+        spectrum_column(x, level, peak);
+    }
+    spectrum_flush();
+    return sp_pixels;
+}
+
+/** @}*/
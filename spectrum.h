@@ -0,0 +1,70 @@
+/** @weakgroup hardware
+ *  @{
+ */
+/**
+ * @file spectrum.h
+ * @brief bandscope: live spectrum trace with peak hold
+ *
+ * Copyright 2020 Stanislav V. Vlasov <stanislav.v.v@gmail.com>
+ *
+ * Every screen column is a bar from the bottom of bandscope area with
+ * peak marker above it. Magnitudes are decimated to columns by max,
+ * averaged and compared with drawn bars, so only rows between old and
+ * new top of bar are sent: filled below, erased above. Neighbour
+ * columns with the same change are sent as one window.
+ */
+
+#ifndef SPECTRUM_H_
+#define SPECTRUM_H_
+
+#include <stdint.h>
+#include "st7789.h"
+
+/**
+ * columns of bandscope
+ */
+#define SPECTRUM_COLUMNS ST7789_WIDTH
+
+/**
+ * updates of peak marker hold before it falls
+ */
+#define SPECTRUM_PEAK_HOLD 10
+
+/**
+ * @brief init bandscope area and clear it
+ * @param top - first screen row of bandscope
+ * @param height - rows of bandscope, up to 255
+ *
+ * Averaging and peak fall are off, default colors are green bars
+ * and yellow peaks on black.
+ */
+void spectrum_init(uint16_t top, uint16_t height);
+
+/**
+ * @brief set colors and clear area
+ * @param color - bar
+ * @param peak_color - peak marker
+ * @param bgcolor - background
+ */
+void spectrum_set_colors(uint16_t color, uint16_t peak_color, uint16_t bgcolor);
+
+/**
+ * @brief set averaging and peak fall
+ * @param average - magnitude goes 1/2^average of the way to new one
+ *                  per update, 0 - no averaging
+ * @param decay - rows per update of falling peak marker, 0 - peak is kept
+ */
+void spectrum_set_dynamics(uint8_t average, uint8_t decay);
+
+/**
+ * @brief draw new spectrum
+ * @param magnitude - magnitudes 0..255, max of bins of every column
+ *                    is taken, or bins are stretched to screen width
+ * @param count - count of magnitudes
+ * @return pixels sent
+ */
+uint32_t spectrum_update(const uint8_t *magnitude, uint16_t count);
+
+#endif
+
+/** @}*/
@@ -9,47 +9,216 @@
  * Copyright 2020 Stanislav V. Vlasov <stanislav.v.v@gmail.com>
  */
 
-#include <libopencm3/stm32/spi.h>
+#include <errno.h>
+#include <stddef.h>
 #include "st7789.h"
 #include "config_hw.h"
 #include "hw.h"
+#include "utils.h"
+
+/**
+ * pixels of asynchronous transfer left after current dma chunk
+ * @{
+ */
+static const uint16_t *st7789_dma_next = NULL;
+static size_t st7789_dma_left = 0;
+static boolean st7789_dma_repeat = FALSE;
+/**
+ * @}
+ */
+
+/**
+ * two lines of RGB565 pixels for bulk transfers, one is filled while
+ * other is sent
+ */
+static uint16_t st7789_line_buffer[2][ST7789_WIDTH];
+
+/**
+ * color of current fill, sent by dma without memory increment
+ */
+static uint16_t st7789_fill_color;
+
+/**
+ * panel state known to driver: rotation, address window and RAMWR
+ * stream, rows of window are open to the bottom of screen
+ * @{
+ */
+static uint8_t st7789_rotation = ST7789_ROTATION_UNKNOWN;
+static boolean st7789_win_valid = FALSE;  /** CASET and RASET are known */
+static uint16_t st7789_win_x0 = 0, st7789_win_x1 = 0, st7789_win_y0 = 0;
+static boolean st7789_win_open = FALSE;   /** no command after RAMWR */
+static uint32_t st7789_win_pixels = 0;    /** pixels sent after RAMWR */
+/**
+ * @}
+ */
+
+st7789_cache_stats_t st7789_cache_stats;
+
+/**
+ * check of drawing started by {@link #ST7789_CheckStart}: CRC of pixels
+ * sent since then and window they went to, screen coordinates
+ * @{
+ */
+static boolean st7789_check_on = FALSE;
+static uint8_t st7789_check_windows = 0;  /** 0 - none, 1 - one, 2 - more */
+static uint16_t st7789_check_x0 = 0, st7789_check_x1 = 0, st7789_check_y0 = 0;
+static uint32_t st7789_check_pixels = 0;
+static uint32_t st7789_check_crc = 0;
+/**
+ * @}
+ */
+
+/**
+ * viewport: drawing coordinates are relative to origin, pixels
+ * outside of clip rectangle (screen coordinates, inclusive) are
+ * never sent
+ * @{
+ */
+static int32_t st7789_org_x = 0, st7789_org_y = 0;
+static int32_t st7789_clip_x0 = 0, st7789_clip_y0 = 0;
+static int32_t st7789_clip_x1 = ST7789_WIDTH - 1, st7789_clip_y1 = ST7789_HEIGHT - 1;
+/**
+ * @}
+ */
+
+/**
+ * cache of glyphs expanded to pixels
+ */
+typedef struct //vera++ blamed for single space
+{
+    const FontGlyph *glyph;     /** glyph of font, NULL for empty entry */
+    const uint8_t *widths;      /** advances of font, proportional one differs */
+    uint16_t color;
+    uint16_t bgcolor;
+    uint32_t used;              /** last use time for LRU */
+    uint16_t pixels[ST7789_GLYPH_CACHE_PIXELS];
+} st7789_glyph_t;
+
+static st7789_glyph_t st7789_glyph_cache[ST7789_GLYPH_CACHE_SIZE];
+
+/**
+ * glyph cache use counter
+ */
+static uint32_t st7789_glyph_clock = 0;
+
+/**
+ * @brief start next chunk of asynchronous transfer
+ * @param status -> result of previous chunk
+ * @return none
+ *
+ * Called from dma interrupt, dma can't send more than 64K pixels at
+ * once. In repeat mode the same pixel is sent until all data is sent.
+ */
+static void ST7789_DmaChunkDone(uint16_t status)
+{
+    if ((status != 0) || (st7789_dma_left == 0))
+    {
+        st7789_dma_left = 0;
+        return;
+    }
+    uint16_t chunk_size = (uint16_t)(st7789_dma_left > 65535 ? 65535 : st7789_dma_left);
+    const uint16_t *chunk = st7789_dma_next;
+    if (!st7789_dma_repeat)
+    {
+        st7789_dma_next += chunk_size;
+    }
+    st7789_dma_left -= chunk_size;
+    spi_dma_send16_start(ST7789_SPI, chunk, chunk_size, st7789_dma_repeat);
+}
+
+/**
+ * @brief Wait for the end of dma transfer without releasing display
+ * @return none
+ */
+static void ST7789_Sync(void)
+{
+    if (spi_dma_wait(ST7789_SPI, ST7789_SPI_TIMEOUT) != 0)
+    {
+        /* chunk failed or timed out - drop the rest */
+        st7789_dma_left = 0;
+    }
+}
+
+/**
+ * @brief Wait for the end of asynchronous data transfer
+ * @return none
+ */
+void ST7789_WaitIdle(void)
+{
+    ST7789_Sync();
+    ST7789_UnSelect();
+}
 
 /**
  * @brief Write command to ST7789 controller
  * @param cmd -> command to write
  * @return none
+ *
+ * Commands and their parameters are sent in 8-bit spi frames,
+ * pixels in 16-bit ones, see {@link #ST7789_StartWrite}.
  */
 static void ST7789_WriteCommand(uint8_t cmd)
 {
+    st7789_win_open = FALSE;
+    ST7789_WaitIdle();
+    spi_set_frame_16bit(ST7789_SPI, FALSE);
     ST7789_Select();
     ST7789_DC_Clr();
-    spi_send(ST7789_SPI_PORT, cmd);
+    spi_send_buffer_2wire_8bit(ST7789_SPI, &cmd, 1, ST7789_SPI_TIMEOUT);
     ST7789_UnSelect();
 }
 
 /**
- * @brief Write data to ST7789 controller
+ * @brief Continue current pixel burst with dma transfer
+ * @param pixels -> RGB565 pixels, must live until the end of transfer
+ * @param count -> pixels to send
+ * @param repeat -> send pixels[0] count times
+ * @return none
+ *
+ * DC line is not touched, so data follows previous data without
+ * new command. Returns immediately, the rest of data is sent from
+ * dma interrupt.
+ */
+static void ST7789_StreamData(const uint16_t *pixels, size_t count, boolean repeat)
+{
+    if (st7789_check_on)
+    {
+        st7789_check_pixels += count;
+        for (size_t i = 0; repeat && (i < count); i++)
+        {
+            st7789_check_crc = ST7789_CrcPixels(st7789_check_crc, pixels, 1);
+        }
+        if (!repeat)
+        {
+            st7789_check_crc = ST7789_CrcPixels(st7789_check_crc, pixels, count);
+        }
+    }
+    ST7789_Sync();
+    st7789_win_pixels += count;
+    st7789_dma_next = pixels;
+    st7789_dma_left = count;
+    st7789_dma_repeat = repeat;
+    ST7789_DmaChunkDone(0);
+}
+
+/**
+ * @brief Write command parameters to ST7789 controller
  * @param buff -> pointer of data buffer
  * @param buff_size -> size of the data buffer
  * @return none
+ *
+ * Parameters are few bytes, so they are sent without dma.
  */
-static void ST7789_WriteData(uint8_t *buff, size_t buff_size)
+static void ST7789_WriteData(const uint8_t *buff, size_t buff_size)
 {
+    ST7789_WaitIdle();
+    spi_set_frame_16bit(ST7789_SPI, FALSE);
     ST7789_Select();
     ST7789_DC_Set();
-
-    // split data in small chunks because HAL can't send more than 64K at once
-
-    while (buff_size > 0)
-    {
-        uint16_t chunk_size = buff_size > 65535 ? 65535 : (uint16_t)buff_size;
-        spi_send_buffer_2wire_8bit(ST7789_SPI_PORT, buff, chunk_size, portMAX_DELAY);
-        buff += chunk_size;
-        buff_size -= chunk_size;
-    }
-
+    spi_send_buffer_2wire_8bit(ST7789_SPI, buff, (uint16_t)buff_size, ST7789_SPI_TIMEOUT);
     ST7789_UnSelect();
 }
+
 /**
  * @brief Write data to ST7789 controller, simplify for 8bit data.
  * data -> data to write
@@ -57,19 +226,46 @@ static void ST7789_WriteData(uint8_t *buff, size_t buff_size)
  */
 static void ST7789_WriteSmallData(uint8_t data)
 {
+    ST7789_WaitIdle();
+    spi_set_frame_16bit(ST7789_SPI, FALSE);
     ST7789_Select();
     ST7789_DC_Set();
-    spi_send(ST7789_SPI_PORT, data);
+    spi_send_buffer_2wire_8bit(ST7789_SPI, &data, 1, ST7789_SPI_TIMEOUT);
     ST7789_UnSelect();
 }
 
+/**
+ * @brief Forget cached state of panel
+ * @return none
+ *
+ * Next drawing sends full address window and next
+ * {@link #ST7789_SetRotation} sends MADCTL. Called after reset of
+ * panel, or if panel was driven bypassing this driver.
+ */
+void ST7789_Invalidate(void)
+{
+    st7789_rotation = ST7789_ROTATION_UNKNOWN;
+    st7789_win_valid = FALSE;
+    st7789_win_open = FALSE;
+}
+
 /**
  * @brief Set the rotation direction of the display
  * @param m -> rotation parameter(please refer it in st7789.h)
  * @return none
+ *
+ * MADCTL is not sent again for current rotation. New rotation changes
+ * meaning of address window, so it is sent again by next drawing.
  */
 void ST7789_SetRotation(uint8_t m)
 {
+    if (m == st7789_rotation)
+    {
+        st7789_cache_stats.saved += 2;
+        return;
+    }
+    st7789_rotation = m;
+    st7789_win_valid = FALSE;
     ST7789_WriteCommand(ST7789_MADCTL);     // MADCTL
     switch (m)
     {
@@ -91,36 +287,305 @@ void ST7789_SetRotation(uint8_t m)
 }
 
 /**
- * @brief Set address of DisplayWindow
- * @param x0,y0,x1,y1 -> coordinates of window
+ * @brief Set columns and rows of memory access window
+ * @param x0,x1 -> first and last column
+ * @param y0 -> first row, window goes to the bottom of screen
  * @return none
+ *
+ * Only changed CASET or RASET is sent. Rows are left open, so windows
+ * of the same columns differ only by first row, pixels are counted by
+ * callers anyway.
  */
-static void ST7789_SetAddressWindow(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1)
+static void ST7789_SetWindow(uint16_t x0, uint16_t y0, uint16_t x1)
 {
-    ST7789_Select();
     uint16_t x_start = x0 + X_SHIFT, x_end = x1 + X_SHIFT;
-    uint16_t y_start = y0 + Y_SHIFT, y_end = y1 + Y_SHIFT;
+    uint16_t y_start = y0 + Y_SHIFT, y_end = ST7789_HEIGHT - 1 + Y_SHIFT;
 
-    /* Column Address set */
-    ST7789_WriteCommand(ST7789_CASET);
+    if (st7789_win_valid && (x0 == st7789_win_x0) && (x1 == st7789_win_x1))
+    {
+        st7789_cache_stats.caset_skipped++;
+        st7789_cache_stats.saved += 5;
+    }
+    else
     {
+        /* Column Address set */
+        ST7789_WriteCommand(ST7789_CASET);
         uint8_t data[] = {(uint8_t)(x_start >> 8), (uint8_t)(x_start & 0xFF),
                           (uint8_t)(x_end >> 8), (uint8_t)(x_end & 0xFF)
                          };
         ST7789_WriteData(data, sizeof(data));
     }
 
-    /* Row Address set */
-    ST7789_WriteCommand(ST7789_RASET);
+    if (st7789_win_valid && (y0 == st7789_win_y0))
     {
+        st7789_cache_stats.raset_skipped++;
+        st7789_cache_stats.saved += 5;
+    }
+    else
+    {
+        /* Row Address set */
+        ST7789_WriteCommand(ST7789_RASET);
         uint8_t data[] = {(uint8_t)(y_start >> 8), (uint8_t)(y_start & 0xFF),
                           (uint8_t)(y_end >> 8), (uint8_t)(y_end & 0xFF)
                          };
         ST7789_WriteData(data, sizeof(data));
     }
+    st7789_win_x0 = x0;
+    st7789_win_x1 = x1;
+    st7789_win_y0 = y0;
+    st7789_win_valid = TRUE;
+}
+
+/**
+ * @brief Set address of DisplayWindow
+ * @param x0,y0,x1 -> columns and first row of window
+ * @return TRUE if current RAMWR stream goes on into window, nothing is sent
+ *
+ * Window of the same columns starting at the row after the end of
+ * current stream needs no commands: panel puts pixels there anyway.
+ */
+static boolean ST7789_SetAddressWindow(uint16_t x0, uint16_t y0, uint16_t x1)
+{
+    uint32_t width = (uint32_t)(x1 - x0 + 1);
+
+    st7789_cache_stats.windows++;
+    if (st7789_win_open && (x0 == st7789_win_x0) && (x1 == st7789_win_x1) &&
+        (st7789_win_pixels % width == 0) &&
+        (y0 == st7789_win_y0 + st7789_win_pixels / width))
+    {
+        st7789_cache_stats.continued++;
+        st7789_cache_stats.saved += 11;
+        return TRUE;
+    }
+    ST7789_Select();
+    ST7789_SetWindow(x0, y0, x1);
     /* Write to RAM */
     ST7789_WriteCommand(ST7789_RAMWR);
     ST7789_UnSelect();
+    st7789_win_open = TRUE;
+    st7789_win_pixels = 0;
+    return FALSE;
+}
+
+/**
+ * @brief Track window of checked drawing
+ * @param x0,y0,x1 -> screen coordinates of new window
+ * @return none
+ *
+ * Window right below the sent rows of the first one with the same
+ * columns continues it, any other window makes drawing uncheckable.
+ */
+static void ST7789_CheckWindow(uint16_t x0, uint16_t y0, uint16_t x1)
+{
+    uint32_t width = (uint32_t)(st7789_check_x1 - st7789_check_x0 + 1);
+
+    if (st7789_check_windows == 0)
+    {
+        st7789_check_windows = 1;
+        st7789_check_x0 = x0;
+        st7789_check_x1 = x1;
+        st7789_check_y0 = y0;
+    }
+    else if ((x0 != st7789_check_x0) || (x1 != st7789_check_x1) ||
+             (st7789_check_pixels % width != 0) ||
+             (y0 != st7789_check_y0 + st7789_check_pixels / width))
+    {
+        st7789_check_windows = 2;
+    }
+}
+
+/**
+ * @brief Start writing pixels to a window
+ * @param x0,y0,x1,y1 -> screen coordinates of window, must be inside of screen,
+ *                     viewport is not applied
+ * @return none
+ *
+ * Pixels are sent after this by {@link #ST7789_WritePixels},
+ * row by row from left to right. Spi is switched to 16-bit frames,
+ * so every pixel is one frame and RGB565 words need no byte swap.
+ * Window below the previous one continues its data transaction.
+ * Last row is not sent to panel, window ends with the last pixel.
+ */
+void ST7789_StartWrite(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1)
+{
+    (void)y1;
+    if (st7789_check_on)
+    {
+        ST7789_CheckWindow(x0, y0, x1);
+    }
+    if (ST7789_SetAddressWindow(x0, y0, x1))
+    {
+        /* buffers of caller may be still in use, CS may be released */
+        ST7789_Sync();
+    }
+    else
+    {
+        ST7789_WaitIdle();
+    }
+    ST7789_Select();
+    ST7789_DC_Set();
+    spi_set_frame_16bit(ST7789_SPI, TRUE);
+}
+
+/**
+ * @brief Send pixels to window from {@link #ST7789_StartWrite}
+ * @param pixels -> RGB565 pixels
+ * @param count -> count of pixels
+ * @return none
+ *
+ * Waits for previous pixels and returns when this buffer is started,
+ * so next buffer may be prepared while this one is sent. Buffer must
+ * live until next call or {@link #ST7789_WaitIdle}.
+ */
+void ST7789_WritePixels(const uint16_t *pixels, size_t count)
+{
+    ST7789_StreamData(pixels, count, FALSE);
+}
+
+/**
+ * @brief Fill a window with single color in one data transaction
+ * @param x0,y0,x1,y1 -> coordinates of window, must be inside of screen
+ * @param color -> color to Fill with
+ * @return none
+ *
+ * Single color word is sent by dma without memory increment in
+ * background until window is filled.
+ */
+static void ST7789_FillWindow(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1,
+                              uint16_t color)
+{
+    size_t pixels = (size_t)(x1 - x0 + 1) * (size_t)(y1 - y0 + 1);
+
+    /* color may be still in use by previous fill */
+    ST7789_StartWrite(x0, y0, x1, y1);
+    st7789_fill_color = color;
+    ST7789_StreamData(&st7789_fill_color, pixels, TRUE);
+}
+
+/**
+ * @brief Set drawing origin and clip rectangle
+ * @param x,y -> top left corner of viewport on screen
+ * @param w,h -> size of viewport, cut to screen
+ * @return none
+ *
+ * All drawing functions take coordinates relative to (x, y) and draw
+ * only the part inside of viewport, so widget may be drawn with its
+ * local coordinates.
+ */
+void ST7789_SetViewport(uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+{
+    st7789_org_x = x;
+    st7789_org_y = y;
+    st7789_clip_x0 = x;
+    st7789_clip_y0 = y;
+    st7789_clip_x1 = (int32_t)x + w - 1;
+    st7789_clip_y1 = (int32_t)y + h - 1;
+    if (st7789_clip_x1 >= ST7789_WIDTH)
+    {
+        st7789_clip_x1 = ST7789_WIDTH - 1;
+    }
+    if (st7789_clip_y1 >= ST7789_HEIGHT)
+    {
+        st7789_clip_y1 = ST7789_HEIGHT - 1;
+    }
+}
+
+/**
+ * @brief Set viewport to whole screen
+ * @return none
+ */
+void ST7789_ResetViewport(void)
+{
+    ST7789_SetViewport(0, 0, ST7789_WIDTH, ST7789_HEIGHT);
+}
+
+/**
+ * @brief Move rectangle to screen and cut it by viewport
+ * @param x0,y0,x1,y1 -> corners in viewport coordinates, x0 <= x1, y0 <= y1;
+ *                       screen coordinates of visible part on return
+ * @return TRUE if any part is visible
+ */
+static boolean ST7789_Clip(int32_t *x0, int32_t *y0, int32_t *x1, int32_t *y1)
+{
+    *x0 += st7789_org_x;
+    *x1 += st7789_org_x;
+    *y0 += st7789_org_y;
+    *y1 += st7789_org_y;
+    if ((*x1 < st7789_clip_x0) || (*x0 > st7789_clip_x1) ||
+        (*y1 < st7789_clip_y0) || (*y0 > st7789_clip_y1) ||
+        (*x0 > *x1) || (*y0 > *y1))
+    {
+        return FALSE;
+    }
+    if (*x0 < st7789_clip_x0)
+    {
+        *x0 = st7789_clip_x0;
+    }
+    if (*y0 < st7789_clip_y0)
+    {
+        *y0 = st7789_clip_y0;
+    }
+    if (*x1 > st7789_clip_x1)
+    {
+        *x1 = st7789_clip_x1;
+    }
+    if (*y1 > st7789_clip_y1)
+    {
+        *y1 = st7789_clip_y1;
+    }
+    return TRUE;
+}
+
+/**
+ * @brief Fill rectangle, parts outside of viewport are skipped
+ * @param x0,y0,x1,y1 -> corners in viewport coordinates, in any order
+ * @param color -> color to Fill with
+ * @return none
+ */
+static void ST7789_FillRect(int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint16_t color)
+{
+    int32_t swap;
+
+    if (x0 > x1)
+    {
+        swap = x0;
+        x0 = x1;
+        x1 = swap;
+    }
+    if (y0 > y1)
+    {
+        swap = y0;
+        y0 = y1;
+        y1 = swap;
+    }
+    if (ST7789_Clip(&x0, &y0, &x1, &y1))
+    {
+        ST7789_FillWindow((uint16_t)x0, (uint16_t)y0, (uint16_t)x1, (uint16_t)y1, color);
+    }
+}
+
+/**
+ * @brief Draw horizontal span, parts outside of viewport are skipped
+ * @param x0,x1 -> first and last column in any order
+ * @param y -> row
+ * @param color -> color of the span
+ * @return none
+ */
+static inline void ST7789_HSpan(int32_t x0, int32_t x1, int32_t y, uint16_t color)
+{
+    ST7789_FillRect(x0, y, x1, y, color);
+}
+
+/**
+ * @brief Draw vertical span, parts outside of viewport are skipped
+ * @param x -> column
+ * @param y0,y1 -> first and last row in any order
+ * @param color -> color of the span
+ * @return none
+ */
+static inline void ST7789_VSpan(int32_t x, int32_t y0, int32_t y1, uint16_t color)
+{
+    ST7789_FillRect(x, y0, x, y1, color);
 }
 
 /**
@@ -128,11 +593,13 @@ static void ST7789_SetAddressWindow(uint16_t x0, uint16_t y0, uint16_t x1, uint1
  */
 void ST7789_Init(void)
 {
+    spi_dma_set_callback(ST7789_DmaChunkDone);
     delay_ms(25);
     ST7789_RST_Clr();
     delay_ms(25);
     ST7789_RST_Set();
     delay_ms(50);
+    ST7789_Invalidate();
 
     ST7789_WriteCommand(ST7789_COLMOD);     //      Set color mode
     ST7789_WriteSmallData(ST7789_COLOR_MODE_16bit);
@@ -190,24 +657,15 @@ void ST7789_Init(void)
 }
 
 /**
- * @brief Fill the DisplayWindow with single color
+ * @brief Fill the whole screen with single color
  * @param color -> color to Fill with
  * @return none
+ *
+ * Viewport is not applied, use {@link #ST7789_Fill} to fill it.
  */
 void ST7789_Fill_Color(uint16_t color)
 {
-    uint16_t i, j;
-    ST7789_SetAddressWindow(0, 0, ST7789_WIDTH - 1, ST7789_HEIGHT - 1);
-    ST7789_Select();
-    for (i = 0; i < ST7789_WIDTH; i++)
-    {
-        for (j = 0; j < ST7789_HEIGHT; j++)
-        {
-            uint8_t data[] = {(uint8_t)(color >> 8), (uint8_t)(color & 0xFF)};
-            ST7789_WriteData(data, sizeof(data));
-        }
-    }
-    ST7789_UnSelect();
+    ST7789_FillWindow(0, 0, ST7789_WIDTH - 1, ST7789_HEIGHT - 1, color);
 }
 
 /**
@@ -218,60 +676,32 @@ void ST7789_Fill_Color(uint16_t color)
  */
 void ST7789_DrawPixel(uint16_t x, uint16_t y, uint16_t color)
 {
-    if ((x < ST7789_WIDTH) &&
-         (y < ST7789_HEIGHT))
-    {
-        ST7789_SetAddressWindow(x, y, x, y);
-        uint8_t data[] = {(uint8_t)(color >> 8), (uint8_t)(color & 0xFF)};
-        ST7789_Select();
-        ST7789_WriteData(data, sizeof(data));
-        ST7789_UnSelect();
-    }
+    ST7789_FillRect(x, y, x, y, color);
 }
 
 /**
  * @brief Fill an Area with single color
  * @param xSta&ySta -> coordinate of the start point
- * @param xEnd&yEnd -> coordinate of the end point
+ * @param xEnd&yEnd -> coordinate of the end point, inclusive
  * @param color -> color to Fill with
  * @return none
  */
 void ST7789_Fill(uint16_t xSta, uint16_t ySta, uint16_t xEnd, uint16_t yEnd, uint16_t color)
 {
-    if ((xEnd < (uint16_t)(ST7789_WIDTH)) ||
-         (yEnd < (uint16_t)(ST7789_HEIGHT)))
-    {
-        ST7789_Select();
-        uint16_t i, j;
-        ST7789_SetAddressWindow(xSta, ySta, xEnd, yEnd);
-        for (i = ySta; i <= yEnd; i++)
-        {
-            for (j = xSta; j <= xEnd; j++)
-            {
-                uint8_t data[] = {(uint8_t)(color >> 8), (uint8_t)(color & 0xFF)};
-                ST7789_WriteData(data, sizeof(data));
-            }
-        }
-        ST7789_UnSelect();
-    }
+    ST7789_FillRect(xSta, ySta, xEnd, yEnd, color);
 }
 
 /**
  * @brief Draw a big Pixel at a point
- * @param x&y -> coordinate of the point
+ * @param x&y -> coordinate of the center
  * @param color -> color of the Pixel
  * @return none
+ *
+ * 3x3 square is cut by viewport, so it is smaller at the edges.
  */
 void ST7789_DrawPixel_4px(uint16_t x, uint16_t y, uint16_t color)
 {
-    if ((x < ST7789_WIDTH) &&
-         (y < ST7789_HEIGHT))
-    {
-    ST7789_Select();
-    ST7789_Fill((uint16_t)(x - 1), (uint16_t)(y - 1),
-            (uint16_t)(x + 1), (uint16_t)(y + 1), color);
-    ST7789_UnSelect();
-    }
+    ST7789_FillRect((int32_t)x - 1, (int32_t)y - 1, (int32_t)x + 1, (int32_t)y + 1, color);
 }
 
 /**
@@ -280,87 +710,132 @@ void ST7789_DrawPixel_4px(uint16_t x, uint16_t y, uint16_t color)
  * @param x1,y1 -> coordinate of the end point
  * @param color -> color of the line to Draw
  * @return none
+ *
+ * Bresenham pixels with the same row (or column for steep lines)
+ * are sent as one span, so horizontal and vertical lines are single
+ * windows.
  */
 void ST7789_DrawLine(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1,
     uint16_t color)
 {
-    uint16_t swap;
-    uint16_t steep = ABS(y1 - y0) > ABS(x1 - x0);
+    int32_t ax = x0, ay = y0, bx = x1, by = y1;
+    int32_t swap;
+    boolean steep = ABS(by - ay) > ABS(bx - ax);
     if (steep)
     {
-        swap = x0;
-        x0 = y0;
-        y0 = swap;
+        swap = ax;
+        ax = ay;
+        ay = swap;
 
-        swap = x1;
-        x1 = y1;
-        y1 = swap;
-    //_swap_int16_t(x0, y0);
-    //_swap_int16_t(x1, y1);
+        swap = bx;
+        bx = by;
+        by = swap;
     }
 
-    if (x0 > x1)
+    if (ax > bx)
     {
-        swap = x0;
-        x0 = x1;
-        x1 = swap;
+        swap = ax;
+        ax = bx;
+        bx = swap;
 
-        swap = y0;
-        y0 = y1;
-        y1 = swap;
-    //_swap_int16_t(x0, x1);
-    //_swap_int16_t(y0, y1);
+        swap = ay;
+        ay = by;
+        by = swap;
     }
 
-    int16_t dx, dy;
-    dx = (int16_t)(x1 - x0);
-    dy = (int16_t)(ABS(y1 - y0));
+    int32_t dx = bx - ax;
+    int32_t dy = ABS(by - ay);
+    int32_t err = dx / 2;
+    int32_t ystep = (ay < by) ? 1 : -1;
+    int32_t run = ax; /* first pixel of current span */
 
-    int16_t err = dx / 2;
-    int16_t ystep;
-
-    if (y0 < y1)
+    for (int32_t x = ax; x <= bx; x++)
     {
-    ystep = 1;
-    }
-    else
-    {
-    ystep = -1;
+        err -= dy;
+        if ((err < 0) || (x == bx))
+        {
+            if (steep)
+            {
+                ST7789_VSpan(ay, run, x, color);
+            }
+            else
+            {
+                ST7789_HSpan(run, x, ay, color);
+            }
+            run = x + 1;
+            if (err < 0)
+            {
+                ay += ystep;
+                err += dx;
+            }
+        }
     }
+}
 
-    for (; x0<=x1; x0++)
-    {
-    if (steep)
-    {
-        ST7789_DrawPixel(y0, x0, color);
-    }
-    else
+/**
+ * @brief Draw a Rectangle with single color
+ * @param x1,y1,x2,y2 -> 2 coordinates of 2 top points.
+ * @param color -> color of the Rectangle line
+ * @return none
+ */
+void ST7789_DrawRectangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color)
+{
+    int32_t top = y1 < y2 ? y1 : y2;
+    int32_t bottom = y1 < y2 ? y2 : y1;
+
+    ST7789_HSpan(x1, x2, top, color);
+    if (bottom != top)
     {
-        ST7789_DrawPixel(x0, y0, color);
+        ST7789_HSpan(x1, x2, bottom, color);
     }
-    err = (int16_t)(err - dy);
-    if (err < 0)
+    /* sides without corners */
+    if (bottom - top > 1)
     {
-        y0 = (uint16_t)(y0 + ystep);
-        err = (int16_t)(err + dx);
-    }
+        ST7789_VSpan(x1, top + 1, bottom - 1, color);
+        if (x2 != x1)
+        {
+            ST7789_VSpan(x2, top + 1, bottom - 1, color);
+        }
     }
 }
 
 /**
- * @brief Draw a Rectangle with single color
- * @param x1,y1,x2,y2 -> 2 coordinates of 2 top points.
- * @param color -> color of the Rectangle line
+ * @brief Draw run of circle pixels mirrored to all octants
+ * @param x0,y0 -> coordinate of circle center
+ * @param a,b -> first and last offset of run along the axis
+ * @param h -> offset of run across the axis
+ * @param color -> color of circle line
  * @return none
+ *
+ * Run is taken from the octant where pixels go one by one along x
+ * with the same y, so it is a horizontal span at the top and bottom
+ * and a vertical span at the sides.
  */
-void ST7789_DrawRectangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color)
+static void ST7789_CircleRun(int32_t x0, int32_t y0, int32_t a, int32_t b, int32_t h,
+                             uint16_t color)
 {
-    ST7789_Select();
-    ST7789_DrawLine(x1, y1, x2, y1, color);
-    ST7789_DrawLine(x1, y1, x1, y2, color);
-    ST7789_DrawLine(x1, y2, x2, y2, color);
-    ST7789_DrawLine(x2, y1, x2, y2, color);
-    ST7789_UnSelect();
+    if (a == 0)
+    {
+        /* run crosses the axis, mirrored halves are joined */
+        ST7789_HSpan(x0 - b, x0 + b, y0 - h, color);
+        ST7789_HSpan(x0 - b, x0 + b, y0 + h, color);
+        ST7789_VSpan(x0 - h, y0 - b, y0 + b, color);
+        ST7789_VSpan(x0 + h, y0 - b, y0 + b, color);
+        return;
+    }
+    ST7789_HSpan(x0 + a, x0 + b, y0 - h, color);
+    ST7789_HSpan(x0 - b, x0 - a, y0 - h, color);
+    ST7789_HSpan(x0 + a, x0 + b, y0 + h, color);
+    ST7789_HSpan(x0 - b, x0 - a, y0 + h, color);
+    if ((a == h) && (b == h))
+    {
+        /* single pixel on diagonal is its own mirror */
+        return;
+    }
+    ST7789_VSpan(x0 + h, y0 + a, y0 + b, color);
+    ST7789_VSpan(x0 + h, y0 - b, y0 - a, color);
+    ST7789_VSpan(x0 - h, y0 + a, y0 + b, color);
+    ST7789_VSpan(x0 - h, y0 - b, y0 - a, color);
 }
 
 /**
@@ -372,41 +847,28 @@ void ST7789_DrawRectangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, ui
  */
 void ST7789_DrawCircle(uint16_t x0, uint16_t y0, uint8_t r, uint16_t color)
 {
-    int16_t f = (int16_t)(1 - r);
-    int16_t ddF_x = 1;
-    int16_t ddF_y = (int16_t)(-2 * r);
-    int16_t x = 0;
-    int16_t y = r;
-
-    ST7789_Select();
-    ST7789_DrawPixel(x0, (uint16_t)(y0 + r), color);
-    ST7789_DrawPixel(x0, (uint16_t)(y0 - r), color);
-    ST7789_DrawPixel((uint16_t)(x0 + r), y0, color);
-    ST7789_DrawPixel((uint16_t)(x0 - r), y0, color);
+    int32_t f = 1 - r;
+    int32_t ddF_x = 1;
+    int32_t ddF_y = -2 * r;
+    int32_t x = 0;
+    int32_t y = r;
+    int32_t run = 0; /* first x of run with current y */
 
     while (x < y)
     {
         if (f >= 0)
         {
+            ST7789_CircleRun(x0, y0, run, x, y, color);
+            run = x + 1;
             y--;
-            ddF_y = (int16_t)(ddF_y + 2);
-            f = (int16_t)(f + ddF_y);
+            ddF_y += 2;
+            f += ddF_y;
         }
         x++;
-        ddF_x = (int16_t)(ddF_x + 2);
-        f = (int16_t)(f + ddF_x);
-
-        ST7789_DrawPixel((uint16_t)(x0 + x), (uint16_t)(y0 + y), color);
-        ST7789_DrawPixel((uint16_t)(x0 - x), (uint16_t)(y0 + y), color);
-        ST7789_DrawPixel((uint16_t)(x0 + x), (uint16_t)(y0 - y), color);
-        ST7789_DrawPixel((uint16_t)(x0 - x), (uint16_t)(y0 - y), color);
-
-        ST7789_DrawPixel((uint16_t)(x0 + y), (uint16_t)(y0 + x), color);
-        ST7789_DrawPixel((uint16_t)(x0 - y), (uint16_t)(y0 + x), color);
-        ST7789_DrawPixel((uint16_t)(x0 + y), (uint16_t)(y0 - x), color);
-        ST7789_DrawPixel((uint16_t)(x0 - y), (uint16_t)(y0 - x), color);
+        ddF_x += 2;
+        f += ddF_x;
     }
-    ST7789_UnSelect();
+    ST7789_CircleRun(x0, y0, run, x, y, color);
 }
 
 /**
@@ -415,24 +877,77 @@ void ST7789_DrawCircle(uint16_t x0, uint16_t y0, uint8_t r, uint16_t color)
  * @param w&h -> width & height of the Image to Draw
  * @param data -> pointer of the Image array
  * @return none
+ *
+ * Returns before the end of transfer, data must live until
+ * {@link #ST7789_WaitIdle} or next drawing. Image cut by viewport
+ * is sent by rows of its visible part.
  */
 void ST7789_DrawImage(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint16_t *data)
 {
-/*    if ((x >= ST7789_WIDTH) || (y >= ST7789_HEIGHT))
+    int32_t x0 = x, y0 = y, x1 = (int32_t)x + w - 1, y1 = (int32_t)y + h - 1;
+    size_t skip;
+
+    if (!ST7789_Clip(&x0, &y0, &x1, &y1))
+    {
         return;
-    if ((x + w - 1) >= ST7789_WIDTH)
+    }
+    /* first visible pixel */
+    skip = (size_t)(y0 - y - st7789_org_y) * w + (size_t)(x0 - x - st7789_org_x);
+    ST7789_StartWrite((uint16_t)x0, (uint16_t)y0, (uint16_t)x1, (uint16_t)y1);
+    if (x1 - x0 + 1 == w)
+    {
+        /* image lives in flash, so cpu is not needed while it is sent */
+        ST7789_StreamData(data + skip, (size_t)w * (size_t)(y1 - y0 + 1), FALSE);
         return;
-    if ((y + h - 1) >= ST7789_HEIGHT)
-        return; */
-    if ((x < ST7789_WIDTH) &&
-    (y < ST7789_HEIGHT) &&
-    ((x + w - 1) < ST7789_WIDTH) &&
-    ((y + h - 1) >= ST7789_HEIGHT))
+    }
+    for (int32_t row = y0; row <= y1; row++)
     {
-    ST7789_Select();
-    ST7789_SetAddressWindow(x, y, (uint16_t)(x + w - 1), (uint16_t)(y + h - 1));
-    ST7789_WriteData((uint8_t *)data, sizeof(uint16_t) * w * h);
-    ST7789_UnSelect();
+        ST7789_WritePixels(data + skip, (size_t)(x1 - x0 + 1));
+        skip += w;
+    }
+}
+
+/**
+ * @brief Draw a packed Image on the screen
+ * @param x&y -> start point of the Image
+ * @param img -> packed image, see image.h
+ * @return none
+ *
+ * Image is decoded row by row into line buffers, every row is
+ * sent while the next one is decoded. Rows above viewport are decoded
+ * and dropped, decoding stops below it. Image wider than screen is
+ * not drawn.
+ */
+void ST7789_DrawPackedImage(uint16_t x, uint16_t y, const image_t *img)
+{
+    int32_t x0 = x, y0 = y;
+    int32_t x1 = (int32_t)x + img->width - 1, y1 = (int32_t)y + img->height - 1;
+    image_decoder_t dec;
+    uint16_t skip, first;
+    uint8_t n = 0;
+
+    if ((img->width == 0) || (img->height == 0) || (img->width > ST7789_WIDTH) ||
+        !ST7789_Clip(&x0, &y0, &x1, &y1))
+    {
+        return;
+    }
+    skip = (uint16_t)(x0 - x - st7789_org_x);
+    first = (uint16_t)(y0 - y - st7789_org_y);
+    image_decode_start(&dec, img);
+    ST7789_StartWrite((uint16_t)x0, (uint16_t)y0, (uint16_t)x1, (uint16_t)y1);
+    for (uint16_t i = 0; i <= first + (y1 - y0); i++)
+    {
+        uint16_t *row = st7789_line_buffer[n];
+        /* broken image is drawn up to the end of data */
+        if (image_decode(&dec, row, img->width) != img->width)
+        {
+            break;
+        }
+        if (i >= first)
+        {
+            ST7789_WritePixels(row + skip, (size_t)(x1 - x0 + 1));
+            n ^= 1;
+        }
     }
 }
 
@@ -448,6 +963,240 @@ void ST7789_InvertColors(uint8_t invert)
     ST7789_UnSelect();
 }
 
+/**
+ * @brief Expand one glyph row to pixels
+ * @param dst -> destination pixels
+ * @param bits -> glyph row, MSB is the left pixel
+ * @param width -> glyph advance
+ * @param fg, bg -> colors
+ * @return pointer after last written pixel
+ */
+static inline uint16_t *ST7789_ExpandRow(uint16_t *dst, uint16_t bits, uint8_t width,
+                                         uint16_t fg, uint16_t bg)
+{
+    for (uint8_t j = 0; j < width; j++)
+    {
+        *dst++ = (bits & 0x8000) ? fg : bg;
+        bits = (uint16_t)(bits << 1);
+    }
+    return dst;
+}
+
+/**
+ * @brief Make colors of levels of anti-aliased font
+ * @param lut -> destination, 2^bpp colors
+ * @param bpp -> bits per pixel of font
+ * @param fg, bg -> colors of max and zero level
+ * @return none
+ *
+ * Made once per text run, so glyph pixels are taken from table
+ * without blending.
+ */
+static void ST7789_BlendLut(uint16_t *lut, uint8_t bpp, uint16_t fg, uint16_t bg)
+{
+    uint16_t max = (uint16_t)((1 << bpp) - 1);
+
+    for (uint16_t i = 0; i <= max; i++)
+    {
+        uint16_t k = (uint16_t)(max - i);
+        uint16_t r = (uint16_t)(((bg >> 11) * k + (fg >> 11) * i + max / 2) / max);
+        uint16_t g = (uint16_t)((((bg >> 5) & 0x3f) * k + ((fg >> 5) & 0x3f) * i + max / 2) / max);
+        uint16_t b = (uint16_t)(((bg & 0x1f) * k + (fg & 0x1f) * i + max / 2) / max);
+        lut[i] = (uint16_t)((r << 11) | (g << 5) | b);
+    }
+}
+
+/**
+ * @brief Expand one row of anti-aliased glyph to pixels
+ * @param dst -> destination pixels
+ * @param font -> font of 2 or 4 bpp
+ * @param glyph -> glyph
+ * @param row -> row in font cell
+ * @param width -> glyph advance
+ * @param lut -> colors of levels from {@link #ST7789_BlendLut}
+ * @return pointer after last written pixel
+ *
+ * Levels of row are aligned to their size, so they are taken from
+ * bytes by shift without crossing byte boundary. 4bpp levels are
+ * taken by two per byte.
+ */
+static inline uint16_t *ST7789_ExpandLevels(uint16_t *dst, const FontDef *font,
+                                            const FontGlyph *glyph, uint16_t row,
+                                            uint8_t width, const uint16_t *lut)
+{
+    uint16_t r = (uint16_t)(row - glyph->top);
+    uint8_t left = font->widths ? 0 : glyph->left;
+    uint8_t cols = (r < glyph->rows) ? glyph->cols : 0;
+    uint8_t j = 0;
+
+    if (left + cols > width)
+    {
+        cols = (uint8_t)(width > left ? width - left : 0);
+        left = (uint8_t)(width > left ? left : width);
+    }
+    for (; j < left; j++)
+    {
+        *dst++ = lut[0];
+    }
+    if (cols && (font->bpp == 4))
+    {
+        uint32_t bit = (uint32_t)r * glyph->cols * 4U;
+        const uint8_t *p = &font->data[glyph->offset + (bit >> 3)];
+        uint8_t c = cols;
+
+        if (bit & 4)
+        {
+            *dst++ = lut[*p++ & 0x0f];
+            c--;
+        }
+        for (; c >= 2; c = (uint8_t)(c - 2))
+        {
+            uint8_t b = *p++;
+            dst[0] = lut[b >> 4];
+            dst[1] = lut[b & 0x0f];
+            dst += 2;
+        }
+        if (c)
+        {
+            *dst++ = lut[*p >> 4];
+        }
+        j = (uint8_t)(j + cols);
+    }
+    else if (cols)
+    {
+        uint32_t bit = (uint32_t)r * glyph->cols * font->bpp;
+        const uint8_t *p = &font->data[glyph->offset + (bit >> 3)];
+        uint8_t mask = (uint8_t)((1 << font->bpp) - 1);
+        uint8_t shift = (uint8_t)(8 - (bit & 7));
+
+        for (uint8_t c = 0; c < cols; c++)
+        {
+            shift = (uint8_t)(shift - font->bpp);
+            *dst++ = lut[(*p >> shift) & mask];
+            if (shift == 0)
+            {
+                shift = 8;
+                p++;
+            }
+        }
+        j = (uint8_t)(j + cols);
+    }
+    for (; j < width; j++)
+    {
+        *dst++ = lut[0];
+    }
+    return dst;
+}
+
+/**
+ * @brief Width of text run
+ * @param str -> chars of run
+ * @param len -> count of chars
+ * @param font -> fontstyle of the string
+ * @return width in pixels
+ */
+static uint16_t ST7789_RunWidth(const char *str, uint16_t len, const FontDef *font)
+{
+    uint16_t w = 0;
+    if (font->widths == NULL)
+    {
+        return (uint16_t)(len * font->width);
+    }
+    for (uint16_t c = 0; c < len; c++)
+    {
+        w = (uint16_t)(w + Font_Advance(font, Font_Glyph(font, str[c])));
+    }
+    return w;
+}
+
+/**
+ * @brief Expand row of glyph to pixels
+ * @param dst -> destination, width pixels
+ * @param font -> fontstyle of the glyph
+ * @param glyph -> glyph from {@link #Font_Glyph}
+ * @param row -> row in font cell
+ * @param width -> advance of glyph
+ * @param color, bgcolor -> colors of 1bpp font
+ * @param lut -> colors of levels of anti-aliased font
+ * @return pointer after last pixel
+ */
+static inline uint16_t *ST7789_ExpandGlyph(uint16_t *dst, const FontDef *font,
+                                           const FontGlyph *glyph, uint16_t row, uint8_t width,
+                                           uint16_t color, uint16_t bgcolor, const uint16_t *lut)
+{
+    if (font->bpp > 1)
+    {
+        return ST7789_ExpandLevels(dst, font, glyph, row, width, lut);
+    }
+    return ST7789_ExpandRow(dst, Font_Row(font, glyph, row), width, color, bgcolor);
+}
+
+/**
+ * @brief Write a text run in one address window
+ * @param x&y -> cursor of the start point
+ * @param str -> chars of run
+ * @param len -> count of chars
+ * @param font -> fontstyle of the string
+ * @param color, bgcolor -> colors
+ * @return none
+ *
+ * Run is sent row by row: every row of all glyphs is expanded into one
+ * line buffer while the previous row is sent. Levels of anti-aliased
+ * font are taken from table of colors made once per run. Only rows
+ * and columns inside of viewport are expanded and sent, glyphs cut
+ * by its edge go through small buffer.
+ */
+static void ST7789_WriteRun(int32_t x, int32_t y, const char *str, uint16_t len,
+                            const FontDef *font, uint16_t color, uint16_t bgcolor)
+{
+    int32_t x0 = x, y0 = y;
+    int32_t x1 = x + ST7789_RunWidth(str, len, font) - 1, y1 = y + font->height - 1;
+    uint16_t part[ST7789_GLYPH_MAX_WIDTH];
+    uint16_t lut[16];
+    uint8_t n = 0;
+
+    if ((len == 0) || !ST7789_Clip(&x0, &y0, &x1, &y1))
+    {
+        return;
+    }
+    x += st7789_org_x;
+    y += st7789_org_y;
+    if (font->bpp > 1)
+    {
+        ST7789_BlendLut(lut, font->bpp, color, bgcolor);
+    }
+    ST7789_StartWrite((uint16_t)x0, (uint16_t)y0, (uint16_t)x1, (uint16_t)y1);
+    for (uint16_t i = (uint16_t)(y0 - y); i <= y1 - y; i++)
+    {
+        uint16_t *row = st7789_line_buffer[n];
+        uint16_t *p = row;
+        int32_t cx = x;
+        for (uint16_t c = 0; (c < len) && (cx <= x1); c++)
+        {
+            const FontGlyph *g = Font_Glyph(font, str[c]);
+            uint8_t adv = Font_Advance(font, g);
+            if ((cx >= x0) && (cx + adv - 1 <= x1))
+            {
+                p = ST7789_ExpandGlyph(p, font, g, i, adv, color, bgcolor, lut);
+            }
+            else if ((cx + adv > x0) && (adv <= ST7789_GLYPH_MAX_WIDTH))
+            {
+                /* glyph at the edge of viewport */
+                int32_t from = (cx < x0) ? x0 - cx : 0;
+                int32_t to = (cx + adv - 1 > x1) ? x1 - cx : adv - 1;
+                ST7789_ExpandGlyph(part, font, g, i, adv, color, bgcolor, lut);
+                for (int32_t k = from; k <= to; k++)
+                {
+                    *p++ = part[k];
+                }
+            }
+            cx += adv;
+        }
+        ST7789_WritePixels(row, (size_t)(p - row));
+        n ^= 1;
+    }
+}
+
 /**
  * @brief Write a char
  * @param  x&y -> cursor of the start point.
@@ -456,38 +1205,65 @@ void ST7789_InvertColors(uint8_t invert)
  * @param color -> color of the char
  * @param bgcolor -> background color of the char
  * @return  none
+ *
+ * Glyph is sent in one burst from cache of expanded glyphs, least
+ * recently used glyph is replaced on miss. Glyphs bigger than
+ * {@link #ST7789_GLYPH_CACHE_PIXELS} or cut by viewport are sent
+ * as text run.
  */
 void ST7789_WriteChar(uint16_t x, uint16_t y, char ch,
               FontDef font, uint16_t color, uint16_t bgcolor)
 {
-    uint32_t i, b, j;
-    ST7789_Select();
-    ST7789_SetAddressWindow(x, y, (uint16_t)(x + font.width - 1),
-                (uint16_t)(y + font.height - 1));
+    const FontGlyph *glyph = Font_Glyph(&font, ch);
+    uint8_t width = Font_Advance(&font, glyph);
+    uint16_t size = (uint16_t)(width * font.height);
+    st7789_glyph_t *g = &st7789_glyph_cache[0];
+    int32_t x0 = x, y0 = y, x1 = x + width - 1, y1 = y + font.height - 1;
+
+    if ((size > ST7789_GLYPH_CACHE_PIXELS) || !ST7789_Clip(&x0, &y0, &x1, &y1) ||
+        (x1 - x0 + 1 != width) || (y1 - y0 + 1 != font.height))
+    {
+        ST7789_WriteRun(x, y, &ch, 1, &font, color, bgcolor);
+        return;
+    }
 
-    for (i = 0; i < font.height; i++)
+    for (uint16_t i = 0; i < ST7789_GLYPH_CACHE_SIZE; i++)
     {
-        b = (uint32_t)(font.data[(uint32_t)(ch - 32) * (uint32_t)(font.height + i)]
-            );
-        for (j = 0; j < font.width; j++)
+        st7789_glyph_t *e = &st7789_glyph_cache[i];
+        if ((e->glyph == glyph) && (e->widths == font.widths) &&
+            (e->color == color) && (e->bgcolor == bgcolor))
         {
-            if ((b << j) & 0x8000)
-            {
-                uint8_t data[] = {(uint8_t)(color >> 8),
-                                  (uint8_t)(color & 0xFF)
-                                 };
-                ST7789_WriteData(data, sizeof(data));
-            }
-            else
-            {
-                uint8_t data[] = {(uint8_t)(bgcolor >> 8),
-                                  (uint8_t)(bgcolor & 0xFF)
-                                 };
-                ST7789_WriteData(data, sizeof(data));
-            }
+            g = e;
+            break;
+        }
+        if (e->used < g->used)
+        {
+            g = e;
         }
     }
-    ST7789_UnSelect();
+
+    /* entry may be still in use by previous transfer */
+    ST7789_StartWrite((uint16_t)x0, (uint16_t)y0, (uint16_t)x1, (uint16_t)y1);
+    if ((g->glyph != glyph) || (g->widths != font.widths) ||
+        (g->color != color) || (g->bgcolor != bgcolor))
+    {
+        uint16_t *p = g->pixels;
+        uint16_t lut[16];
+        if (font.bpp > 1)
+        {
+            ST7789_BlendLut(lut, font.bpp, color, bgcolor);
+        }
+        for (uint16_t i = 0; i < font.height; i++)
+        {
+            p = ST7789_ExpandGlyph(p, &font, glyph, i, width, color, bgcolor, lut);
+        }
+        g->glyph = glyph;
+        g->widths = font.widths;
+        g->color = color;
+        g->bgcolor = bgcolor;
+    }
+    g->used = ++st7789_glyph_clock;
+    ST7789_WritePixels(g->pixels, size);
 }
 
 /**
@@ -498,34 +1274,57 @@ void ST7789_WriteChar(uint16_t x, uint16_t y, char ch,
  * @param color -> color of the string
  * @param bgcolor -> background color of the string
  * @return  none
+ *
+ * Every line of text is sent as one run, see {@link #ST7789_WriteRun}.
+ * Text is wrapped at the right edge of viewport, line cut by its
+ * bottom is drawn partially.
  */
 void ST7789_WriteString(uint16_t x, uint16_t y, const char *str,
             FontDef font, uint16_t color, uint16_t bgcolor)
 {
-    ST7789_Select();
+    int32_t right = st7789_clip_x1 - st7789_org_x + 1;
+    int32_t bottom = st7789_clip_y1 - st7789_org_y;
+
+    if (y > bottom)
+    {
+        return;
+    }
     while (*str)
     {
-        if (x + font.width >= ST7789_WIDTH)
+        uint16_t len = 0;
+        int32_t end = x;
+        while (str[len])
         {
-            x = 0;
-            y = (uint16_t)(y + font.height);
-            if (y + font.height >= ST7789_HEIGHT)
+            end += Font_Advance(&font, Font_Glyph(&font, str[len]));
+            if (end > right)
             {
                 break;
             }
+            len++;
+        }
+        if (len > 0)
+        {
+            ST7789_WriteRun(x, y, str, len, &font, color, bgcolor);
+            str += len;
+        }
+        if (*str == 0)
+        {
+            break;
+        }
 
-            if (*str == ' ')
-            {
-                // skip spaces in the beginning of the new line
-                str++;
-                continue;
-            }
+        /* next line */
+        x = 0;
+        y = (uint16_t)(y + font.height);
+        if (y > bottom)
+        {
+            break;
+        }
+        while (*str == ' ')
+        {
+            // skip spaces in the beginning of the new line
+            str++;
         }
-        ST7789_WriteChar(x, y, *str, font, color, bgcolor);
-        x = (uint16_t)(x + font.width);
-        str++;
     }
-    ST7789_UnSelect();
 }
 
 /**
@@ -534,38 +1333,12 @@ void ST7789_WriteString(uint16_t x, uint16_t y, const char *str,
  * @param w&h -> width & height of the Rectangle
  * @param color -> color of the Rectangle
  * @return  none
+ *
+ * Columns x..x+w and rows y..y+h are filled.
  */
 void ST7789_DrawFilledRectangle(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color)
 {
-    ST7789_Select();
-    uint8_t i;
-
-    /* Check input parameters */
-    if (x >= ST7789_WIDTH ||
-        y >= ST7789_HEIGHT)
-    {
-        /* Return error */
-        return;
-    }
-
-    /* Check width and height */
-    if ((x + w) >= ST7789_WIDTH)
-    {
-        w = (uint16_t)(ST7789_WIDTH - x);
-    }
-    if ((y + h) >= ST7789_HEIGHT)
-    {
-        h = (uint16_t)(ST7789_HEIGHT - y);
-    }
-
-    /* Draw lines */
-    for (i = 0; i <= h; i++)
-    {
-        /* Draw lines */
-        ST7789_DrawLine((uint16_t)(x), (uint16_t)(y + i),
-              (uint16_t)(x + w), (uint16_t)(y + i), color);
-    }
-    ST7789_UnSelect();
+    ST7789_FillRect(x, y, (int32_t)x + w, (int32_t)y + h, color);
 }
 
 /**
@@ -590,77 +1363,81 @@ void ST7789_DrawTriangle(uint16_t x1, uint16_t y1, uint16_t x2,
  * @param x1,y1,x2,y2,x3,y3 -> 3 coordinates of 3 top points.
  * @param color ->color of the triangle
  * @return  none
+ *
+ * Filled by scanlines, one span per row.
  */
 void ST7789_DrawFilledTriangle(uint16_t x1, uint16_t y1, uint16_t x2,
          uint16_t y2, uint16_t x3, uint16_t y3, uint16_t color)
 {
-    ST7789_Select();
-    int16_t deltax = 0, deltay = 0, x = 0, y = 0, xinc1 = 0, xinc2 = 0,
-            yinc1 = 0, yinc2 = 0, den = 0, num = 0, numadd = 0, numpixels = 0,
-            curpixel = 0;
-
-    deltax = (int16_t)(ABS(x2 - x1));
-    deltay = (int16_t)(ABS(y2 - y1));
-    x = (int16_t)(x1);
-    y = (int16_t)(y1);
+    int32_t xa = x1, ya = y1, xb = x2, yb = y2, xc = x3, yc = y3;
+    int32_t swap;
 
-    if (x2 >= x1)
-    {
-        xinc1 = 1;
-        xinc2 = 1;
-    }
-    else
+    /* sort points by row: ya <= yb <= yc */
+    if (ya > yb)
     {
-        xinc1 = -1;
-        xinc2 = -1;
+        swap = ya;
+        ya = yb;
+        yb = swap;
+        swap = xa;
+        xa = xb;
+        xb = swap;
     }
-
-    if (y2 >= y1)
+    if (yb > yc)
     {
-        yinc1 = 1;
-        yinc2 = 1;
+        swap = yb;
+        yb = yc;
+        yc = swap;
+        swap = xb;
+        xb = xc;
+        xc = swap;
     }
-    else
+    if (ya > yb)
     {
-        yinc1 = -1;
-        yinc2 = -1;
+        swap = ya;
+        ya = yb;
+        yb = swap;
+        swap = xa;
+        xa = xb;
+        xb = swap;
     }
 
-    if (deltax >= deltay)
+    if (ya == yc)
     {
-        xinc1 = 0;
-        yinc2 = 0;
-        den = deltax;
-        num = deltax / 2;
-        numadd = deltay;
-        numpixels = deltax;
+        /* all points in one row */
+        int32_t left = xa, right = xa;
+        left = xb < left ? xb : left;
+        left = xc < left ? xc : left;
+        right = xb > right ? xb : right;
+        right = xc > right ? xc : right;
+        ST7789_HSpan(left, right, ya, color);
+        return;
     }
-    else
+
+    int32_t dx_ab = xb - xa, dy_ab = yb - ya;
+    int32_t dx_ac = xc - xa, dy_ac = yc - ya;
+    int32_t dx_bc = xc - xb, dy_bc = yc - yb;
+    int32_t sa = 0, sb = 0;
+    int32_t y;
+    /* row of middle point goes to upper part if lower one is flat */
+    int32_t last = (yb == yc) ? yb : yb - 1;
+
+    /* upper part: edges a-b and a-c */
+    for (y = ya; y <= last; y++)
     {
-        xinc2 = 0;
-        yinc1 = 0;
-        den = deltay;
-        num = deltay / 2;
-        numadd = deltax;
-        numpixels = deltay;
+        ST7789_HSpan(xa + sa / dy_ab, xa + sb / dy_ac, y, color);
+        sa += dx_ab;
+        sb += dx_ac;
     }
 
-    for (curpixel = 0; curpixel <= numpixels; curpixel++)
+    /* lower part: edges b-c and a-c */
+    sa = dx_bc * (y - yb);
+    sb = dx_ac * (y - ya);
+    for (; y <= yc; y++)
     {
-        ST7789_DrawLine((uint16_t)(x), (uint16_t)(y),
-              (uint16_t)(x3), (uint16_t)(y3), color);
-
-        num = (int16_t)(num + numadd);
-        if (num >= den)
-        {
-            num = (int16_t)(num - den);
-            x = (int16_t)(x + xinc1);
-            y = (int16_t)(y + yinc1);
-        }
-        x = (int16_t)(x + xinc2);
-        y = (int16_t)(y + yinc2);
+        ST7789_HSpan(xb + sa / dy_bc, xa + sb / dy_ac, y, color);
+        sa += dx_bc;
+        sb += dx_ac;
     }
-    ST7789_UnSelect();
 }
 
 /**
@@ -669,46 +1446,46 @@ void ST7789_DrawFilledTriangle(uint16_t x1, uint16_t y1, uint16_t x2,
  * @param r -> radius of circle
  * @param color -> color of circle
  * @return  none
+ *
+ * Every row of circle is sent once as one span.
  */
 void ST7789_DrawFilledCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color)
 {
-    ST7789_Select();
-    int16_t f = (int16_t)(1 - r);
-    int16_t ddF_x = 1;
-    int16_t ddF_y = (int16_t)(-2 * r);
-    int16_t x = 0;
-    int16_t y = r;
-
-    ST7789_DrawPixel((uint16_t)(x0), (uint16_t)(y0 + r), color);
-    ST7789_DrawPixel((uint16_t)(x0), (uint16_t)(y0 - r), color);
-    ST7789_DrawPixel((uint16_t)(x0 + r), (uint16_t)(y0), color);
-    ST7789_DrawPixel((uint16_t)(x0 - r), (uint16_t)(y0), color);
-    ST7789_DrawLine((uint16_t)(x0 - r), (uint16_t)(y0),
-          (uint16_t)(x0 + r), (uint16_t)(y0), color);
-
+    int32_t f = 1 - r;
+    int32_t ddF_x = 1;
+    int32_t ddF_y = -2 * r;
+    int32_t x = 0;
+    int32_t y = r;
+    int32_t px = x, py = y; /* previous point */
+
+    ST7789_HSpan(x0 - r, x0 + r, y0, color);
     while (x < y)
     {
         if (f >= 0)
         {
             y--;
-            ddF_y = (int16_t)(ddF_y + 2);
-            f = (int16_t)(f + ddF_y);
+            ddF_y += 2;
+            f += ddF_y;
         }
         x++;
-        ddF_x = (int16_t)(ddF_x + 2);
-        f = (int16_t)(f+ ddF_x);
+        ddF_x += 2;
+        f += ddF_x;
 
-        ST7789_DrawLine((uint16_t)(x0 - x), (uint16_t)(y0 + y),
-              (uint16_t)(x0 + x), (uint16_t)(y0 + y), color);
-        ST7789_DrawLine((uint16_t)(x0 + x), (uint16_t)(y0 - y),
-              (uint16_t)(x0 - x), (uint16_t)(y0 - y), color);
-
-        ST7789_DrawLine((uint16_t)(x0 + y), (uint16_t)(y0 + x),
-              (uint16_t)(x0 - y), (uint16_t)(y0 + x), color);
-        ST7789_DrawLine((uint16_t)(x0 + y), (uint16_t)(y0 - x),
-              (uint16_t)(x0 - y), (uint16_t)(y0 - x), color);
+        /* rows near center change on every step */
+        if (x < y + 1)
+        {
+            ST7789_HSpan(x0 - y, x0 + y, y0 + x, color);
+            ST7789_HSpan(x0 - y, x0 + y, y0 - x, color);
+        }
+        /* rows near top and bottom are sent when they are done */
+        if (y != py)
+        {
+            ST7789_HSpan(x0 - px, x0 + px, y0 + py, color);
+            ST7789_HSpan(x0 - px, x0 + px, y0 - py, color);
+            py = y;
+        }
+        px = x;
     }
-    ST7789_UnSelect();
 }
 
 
@@ -721,9 +1498,461 @@ void ST7789_TearEffect(uint8_t tear)
 {
     ST7789_Select();
     ST7789_WriteCommand(tear ? 0x35 /* TEON */ : 0x34 /* TEOFF */);
+    if (tear)
+    {
+        ST7789_WriteSmallData(0x00);        //      TEM: V-blanking only
+    }
     ST7789_UnSelect();
 }
 
+/**
+ * @brief Define vertical scrolling area
+ * @param top -> first row of scrolling area, rows above are fixed
+ * @param height -> rows in scrolling area, rows below are fixed
+ * @return none
+ *
+ * Scrolling goes along display RAM rows, so rotation must keep rows
+ * horizontal (0 or 2).
+ */
+void ST7789_SetScrollArea(uint16_t top, uint16_t height)
+{
+    uint16_t tfa = (uint16_t)(top + Y_SHIFT);
+    uint16_t bfa = (uint16_t)(ST7789_MEM_HEIGHT - tfa - height);
+    uint8_t data[] = {(uint8_t)(tfa >> 8), (uint8_t)(tfa & 0xFF),
+                      (uint8_t)(height >> 8), (uint8_t)(height & 0xFF),
+                      (uint8_t)(bfa >> 8), (uint8_t)(bfa & 0xFF)
+                     };
+    ST7789_WriteCommand(ST7789_VSCRDEF);
+    ST7789_WriteData(data, sizeof(data));
+}
+
+/**
+ * @brief Set row shown at the top of scrolling area
+ * @param line -> screen row, from top to top + height - 1 of area from
+ *                {@link #ST7789_SetScrollArea}, as VSCSAD takes it
+ * @return none
+ *
+ * Row is absolute, not relative to the top of area: line == top shows
+ * area unscrolled.
+ */
+void ST7789_SetScrollStart(uint16_t line)
+{
+    uint16_t vsp = (uint16_t)(line + Y_SHIFT);
+    uint8_t data[] = {(uint8_t)(vsp >> 8), (uint8_t)(vsp & 0xFF)};
+    ST7789_WriteCommand(ST7789_VSCSAD);
+    ST7789_WriteData(data, sizeof(data));
+}
+
+/**
+ * last received byte of read, its low bit is the next data bit
+ */
+static uint8_t st7789_read_carry;
+
+/**
+ * @brief Send read command and switch spi to receiving
+ * @param cmd -> read command
+ * @param saved -> spi parameters to restore by {@link #ST7789_ReadEnd}
+ * @return errno - 0 (ok), ETIME (timeout)
+ *
+ * Spi clock is lowered to {@link #ST7789_READ_BAUDRATE} if it is
+ * faster. Panel shifts out one dummy bit first, so one byte is
+ * received ahead and data bytes are taken across byte boundaries.
+ * Line stays input till {@link #ST7789_ReadEnd}, so all
+ * {@link #ST7789_ReadBytes} of command get one continuous stream.
+ */
+static uint16_t ST7789_ReadBegin(uint8_t cmd, spi_config_t *saved)
+{
+    spi_config_t cfg;
+
+    ST7789_WaitIdle();
+    spi_set_frame_16bit(ST7789_SPI, FALSE);
+    spi_get_config(ST7789_SPI, saved);
+    cfg = *saved;
+    if (cfg.baudrate < ST7789_READ_BAUDRATE)
+    {
+        cfg.baudrate = ST7789_READ_BAUDRATE;
+        spi_configure(ST7789_SPI, &cfg);
+    }
+    ST7789_WriteCommand(cmd);
+    ST7789_Select();
+    ST7789_DC_Set();
+    return spi_receive_2wire_8bit(ST7789_SPI, &st7789_read_carry, 1,
+                                  ST7789_SPI_TIMEOUT);
+}
+
+/**
+ * @brief Receive data bytes of read command
+ * @param buff -> destination
+ * @param size -> count of bytes
+ * @return errno - 0 (ok), ETIME (timeout)
+ */
+static uint16_t ST7789_ReadBytes(uint8_t *buff, size_t size)
+{
+    uint16_t res = spi_receive_2wire_8bit(ST7789_SPI, buff, (uint16_t)size,
+                                          ST7789_SPI_TIMEOUT);
+    for (size_t i = 0; i < size; i++)
+    {
+        uint8_t next = buff[i];
+        buff[i] = (uint8_t)((st7789_read_carry << 1) | (next >> 7));
+        st7789_read_carry = next;
+    }
+    return res;
+}
+
+/**
+ * @brief End of read, restore spi parameters
+ * @param saved -> parameters from {@link #ST7789_ReadBegin}
+ * @return none
+ */
+static void ST7789_ReadEnd(const spi_config_t *saved)
+{
+    /* line turns to output with panel deselected */
+    ST7789_UnSelect();
+    spi_receive_2wire_end(ST7789_SPI);
+    spi_configure(ST7789_SPI, saved);
+}
+
+/**
+ * @brief Read display ID
+ * @param id -> 3 bytes: manufacturer, version, driver
+ * @return errno - 0 (ok), ETIME (timeout)
+ */
+uint16_t ST7789_ReadID(uint8_t *id)
+{
+    spi_config_t saved;
+    uint16_t res = ST7789_ReadBegin(ST7789_RDDID, &saved);
+
+    if (res == 0)
+    {
+        res = ST7789_ReadBytes(id, 3);
+    }
+    ST7789_ReadEnd(&saved);
+    return res;
+}
+
+/**
+ * @brief Read display status
+ * @param status -> RDDST word, see ST7789_STATUS_...
+ * @return errno - 0 (ok), ETIME (timeout)
+ */
+uint16_t ST7789_ReadStatus(uint32_t *status)
+{
+    spi_config_t saved;
+    uint8_t st[4] = {0, 0, 0, 0};
+    uint16_t res = ST7789_ReadBegin(ST7789_RDDST, &saved);
+
+    if (res == 0)
+    {
+        res = ST7789_ReadBytes(st, sizeof(st));
+    }
+    ST7789_ReadEnd(&saved);
+    *status = ((uint32_t)st[0] << 24) | ((uint32_t)st[1] << 16) |
+              ((uint32_t)st[2] << 8) | st[3];
+    return res;
+}
+
+/**
+ * @brief Receive next pixels of RAMRD by one transfer
+ * @param pixels -> destination, RGB565
+ * @param count -> count of pixels, up to {@link #ST7789_READ_CHUNK}
+ * @return errno - 0 (ok), ETIME (timeout)
+ *
+ * Panel gives 18-bit pixels, every color in high bits of its byte.
+ */
+static uint16_t ST7789_ReadPixelRun(uint16_t *pixels, size_t count)
+{
+    uint8_t rgb[ST7789_READ_CHUNK * 3];
+    const uint8_t *p = rgb;
+    uint16_t res = ST7789_ReadBytes(rgb, count * 3);
+
+    for (size_t i = 0; i < count; i++, p += 3)
+    {
+        pixels[i] = (uint16_t)(((p[0] & 0xf8) << 8) | ((p[1] & 0xfc) << 3) | (p[2] >> 3));
+    }
+    return res;
+}
+
+/**
+ * @brief Read pixels of window from display memory
+ * @param x0,y0,x1,y1 -> coordinates of window, must be inside of screen
+ * @param pixels -> destination, RGB565, row by row
+ * @return errno - 0 (ok), ETIME (timeout)
+ */
+uint16_t ST7789_ReadPixels(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1,
+                           uint16_t *pixels)
+{
+    size_t count = (size_t)(x1 - x0 + 1) * (size_t)(y1 - y0 + 1);
+    spi_config_t saved;
+    uint16_t res;
+
+    ST7789_Select();
+    ST7789_SetWindow(x0, y0, x1);
+    res = ST7789_ReadBegin(ST7789_RAMRD, &saved);
+    for (size_t i = 0; (i < count) && (res == 0); i += ST7789_READ_CHUNK)
+    {
+        size_t n = count - i;
+        res = ST7789_ReadPixelRun(&pixels[i], (n < ST7789_READ_CHUNK) ? n : ST7789_READ_CHUNK);
+    }
+    ST7789_ReadEnd(&saved);
+    return res;
+}
+
+/**
+ * @brief Update CRC32 with RGB565 pixels
+ * @param crc -> CRC of previous pixels, 0 at start
+ * @param pixels -> pixels
+ * @param count -> count of pixels
+ * @return new CRC
+ *
+ * Pixels are taken high byte first, as they are sent to panel, so
+ * CRC of drawn data is compared with {@link #ST7789_ReadCRC}.
+ */
+uint32_t ST7789_CrcPixels(uint32_t crc, const uint16_t *pixels, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        uint8_t b[2] = {(uint8_t)(pixels[i] >> 8), (uint8_t)(pixels[i] & 0xff)};
+        crc = crc32_update(crc, b, sizeof(b));
+    }
+    return crc;
+}
+
+/**
+ * @brief Read window from display memory and CRC it
+ * @param x0,y0,x1,y1 -> coordinates of window, must be inside of screen
+ * @param crc -> CRC32 of pixels, see {@link #ST7789_CrcPixels}
+ * @return errno - 0 (ok), ETIME (timeout)
+ *
+ * Window is read by one RAMRD in runs of {@link #ST7789_READ_CHUNK}
+ * pixels, they are not stored, so window may be as large as screen.
+ */
+uint16_t ST7789_ReadCRC(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint32_t *crc)
+{
+    size_t count = (size_t)(x1 - x0 + 1) * (size_t)(y1 - y0 + 1);
+    spi_config_t saved;
+    uint16_t res;
+
+    *crc = 0;
+    ST7789_Select();
+    ST7789_SetWindow(x0, y0, x1);
+    res = ST7789_ReadBegin(ST7789_RAMRD, &saved);
+    for (size_t i = 0; (i < count) && (res == 0); i += ST7789_READ_CHUNK)
+    {
+        uint16_t run[ST7789_READ_CHUNK];
+        size_t n = count - i;
+        n = (n < ST7789_READ_CHUNK) ? n : ST7789_READ_CHUNK;
+        res = ST7789_ReadPixelRun(run, n);
+        *crc = ST7789_CrcPixels(*crc, run, n);
+    }
+    ST7789_ReadEnd(&saved);
+    return res;
+}
+
+/**
+ * @brief Start CRC of drawing to check it by {@link #ST7789_CheckEnd}
+ * @return none
+ */
+void ST7789_CheckStart(void)
+{
+    st7789_check_windows = 0;
+    st7789_check_pixels = 0;
+    st7789_check_crc = 0;
+    st7789_check_on = TRUE;
+}
+
+/**
+ * @brief Read back window drawn after {@link #ST7789_CheckStart} and compare CRC
+ * @param result -> counters, added to previous ones
+ * @return errno - 0 (ok or skipped), EIO (CRC differs), ETIME (timeout)
+ *
+ * CRC of pixels is computed while they are sent, so the check costs
+ * one read of drawn window only. Drawing of several windows, ex. text
+ * wrapped to the next line, or nothing drawn is skipped.
+ */
+uint16_t ST7789_CheckEnd(st7789_check_t *result)
+{
+    uint32_t width = (uint32_t)(st7789_check_x1 - st7789_check_x0 + 1);
+    uint16_t res;
+
+    st7789_check_on = FALSE;
+    if ((st7789_check_windows != 1) || (st7789_check_pixels == 0) ||
+        (st7789_check_pixels % width != 0))
+    {
+        result->skipped++;
+        return 0;
+    }
+    res = ST7789_ReadCRC(st7789_check_x0, st7789_check_y0, st7789_check_x1,
+                         (uint16_t)(st7789_check_y0 + st7789_check_pixels / width - 1),
+                         &result->crc);
+    if (res != 0)
+    {
+        result->errors++;
+        return res;
+    }
+    result->checked++;
+    result->expected = st7789_check_crc;
+    if (result->crc != st7789_check_crc)
+    {
+        result->errors++;
+        return EIO;
+    }
+    return 0;
+}
+
+/**
+ * @brief Write test pattern at current spi clock and check it by read
+ * @param seed -> makes pattern differ from previous one
+ * @return TRUE if pattern is read back unchanged
+ */
+static boolean ST7789_CheckPattern(uint16_t seed)
+{
+    uint16_t *pattern = st7789_line_buffer[0];
+    uint16_t *back = st7789_line_buffer[1];
+    uint16_t count = ST7789_CAL_WIDTH * ST7789_CAL_HEIGHT;
+
+    ST7789_WaitIdle();
+    for (uint16_t i = 0; i < count; i++)
+    {
+        /* every bit of both bytes toggles over the window */
+        pattern[i] = (uint16_t)(i * 0x9e37U + seed * 0x3b1fU);
+    }
+    ST7789_StartWrite(0, 0, ST7789_CAL_WIDTH - 1, ST7789_CAL_HEIGHT - 1);
+    ST7789_WritePixels(pattern, count);
+    if (ST7789_ReadPixels(0, 0, ST7789_CAL_WIDTH - 1, ST7789_CAL_HEIGHT - 1, back) != 0)
+    {
+        return FALSE;
+    }
+    return crc32_update(0, (const uint8_t *)pattern, count * sizeof(uint16_t)) ==
+           crc32_update(0, (const uint8_t *)back, count * sizeof(uint16_t));
+}
+
+/**
+ * @brief Find fastest spi clock which display takes without errors
+ * @param link -> found setting and measured fill rate
+ * @return errno - 0 (ok), EIO (no display or even slowest clock fails)
+ *
+ * Prescaler is stepped down from slowest clock while
+ * {@link #ST7789_CAL_ROUNDS} different test patterns written at it are
+ * read back unchanged, fastest good one is kept in spi. Test window and
+ * screen are filled with black after it.
+ */
+uint16_t ST7789_Calibrate(st7789_link_t *link)
+{
+    static const uint8_t expected[] = {ST7789_ID1, ST7789_ID2, ST7789_ID3};
+    uint8_t id[3];
+    spi_config_t cfg;
+    int16_t best = -1;
+    uint8_t r;
+    uint32_t start, ms;
+
+    if ((ST7789_ReadID(id) != 0) || (id[0] != expected[0]) ||
+        (id[1] != expected[1]) || (id[2] != expected[2]))
+    {
+        return EIO;
+    }
+    spi_get_config(ST7789_SPI, &cfg);
+    for (int16_t baudrate = SPI_BAUDRATE_SLOWEST; baudrate >= 0; baudrate--)
+    {
+        cfg.baudrate = (uint8_t)baudrate;
+        spi_configure(ST7789_SPI, &cfg);
+        for (r = 0; r < ST7789_CAL_ROUNDS; r++)
+        {
+            if (!ST7789_CheckPattern((uint16_t)(baudrate * ST7789_CAL_ROUNDS + r)))
+            {
+                break;
+            }
+        }
+        if (r < ST7789_CAL_ROUNDS)
+        {
+            break;
+        }
+        best = baudrate;
+    }
+    cfg.baudrate = (best < 0) ? SPI_BAUDRATE_SLOWEST : (uint8_t)best;
+    spi_configure(ST7789_SPI, &cfg);
+    if (best < 0)
+    {
+        ST7789_Fill_Color(BLACK);
+        ST7789_WaitIdle();
+        return EIO;
+    }
+
+    start = hw_time_ms();
+    for (uint8_t i = 0; i < ST7789_CAL_FILLS; i++)
+    {
+        ST7789_Fill_Color(BLACK);
+    }
+    ST7789_WaitIdle();
+    ms = hw_time_ms() - start;
+    link->baudrate = cfg.baudrate;
+    link->clock_hz = spi_clock_hz(ST7789_SPI, cfg.baudrate);
+    link->fill_rate = (uint32_t)((uint64_t)ST7789_CAL_FILLS * ST7789_WIDTH *
+                                 ST7789_HEIGHT * 1000U / (ms ? ms : 1U));
+    return 0;
+}
+
+/**
+ * @brief Test display link by screens of noise read back by CRC
+ * @param result -> counters, added to previous ones
+ * @param rounds -> screens to write
+ * @return errno - 0 (ok), EIO (screen or status differs), ETIME (timeout)
+ *
+ * Screen is written at current spi clock and read back at
+ * {@link #ST7789_READ_BAUDRATE}, CRC of written rows is computed
+ * while dma sends them. Display status is checked after every screen,
+ * so panel reset by glitch is found too. Screen is black after it.
+ */
+uint16_t ST7789_Verify(st7789_verify_t *result, uint16_t rounds)
+{
+    uint32_t seed = result->rounds * 0x9e3779b9UL + 1;
+    uint16_t res = 0;
+    boolean failed = FALSE;
+
+    for (uint16_t r = 0; (r < rounds) && (res == 0); r++)
+    {
+        uint32_t expected = 0;
+        uint8_t n = 0;
+
+        ST7789_StartWrite(0, 0, ST7789_WIDTH - 1, ST7789_HEIGHT - 1);
+        for (uint16_t y = 0; y < ST7789_HEIGHT; y++)
+        {
+            /* row was sent two rows ago, it is free */
+            uint16_t *row = st7789_line_buffer[n];
+            for (uint16_t x = 0; x < ST7789_WIDTH; x++)
+            {
+                seed = seed * 1103515245UL + 12345UL;
+                row[x] = (uint16_t)(seed >> 16);
+            }
+            ST7789_WritePixels(row, ST7789_WIDTH);
+            expected = ST7789_CrcPixels(expected, row, ST7789_WIDTH);
+            n ^= 1;
+        }
+        res = ST7789_ReadCRC(0, 0, ST7789_WIDTH - 1, ST7789_HEIGHT - 1, &result->crc);
+        if (res == 0)
+        {
+            res = ST7789_ReadStatus(&result->status);
+        }
+        if (res != 0)
+        {
+            break;
+        }
+        result->rounds++;
+        result->expected = expected;
+        if (result->crc != expected)
+        {
+            result->errors++;
+            failed = TRUE;
+        }
+        if ((result->status & ST7789_STATUS_CHECK) != ST7789_STATUS_RUNNING)
+        {
+            result->status_errors++;
+            failed = TRUE;
+        }
+    }
+    ST7789_Fill_Color(BLACK);
+    ST7789_WaitIdle();
+    return res ? res : (failed ? EIO : 0);
+}
 
 /**
  * @brief A Simple test function for ST7789
@@ -791,9 +2020,8 @@ void ST7789_Test(void)
     delay_ms(1000);
     send_string("end\r\n");
 
-    //      If FLASH cannot storage anymore datas, please delete codes below.
     ST7789_Fill_Color(WHITE);
-    ST7789_DrawImage(0, 0, 128, 128, (uint16_t *)saber);
+    ST7789_DrawPackedImage(0, 0, &image_saber);
     delay_ms(3000);
 //    }
 }
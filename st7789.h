@@ -12,7 +12,9 @@
 #ifndef ST7789_H_
 #define ST7789_H_
 
+#include <stddef.h>
 #include "fonts.h"
+#include "image.h"
 #include "config_hw.h"
 
 /**
@@ -39,6 +41,9 @@
 #define USING_240X240
 
 
+/* Rows of display RAM, used by vertical scrolling */
+#define ST7789_MEM_HEIGHT 320
+
 /* Choose a display rotation you want to use: (0-3) */
 //#define ST7789_ROTATION 0
 //#define ST7789_ROTATION 1
@@ -147,6 +152,8 @@
 #define ST7789_RAMRD   0x2E
 
 #define ST7789_PTLAR   0x30
+#define ST7789_VSCRDEF 0x33
+#define ST7789_VSCSAD  0x37
 #define ST7789_COLMOD  0x3A
 #define ST7789_MADCTL  0x36
 
@@ -173,6 +180,42 @@
 #define ST7789_RDID3   0xDC
 #define ST7789_RDID4   0xDD
 
+/* Display ID read by RDDID: manufacturer, version, driver */
+#define ST7789_ID1     0x85
+#define ST7789_ID2     0x85
+#define ST7789_ID3     0x52
+
+/**
+ * bits of display status read by RDDST, first byte is the highest
+ * @{
+ */
+#define ST7789_STATUS_BOOSTER   0x80000000UL
+#define ST7789_STATUS_MADCTL    0x7e000000UL /** MY, MX, MV, ML, RGB, MH */
+#define ST7789_STATUS_IFPF      0x00700000UL /** interface pixel format */
+#define ST7789_STATUS_IFPF_16   0x00500000UL
+#define ST7789_STATUS_PTLON     0x00040000UL
+#define ST7789_STATUS_SLPOUT    0x00020000UL
+#define ST7789_STATUS_NORON     0x00010000UL
+#define ST7789_STATUS_INVON     0x00002000UL
+#define ST7789_STATUS_DISPON    0x00000400UL
+#define ST7789_STATUS_TEON      0x00000200UL
+/**
+ * @}
+ */
+
+/**
+ * status bits of running panel checked by {@link #ST7789_Verify},
+ * panel reset by glitch is in sleep with 18-bit pixels
+ * @{
+ */
+#define ST7789_STATUS_CHECK   (ST7789_STATUS_IFPF | ST7789_STATUS_SLPOUT | \
+                               ST7789_STATUS_NORON | ST7789_STATUS_DISPON)
+#define ST7789_STATUS_RUNNING (ST7789_STATUS_IFPF_16 | ST7789_STATUS_SLPOUT | \
+                               ST7789_STATUS_NORON | ST7789_STATUS_DISPON)
+/**
+ * @}
+ */
+
 /* Advanced options */
 /**
  * Caution: Do not operate these settings
@@ -201,19 +244,135 @@
 
 #define ABS(x) ((x) > 0 ? (x) : -(x))
 
+/**
+ * timeout of single spi transfer to display in ticks,
+ * full screen at slowest spi clock takes ~3.3s
+ */
+#define ST7789_SPI_TIMEOUT pdMS_TO_TICKS(5000)
+
+/**
+ * count of expanded glyphs in cache of ST7789_WriteChar()
+ */
+#define ST7789_GLYPH_CACHE_SIZE 4
+
+/**
+ * max pixels of cached glyph, 11x18 font fits
+ */
+#define ST7789_GLYPH_CACHE_PIXELS (11 * 18)
+
+/**
+ * max advance of glyph cut by viewport, glyph rows are 16 bit
+ */
+#define ST7789_GLYPH_MAX_WIDTH 16
+
+/**
+ * spi baudrate of reads, fpclk/16 (4.5MHz on SPI1), panel gives data
+ * not faster than 6.6MHz
+ */
+#define ST7789_READ_BAUDRATE 3
+
+/**
+ * pixels of RAMRD received by one spi transfer, 3 bytes of stack each
+ */
+#define ST7789_READ_CHUNK 32
+
+/**
+ * test window of {@link #ST7789_Calibrate} at top left corner
+ * @{
+ */
+#define ST7789_CAL_WIDTH  16
+#define ST7789_CAL_HEIGHT 4
+/**
+ * @}
+ */
+
+/**
+ * test patterns which must pass at spi clock, so marginal clock that
+ * passes once by chance is not taken by {@link #ST7789_Calibrate}
+ */
+#define ST7789_CAL_ROUNDS 3
+
+/**
+ * full screen fills timed by {@link #ST7789_Calibrate}
+ */
+#define ST7789_CAL_FILLS 4
+
+/**
+ * unknown rotation, MADCTL is sent by next ST7789_SetRotation()
+ */
+#define ST7789_ROTATION_UNKNOWN 0xff
+
+/**
+ * counters of commands not sent thanks to cached panel state
+ */
+typedef struct //vera++ blamed for single space
+{
+    uint32_t windows;       /** address windows set by drawing */
+    uint32_t caset_skipped; /** windows with the same columns */
+    uint32_t raset_skipped; /** windows with the same first row */
+    uint32_t continued;     /** windows written by current RAMWR */
+    uint32_t saved;         /** command and parameter bytes not sent */
+} st7789_cache_stats_t;
+
+extern st7789_cache_stats_t st7789_cache_stats;
+
+/**
+ * spi link to display found by {@link #ST7789_Calibrate}
+ */
+typedef struct //vera++ blamed for single space
+{
+    uint8_t baudrate;       /** fastest stable spi baudrate setting */
+    uint32_t clock_hz;      /** spi clock of it */
+    uint32_t fill_rate;     /** pixels per second of full screen fill */
+} st7789_link_t;
+
+/**
+ * results of display link test by {@link #ST7789_Verify}
+ */
+typedef struct //vera++ blamed for single space
+{
+    uint32_t rounds;        /** screens written and read back */
+    uint32_t errors;        /** screens read back with other CRC */
+    uint32_t status_errors; /** rounds with panel not running */
+    uint32_t status;        /** last display status */
+    uint32_t expected;      /** CRC of last written screen */
+    uint32_t crc;           /** CRC of last screen read back */
+} st7789_verify_t;
+
+/**
+ * results of drawing checks by {@link #ST7789_CheckEnd}
+ */
+typedef struct //vera++ blamed for single space
+{
+    uint32_t checked;       /** drawn windows read back */
+    uint32_t errors;        /** windows read back with other CRC or not read */
+    uint32_t skipped;       /** drawings of several windows or none */
+    uint32_t expected;      /** CRC of last checked drawing */
+    uint32_t crc;           /** CRC of last window read back */
+} st7789_check_t;
+
 /* Basic functions. */
 void ST7789_Init(void);
 void ST7789_SetRotation(uint8_t m);
+void ST7789_Invalidate(void);
 void ST7789_Fill_Color(uint16_t color);
 void ST7789_DrawPixel(uint16_t x, uint16_t y, uint16_t color);
 void ST7789_Fill(uint16_t xSta, uint16_t ySta, uint16_t xEnd, uint16_t yEnd, uint16_t color);
 void ST7789_DrawPixel_4px(uint16_t x, uint16_t y, uint16_t color);
+void ST7789_WaitIdle(void);
+void ST7789_StartWrite(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1);
+void ST7789_WritePixels(const uint16_t *pixels, size_t count);
+
+/* Viewport, drawing functions below it take local coordinates. */
+void ST7789_SetViewport(uint16_t x, uint16_t y, uint16_t w, uint16_t h);
+void ST7789_ResetViewport(void);
 
 /* Graphical functions. */
 void ST7789_DrawLine(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color);
 void ST7789_DrawRectangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color);
 void ST7789_DrawCircle(uint16_t x0, uint16_t y0, uint8_t r, uint16_t color);
 void ST7789_DrawImage(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint16_t *data);
+void ST7789_DrawPackedImage(uint16_t x, uint16_t y, const image_t *img);
 void ST7789_InvertColors(uint8_t invert);
 
 /* Text functions. */
@@ -232,6 +391,20 @@ void ST7789_DrawFilledCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color);
 
 /* Command functions */
 void ST7789_TearEffect(uint8_t tear);
+void ST7789_SetScrollArea(uint16_t top, uint16_t height);
+void ST7789_SetScrollStart(uint16_t line);
+
+/* Read functions */
+uint16_t ST7789_ReadID(uint8_t *id);
+uint16_t ST7789_ReadPixels(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1,
+                           uint16_t *pixels);
+uint16_t ST7789_ReadStatus(uint32_t *status);
+uint16_t ST7789_ReadCRC(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint32_t *crc);
+uint32_t ST7789_CrcPixels(uint32_t crc, const uint16_t *pixels, size_t count);
+uint16_t ST7789_Calibrate(st7789_link_t *link);
+uint16_t ST7789_Verify(st7789_verify_t *result, uint16_t rounds);
+void ST7789_CheckStart(void);
+uint16_t ST7789_CheckEnd(st7789_check_t *result);
 
 /* Simple test function. */
 void ST7789_Test(void);
@@ -0,0 +1,412 @@
+/** @weakgroup tests
+ *  @{
+ */
+/**
+ * @file st7789_emu.c
+ * @brief host emulator of ST7789 panel for tests
+ *
+ * Copyright 2020 Stanislav V. Vlasov <stanislav.v.v@gmail.com>
+ *
+ * Only CASET, RASET, RAMWR, RAMRD, RDDID, RDDST, MADCTL, COLMOD, INVON,
+ * INVOFF, SLPIN, SLPOUT, NORON, DISPON, DISPOFF, VSCRDEF and VSCSAD
+ * commands are processed, others are ignored. Read data is
+ * clocked out after one dummy bit, as on serial interface of panel.
+ */
+
+#include <stdio.h>
+#include "hw.h"
+#include "st7789.h"
+#include "st7789_emu.h"
+#include "utils.h"
+
+uint16_t st7789_emu_mem[ST7789_EMU_MEM_HEIGHT][ST7789_EMU_MEM_WIDTH];
+uint32_t st7789_emu_written = 0;
+
+/**
+ * emulator state
+ * @{
+ */
+static uint8_t emu_cmd = ST7789_NOP;
+static uint16_t emu_param = 0;   /** parameter byte number after command */
+static uint16_t emu_xs = 0, emu_xe = ST7789_EMU_MEM_WIDTH - 1;
+static uint16_t emu_ys = 0, emu_ye = ST7789_EMU_MEM_HEIGHT - 1;
+static uint16_t emu_x = 0, emu_y = 0; /** memory write pointer */
+static uint8_t emu_high = 0;     /** first byte of pixel */
+static uint16_t emu_tfa = 0;     /** top fixed area rows */
+static uint16_t emu_vsa = ST7789_EMU_MEM_HEIGHT; /** scrolling area rows */
+static uint16_t emu_vsp = 0;     /** scroll start address */
+static uint8_t emu_params[6];    /** parameters of current command */
+static uint8_t emu_madctl = 0;   /** memory access control */
+static boolean emu_invert = TRUE; /** INVON state */
+static uint8_t emu_colmod = ST7789_COLOR_MODE_16bit; /** pixel format */
+static boolean emu_awake = TRUE;  /** SLPOUT state */
+static boolean emu_normal = TRUE; /** NORON state */
+static boolean emu_on = TRUE;     /** DISPON state */
+static uint32_t emu_read = 0;    /** read byte number after command */
+static uint8_t emu_read_last = 0; /** previous read byte before dummy bit shift */
+/**
+ * @}
+ */
+
+/**
+ * @brief map write address to panel memory by MADCTL
+ * @param col, row - address in CASET/RASET space
+ * @param mx, my - panel memory column and row
+ */
+static void emu_map(uint16_t col, uint16_t row, uint16_t *mx, uint16_t *my)
+{
+    if (emu_madctl & ST7789_MADCTL_MV)
+    {
+        uint16_t t = col;
+        col = row;
+        row = t;
+    }
+    if (emu_madctl & ST7789_MADCTL_MX)
+    {
+        col = (uint16_t)(ST7789_EMU_MEM_WIDTH - 1 - col);
+    }
+    if (emu_madctl & ST7789_MADCTL_MY)
+    {
+        row = (uint16_t)(ST7789_EMU_MEM_HEIGHT - 1 - row);
+    }
+    *mx = col;
+    *my = row;
+}
+
+/**
+ * @brief move memory pointer to next pixel of window
+ */
+static void emu_next_pixel(void)
+{
+    emu_x++;
+    if (emu_x > emu_xe)
+    {
+        emu_x = emu_xs;
+        emu_y++;
+        if (emu_y > emu_ye)
+        {
+            emu_y = emu_ys;
+        }
+    }
+}
+
+/**
+ * @brief store pixel at memory pointer and move pointer
+ * @param color - RGB565 color
+ */
+static void emu_put_pixel(uint16_t color)
+{
+    uint16_t mx, my;
+
+    emu_map(emu_x, emu_y, &mx, &my);
+    if ((mx < ST7789_EMU_MEM_WIDTH) && (my < ST7789_EMU_MEM_HEIGHT))
+    {
+        st7789_emu_mem[my][mx] = color;
+    }
+    st7789_emu_written++;
+    emu_next_pixel();
+}
+
+/**
+ * @brief next byte of read command response, without dummy bit
+ * @return byte
+ */
+static uint8_t emu_read_byte(void)
+{
+    uint32_t n = emu_read++;
+    uint16_t c, mx, my;
+
+    if (emu_cmd == ST7789_RDDID)
+    {
+        static const uint8_t id[] = {ST7789_ID1, ST7789_ID2, ST7789_ID3};
+        return n < sizeof(id) ? id[n] : 0;
+    }
+    if (emu_cmd == ST7789_RDDST)
+    {
+        uint8_t st[4];
+        st[0] = (uint8_t)((emu_awake ? 0x80 : 0) | ((emu_madctl >> 1) & 0x7e));
+        st[1] = (uint8_t)(((emu_colmod & 0x07) << 4) | (emu_awake ? 0x02 : 0) |
+                          (emu_normal ? 0x01 : 0));
+        st[2] = (uint8_t)((emu_invert ? 0x20 : 0) | (emu_on ? 0x04 : 0));
+        st[3] = 0;
+        return n < sizeof(st) ? st[n] : 0;
+    }
+    if (emu_cmd != ST7789_RAMRD)
+    {
+        return 0xff;
+    }
+    /* 18-bit pixel, every color in high bits of byte */
+    emu_map(emu_x, emu_y, &mx, &my);
+    c = ((mx < ST7789_EMU_MEM_WIDTH) && (my < ST7789_EMU_MEM_HEIGHT)) ?
+        st7789_emu_mem[my][mx] : 0;
+    switch (n % 3)
+    {
+    case 0:
+        return (uint8_t)((c >> 8) & 0xf8);
+    case 1:
+        return (uint8_t)((c >> 3) & 0xfc);
+    default:
+        emu_next_pixel();
+        return (uint8_t)(c << 3);
+    }
+}
+
+/**
+ * @brief fake spi source, response of panel to read command
+ * @return byte on data line
+ */
+static uint8_t emu_source(void)
+{
+    uint8_t last = emu_read_last;
+    emu_read_last = emu_read_byte();
+    return (uint8_t)((last << 7) | (emu_read_last >> 1));
+}
+
+/**
+ * @brief process byte of command parameters or pixel data
+ * @param byte - received byte
+ */
+static void emu_data(uint8_t byte)
+{
+    uint16_t p = emu_param++;
+    switch (emu_cmd)
+    {
+    case ST7789_CASET:
+    case ST7789_RASET:
+    {
+        uint16_t *start = (emu_cmd == ST7789_CASET) ? &emu_xs : &emu_ys;
+        uint16_t *end = (emu_cmd == ST7789_CASET) ? &emu_xe : &emu_ye;
+        if (p == 0) { *start = (uint16_t)(byte << 8); }
+        if (p == 1) { *start = (uint16_t)(*start | byte); }
+        if (p == 2) { *end = (uint16_t)(byte << 8); }
+        if (p == 3) { *end = (uint16_t)(*end | byte); }
+        break;
+    }
+    case ST7789_VSCRDEF:
+    case ST7789_VSCSAD:
+        if (p < sizeof(emu_params))
+        {
+            emu_params[p] = byte;
+        }
+        if ((emu_cmd == ST7789_VSCRDEF) && (p == 5))
+        {
+            emu_tfa = (uint16_t)((emu_params[0] << 8) | emu_params[1]);
+            emu_vsa = (uint16_t)((emu_params[2] << 8) | emu_params[3]);
+        }
+        if ((emu_cmd == ST7789_VSCSAD) && (p == 1))
+        {
+            emu_vsp = (uint16_t)((emu_params[0] << 8) | emu_params[1]);
+        }
+        break;
+    case ST7789_MADCTL:
+        emu_madctl = byte;
+        break;
+    case ST7789_COLMOD:
+        emu_colmod = byte;
+        break;
+    case ST7789_RAMWR:
+        if (p & 1)
+        {
+            emu_put_pixel((uint16_t)((emu_high << 8) | byte));
+        }
+        else
+        {
+            emu_high = byte;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief fake spi sink
+ * @param byte - sent byte
+ * @param data - DC line state
+ */
+static void emu_sink(uint8_t byte, boolean data)
+{
+    if (data)
+    {
+        emu_data(byte);
+        return;
+    }
+    emu_cmd = byte;
+    emu_param = 0;
+    if ((byte == ST7789_INVON) || (byte == ST7789_INVOFF))
+    {
+        emu_invert = (byte == ST7789_INVON);
+    }
+    if ((byte == ST7789_SLPIN) || (byte == ST7789_SLPOUT))
+    {
+        emu_awake = (byte == ST7789_SLPOUT);
+    }
+    if ((byte == ST7789_DISPON) || (byte == ST7789_DISPOFF))
+    {
+        emu_on = (byte == ST7789_DISPON);
+    }
+    if (byte == ST7789_NORON)
+    {
+        emu_normal = TRUE;
+    }
+    if ((byte == ST7789_RAMWR) || (byte == ST7789_RAMRD))
+    {
+        emu_x = emu_xs;
+        emu_y = emu_ys;
+    }
+    emu_read = 0;
+    emu_read_last = 0;
+}
+
+/**
+ * @brief connect emulator to fake spi and clear panel memory
+ * @param color - initial color of panel memory
+ *
+ * Panel state is as after {@link #ST7789_Init} with rotation 2:
+ * MADCTL is 0 and inversion is on. Driver forgets cached panel state,
+ * as for new panel.
+ */
+void st7789_emu_attach(uint16_t color)
+{
+    for (uint16_t y = 0; y < ST7789_EMU_MEM_HEIGHT; y++)
+    {
+        for (uint16_t x = 0; x < ST7789_EMU_MEM_WIDTH; x++)
+        {
+            st7789_emu_mem[y][x] = color;
+        }
+    }
+    emu_cmd = ST7789_NOP;
+    emu_param = 0;
+    emu_tfa = 0;
+    emu_vsa = ST7789_EMU_MEM_HEIGHT;
+    emu_vsp = 0;
+    emu_madctl = 0;
+    emu_invert = TRUE;
+    emu_colmod = ST7789_COLOR_MODE_16bit;
+    emu_awake = TRUE;
+    emu_normal = TRUE;
+    emu_on = TRUE;
+    st7789_emu_written = 0;
+    emu_read = 0;
+    emu_read_last = 0;
+    fake_spi_sink = emu_sink;
+    fake_spi_source = emu_source;
+    ST7789_Invalidate();
+}
+
+/**
+ * @brief hardware reset of panel, as by glitch on reset line
+ *
+ * Memory is kept, panel is in sleep with display off, 18-bit pixels,
+ * MADCTL 0 and inversion off. Driver is not told about it.
+ */
+void st7789_emu_reset(void)
+{
+    emu_cmd = ST7789_NOP;
+    emu_param = 0;
+    emu_madctl = 0;
+    emu_invert = FALSE;
+    emu_colmod = ST7789_COLOR_MODE_18bit;
+    emu_awake = FALSE;
+    emu_on = FALSE;
+    emu_normal = TRUE;
+    emu_tfa = 0;
+    emu_vsa = ST7789_EMU_MEM_HEIGHT;
+    emu_vsp = 0;
+}
+
+/**
+ * @brief disconnect emulator from fake spi
+ */
+void st7789_emu_detach(void)
+{
+    fake_spi_sink = NULL;
+    fake_spi_source = NULL;
+}
+
+/**
+ * @brief get pixel at screen coordinates
+ * @param x, y - screen coordinates as given to st7789.c
+ * @return RGB565 color
+ */
+uint16_t st7789_emu_pixel(uint16_t x, uint16_t y)
+{
+    uint16_t mx, my;
+
+    emu_map((uint16_t)(x + X_SHIFT), (uint16_t)(y + Y_SHIFT), &mx, &my);
+    /* rows of scrolling area are shown from scroll start address */
+    if ((my >= emu_tfa) && (my < emu_tfa + emu_vsa) && (emu_vsp >= emu_tfa))
+    {
+        my = (uint16_t)(emu_tfa + (emu_vsp - emu_tfa + my - emu_tfa) % emu_vsa);
+    }
+    if ((mx >= ST7789_EMU_MEM_WIDTH) || (my >= ST7789_EMU_MEM_HEIGHT))
+    {
+        return 0;
+    }
+    return st7789_emu_mem[my][mx];
+}
+
+/**
+ * @brief get color seen on panel at screen coordinates
+ * @param x, y - screen coordinates as given to st7789.c
+ * @return RGB565 color
+ */
+uint16_t st7789_emu_shown(uint16_t x, uint16_t y)
+{
+    uint16_t c = st7789_emu_pixel(x, y);
+    /* IPS panel is inverted, INVON shows true colors */
+    return emu_invert ? c : (uint16_t)~c;
+}
+
+/**
+ * @brief CRC32 of screen region as seen on panel
+ * @param x, y, w, h - region in screen coordinates
+ * @return CRC32 of colors, row by row, high byte first
+ */
+uint32_t st7789_emu_crc(uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+{
+    uint32_t crc = 0;
+    for (uint16_t j = y; j < y + h; j++)
+    {
+        for (uint16_t i = x; i < x + w; i++)
+        {
+            uint16_t c = st7789_emu_shown(i, j);
+            uint8_t b[2] = {(uint8_t)(c >> 8), (uint8_t)(c & 0xff)};
+            crc = crc32_update(crc, b, sizeof(b));
+        }
+    }
+    return crc;
+}
+
+/**
+ * @brief write screen region to binary PPM file
+ * @param path - file name
+ * @param x, y, w, h - region in screen coordinates
+ * @return 0 on success
+ */
+int st7789_emu_write_ppm(const char *path, uint16_t x, uint16_t y,
+                         uint16_t w, uint16_t h)
+{
+    FILE *f = fopen(path, "wb");
+    if (f == NULL)
+    {
+        return -1;
+    }
+    fprintf(f, "P6\n%u %u\n255\n", w, h);
+    for (uint16_t j = y; j < y + h; j++)
+    {
+        for (uint16_t i = x; i < x + w; i++)
+        {
+            uint16_t c = st7789_emu_shown(i, j);
+            uint8_t rgb[3];
+            rgb[0] = (uint8_t)(((c >> 11) & 0x1f) * 255 / 31);
+            rgb[1] = (uint8_t)(((c >> 5) & 0x3f) * 255 / 63);
+            rgb[2] = (uint8_t)((c & 0x1f) * 255 / 31);
+            fwrite(rgb, 1, sizeof(rgb), f);
+        }
+    }
+    fclose(f);
+    return 0;
+}
+
+/** @}*/
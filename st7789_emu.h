@@ -0,0 +1,92 @@
+/** @weakgroup tests
+ *  @{
+ */
+/**
+ * @file st7789_emu.h
+ * @brief host emulator of ST7789 panel for tests
+ *
+ * Copyright 2020 Stanislav V. Vlasov <stanislav.v.v@gmail.com>
+ *
+ * Receives bytes from fake spi (see hw_fake.h) and draws RAMWR data
+ * into panel memory, so drawing results may be checked pixel by pixel.
+ * Memory access order (MADCTL), inversion and vertical scrolling are
+ * applied as on panel.
+ */
+
+#ifndef ST7789_EMU_H_
+#define ST7789_EMU_H_
+
+#include <stdint.h>
+
+/**
+ * panel memory size, ST7789 has 240x320 pixels of RAM
+ * @{
+ */
+#define ST7789_EMU_MEM_WIDTH  240
+#define ST7789_EMU_MEM_HEIGHT 320
+/**
+ * @}
+ */
+
+/**
+ * panel memory in RGB565
+ */
+extern uint16_t st7789_emu_mem[ST7789_EMU_MEM_HEIGHT][ST7789_EMU_MEM_WIDTH];
+
+/**
+ * pixels written by RAMWR since attach
+ */
+extern uint32_t st7789_emu_written;
+
+/**
+ * @brief connect emulator to fake spi and clear panel memory
+ * @param color - initial color of panel memory
+ */
+void st7789_emu_attach(uint16_t color);
+
+/**
+ * @brief hardware reset of panel, as by glitch on reset line
+ */
+void st7789_emu_reset(void);
+
+/**
+ * @brief disconnect emulator from fake spi
+ */
+void st7789_emu_detach(void);
+
+/**
+ * @brief get pixel at screen coordinates
+ * @param x, y - screen coordinates as given to st7789.c
+ * @return RGB565 color in panel memory
+ *
+ * Coordinates are mapped by current MADCTL, vertical scrolling is
+ * applied, as panel shows it.
+ */
+uint16_t st7789_emu_pixel(uint16_t x, uint16_t y);
+
+/**
+ * @brief get color seen on panel at screen coordinates
+ * @param x, y - screen coordinates as given to st7789.c
+ * @return RGB565 color, inverted if INVOFF is set on IPS panel
+ */
+uint16_t st7789_emu_shown(uint16_t x, uint16_t y);
+
+/**
+ * @brief CRC32 of screen region as seen on panel
+ * @param x, y, w, h - region in screen coordinates
+ * @return CRC32 of colors, row by row, high byte first
+ */
+uint32_t st7789_emu_crc(uint16_t x, uint16_t y, uint16_t w, uint16_t h);
+
+/**
+ * @brief write screen region to binary PPM file, as seen on panel
+ * @param path - file name
+ * @param x, y, w, h - region in screen coordinates
+ * @return 0 on success
+ */
+int st7789_emu_write_ppm(const char *path, uint16_t x, uint16_t y,
+                         uint16_t w, uint16_t h);
+
+#endif
+
+/** @}*/
@@ -48,6 +48,22 @@ static inline boolean strncmp_local(const char *s1, const char *s2, uint16_t n)
     return TRUE;
 }
 
+/**
+ * @brief strings order
+ * @param *first - first string
+ * @param *second - second string
+ * @return <0 if first goes before second, 0 if equal, >0 if after
+ */
+static inline int16_t strcmp_local(const char *first, const char *second)
+{
+    while ((*first == *second) && (*first != '\0'))
+    {
+        first++;
+        second++;
+    }
+    return (int16_t)((uint8_t)*first - (uint8_t)*second);
+}
+
 /**
  * @brief strings comparation function
  * @param *first - first string
@@ -103,6 +119,52 @@ static inline void itoa_u16(uint16_t n, char s[])
     reverse(s);
 }
 
+/**
+ * @brief convert decimal string s to uint16_t
+ * @param s string of digits only
+ * @param n result will be here, untouched on error
+ * @return FALSE if s is empty, has not a digit or number is above 65535
+ */
+static inline boolean atoi_u16(const char *s, uint16_t *n)
+{
+    uint32_t v = 0;
+    if (*s == '\0')
+    {
+        return FALSE;
+    }
+    for (; *s != '\0'; s++)
+    {
+        if ((*s < '0') || (*s > '9'))
+        {
+            return FALSE;
+        }
+        v = v * 10 + (uint32_t)(*s - '0');
+        if (v > 0xffffU)
+        {
+            return FALSE;
+        }
+    }
+    *n = (uint16_t)v;
+    return TRUE;
+}
+
+/**
+ * @brief convert uint32_t n to characters in s
+ * @param n number to convert
+ * @param s[] result will be here, 11 chars at least
+ * @return none
+ */
+static inline void itoa_u32(uint32_t n, char s[])
+{
+    uint16_t i = 0;
+    do
+    {
+        s[i++] = (char)(n % 10 + '0');
+    } while ((n /= 10) > 0);
+    s[i] = '\0';
+    reverse(s);
+}
+
 /**
  * @brief convert int16_t n to characters in s with sign
  * @param n number to convert
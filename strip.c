@@ -0,0 +1,250 @@
+/** @weakgroup hardware
+ *  @{
+ */
+/**
+ * @file strip.c
+ * @brief double-buffered strip renderer for ST7789
+ *
+ * Copyright 2020 Stanislav V. Vlasov <stanislav.v.v@gmail.com>
+ */
+
+#include <stdint.h>
+#include "strip.h"
+
+/**
+ * bands: one is composed while another is sent
+ */
+static uint16_t strip_buffer[2][STRIP_ROWS * ST7789_WIDTH];
+
+/**
+ * @brief draw horizontal span, parts outside of band are skipped
+ * @param band - band
+ * @param x0, x1 - first and last column
+ * @param y - row
+ * @param color - color
+ */
+static void strip_span(strip_band_t *band, int32_t x0, int32_t x1, int32_t y, uint16_t color)
+{
+    uint16_t *p;
+
+    if ((y < band->y0) || (y > band->y1) || (x1 < 0) || (x0 >= ST7789_WIDTH))
+    {
+        return;
+    }
+    x0 = x0 < 0 ? 0 : x0;
+    x1 = x1 >= ST7789_WIDTH ? ST7789_WIDTH - 1 : x1;
+    p = &band->pixels[(uint32_t)(y - band->y0) * ST7789_WIDTH + (uint32_t)x0];
+    for (int32_t x = x0; x <= x1; x++)
+    {
+        *p++ = color;
+    }
+}
+
+/**
+ * @brief draw screen rows by bands
+ * @param y0, y1 - first and last screen row
+ * @param bgcolor - color of band before scene is drawn
+ * @param scene - scene callback, called once per band from top
+ * @param ctx - context of callback
+ *
+ * Returns while the last band is sent. Band is filled by cpu, not by
+ * dma: dma is busy with previous band.
+ */
+void strip_render(uint16_t y0, uint16_t y1, uint16_t bgcolor, strip_scene_t scene, void *ctx)
+{
+    strip_band_t band;
+    uint8_t n = 0;
+
+    if (y1 >= ST7789_HEIGHT)
+    {
+        y1 = ST7789_HEIGHT - 1;
+    }
+    if (y0 > y1)
+    {
+        return;
+    }
+    ST7789_StartWrite(0, y0, ST7789_WIDTH - 1, y1);
+    for (uint32_t y = y0; y <= y1; y += STRIP_ROWS)
+    {
+        uint32_t count;
+
+        band.pixels = strip_buffer[n];
+        band.y0 = (uint16_t)y;
+        band.y1 = (uint16_t)(y + STRIP_ROWS - 1 > y1 ? y1 : y + STRIP_ROWS - 1);
+        count = (uint32_t)(band.y1 - band.y0 + 1) * ST7789_WIDTH;
+        /* band was sent two bands ago, it is free */
+        for (uint32_t i = 0; i < count; i++)
+        {
+            band.pixels[i] = bgcolor;
+        }
+        scene(&band, ctx);
+        ST7789_WritePixels(band.pixels, count);
+        n ^= 1;
+    }
+}
+
+/**
+ * @brief fill rectangle
+ * @param band - band
+ * @param x0, y0, x1, y1 - screen coordinates of corners, inclusive
+ * @param color - color
+ */
+void strip_fill(strip_band_t *band, uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1,
+                uint16_t color)
+{
+    uint16_t top = y0 > band->y0 ? y0 : band->y0;
+    uint16_t bottom = y1 < band->y1 ? y1 : band->y1;
+
+    for (uint16_t y = top; y <= bottom; y++)
+    {
+        strip_span(band, x0, x1, y, color);
+    }
+}
+
+/**
+ * @brief draw line
+ * @param band - band
+ * @param x0, y0, x1, y1 - screen coordinates of ends
+ * @param color - color
+ *
+ * Lines not crossing band are skipped at once, others are walked
+ * by Bresenham from the top down to the last row of band.
+ */
+void strip_line(strip_band_t *band, uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1,
+                uint16_t color)
+{
+    int32_t ax = x0, ay = y0, bx = x1, by = y1;
+    int32_t swap;
+
+    if (((ay < band->y0) && (by < band->y0)) || ((ay > band->y1) && (by > band->y1)))
+    {
+        return;
+    }
+    if (ay > by)
+    {
+        swap = ax;
+        ax = bx;
+        bx = swap;
+        swap = ay;
+        ay = by;
+        by = swap;
+    }
+    int32_t dx = ABS(bx - ax);
+    int32_t dy = by - ay;
+    int32_t sx = ax < bx ? 1 : -1;
+    int32_t err = dx - dy;
+
+    while (ay <= band->y1)
+    {
+        int32_t e2 = 2 * err;
+        strip_span(band, ax, ax, ay, color);
+        if ((ax == bx) && (ay == by))
+        {
+            break;
+        }
+        if (e2 > -dy)
+        {
+            err -= dy;
+            ax += sx;
+        }
+        if (e2 < dx)
+        {
+            err += dx;
+            ay++;
+        }
+    }
+}
+
+/**
+ * @brief draw filled circle
+ * @param band - band
+ * @param x0, y0 - screen coordinates of center
+ * @param r - radius
+ * @param color - color
+ *
+ * Only rows of band are computed, row is a span of pixels with
+ * x^2 + y^2 <= r^2 + r.
+ */
+void strip_filled_circle(strip_band_t *band, int16_t x0, int16_t y0, int16_t r, uint16_t color)
+{
+    int32_t top = y0 - r > band->y0 ? y0 - r : band->y0;
+    int32_t bottom = y0 + r < band->y1 ? y0 + r : band->y1;
+    int32_t limit = (int32_t)r * r + r;
+
+    for (int32_t y = top; y <= bottom; y++)
+    {
+        int32_t dy = y - y0;
+        int32_t w = 0;
+        while ((w + 1) * (w + 1) + dy * dy <= limit)
+        {
+            w++;
+        }
+        strip_span(band, x0 - w, x0 + w, y, color);
+    }
+}
+
+/**
+ * @brief draw text line
+ * @param band - band
+ * @param x, y - top left corner
+ * @param str - text, cut at the right edge of screen
+ * @param font - font, anti-aliased one is drawn without blending
+ * @param color, bgcolor - colors
+ */
+void strip_text(strip_band_t *band, uint16_t x, uint16_t y, const char *str,
+                const FontDef *font, uint16_t color, uint16_t bgcolor)
+{
+    uint32_t top = y > band->y0 ? y : band->y0;
+    uint32_t bottom = (uint32_t)y + font->height - 1;
+
+    bottom = bottom < band->y1 ? bottom : band->y1;
+    for (uint32_t row = top; row <= bottom; row++)
+    {
+        uint16_t *p = &band->pixels[(row - band->y0) * ST7789_WIDTH];
+        uint32_t cx = x;
+        for (const char *c = str; (*c != 0) && (cx < ST7789_WIDTH); c++)
+        {
+            const FontGlyph *g = Font_Glyph(font, *c);
+            uint8_t adv = Font_Advance(font, g);
+            uint16_t bits = Font_Row(font, g, (uint16_t)(row - y));
+            for (uint8_t j = 0; (j < adv) && (cx < ST7789_WIDTH); j++)
+            {
+                p[cx++] = (bits & 0x8000) ? color : bgcolor;
+                bits = (uint16_t)(bits << 1);
+            }
+        }
+    }
+}
+
+/**
+ * @brief draw RGB565 image
+ * @param band - band
+ * @param x, y - top left corner
+ * @param w, h - size of image
+ * @param data - pixels, row by row
+ */
+void strip_image(strip_band_t *band, uint16_t x, uint16_t y, uint16_t w, uint16_t h,
+                 const uint16_t *data)
+{
+    uint32_t top = y > band->y0 ? y : band->y0;
+    uint32_t bottom = (uint32_t)y + h - 1;
+    uint32_t cols = (uint32_t)(ST7789_WIDTH - x);
+
+    if ((w == 0) || (h == 0) || (x >= ST7789_WIDTH))
+    {
+        return;
+    }
+    bottom = bottom < band->y1 ? bottom : band->y1;
+    cols = cols < w ? cols : w;
+    for (uint32_t row = top; row <= bottom; row++)
+    {
+        uint16_t *p = &band->pixels[(row - band->y0) * ST7789_WIDTH + x];
+        const uint16_t *s = &data[(row - y) * w];
+        for (uint32_t i = 0; i < cols; i++)
+        {
+            *p++ = *s++;
+        }
+    }
+}
+
+/** @}*/
@@ -0,0 +1,106 @@
+/** @weakgroup hardware
+ *  @{
+ */
+/**
+ * @file strip.h
+ * @brief double-buffered strip renderer for ST7789
+ *
+ * Copyright 2020 Stanislav V. Vlasov <stanislav.v.v@gmail.com>
+ *
+ * Scene is drawn band by band: every band of {@link #STRIP_ROWS} rows
+ * is composed in RAM by scene callback while the previous band is sent
+ * by dma, so the screen is redrawn at nearly raw spi speed and every
+ * pixel is sent once. Whole area is one address window.
+ *
+ * Two bands take 2 * STRIP_ROWS * ST7789_WIDTH * 2 bytes of RAM, so
+ * strip renderer and framebuffer are not used together.
+ */
+
+#ifndef STRIP_H_
+#define STRIP_H_
+
+#include <stdint.h>
+#include "fonts.h"
+#include "st7789.h"
+
+/**
+ * rows of band
+ */
+#define STRIP_ROWS 4
+
+/**
+ * band of screen rows being composed
+ */
+typedef struct //vera++ blamed for single space
+{
+    uint16_t *pixels;       /** RGB565, ST7789_WIDTH pixels per row */
+    uint16_t y0, y1;        /** first and last screen row */
+} strip_band_t;
+
+/**
+ * scene callback, draws everything crossing band by strip_* functions
+ */
+typedef void (*strip_scene_t)(strip_band_t *band, void *ctx);
+
+/**
+ * @brief draw screen rows by bands
+ * @param y0, y1 - first and last screen row
+ * @param bgcolor - color of band before scene is drawn
+ * @param scene - scene callback, called once per band from top
+ * @param ctx - context of callback
+ *
+ * Returns while the last band is sent.
+ */
+void strip_render(uint16_t y0, uint16_t y1, uint16_t bgcolor, strip_scene_t scene, void *ctx);
+
+/**
+ * @brief fill rectangle
+ * @param band - band
+ * @param x0, y0, x1, y1 - screen coordinates of corners, inclusive
+ * @param color - color
+ */
+void strip_fill(strip_band_t *band, uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1,
+                uint16_t color);
+
+/**
+ * @brief draw line
+ * @param band - band
+ * @param x0, y0, x1, y1 - screen coordinates of ends
+ * @param color - color
+ */
+void strip_line(strip_band_t *band, uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1,
+                uint16_t color);
+
+/**
+ * @brief draw filled circle
+ * @param band - band
+ * @param x0, y0 - screen coordinates of center
+ * @param r - radius
+ * @param color - color
+ */
+void strip_filled_circle(strip_band_t *band, int16_t x0, int16_t y0, int16_t r, uint16_t color);
+
+/**
+ * @brief draw text line
+ * @param band - band
+ * @param x, y - top left corner
+ * @param str - text, cut at the right edge of screen
+ * @param font - font, anti-aliased one is drawn without blending
+ * @param color, bgcolor - colors
+ */
+void strip_text(strip_band_t *band, uint16_t x, uint16_t y, const char *str,
+                const FontDef *font, uint16_t color, uint16_t bgcolor);
+
+/**
+ * @brief draw RGB565 image
+ * @param band - band
+ * @param x, y - top left corner
+ * @param w, h - size of image
+ * @param data - pixels, row by row
+ */
+void strip_image(strip_band_t *band, uint16_t x, uint16_t y, uint16_t w, uint16_t h,
+                 const uint16_t *data);
+
+#endif
+
+/** @}*/
@@ -11,11 +11,41 @@
  */
 
 #include <assert.h>
+#include <errno.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
 #include "shell_process.h"
 #include "strings_local.h"
 #include "utils.h"
+#include "hw.h"
+#include "st7789.h"
+#include "st7789_emu.h"
+#include "fonts_raw.h"
+#include "images_raw.h"
+#include "image.h"
+#include "display.h"
+#include "framebuffer.h"
+#include "waterfall.h"
+#include "spectrum.h"
+#include "strip.h"
+#include "widget.h"
+#include "ring.h"
+
+/**
+ * speed asserts are off in build with sanitizers, instrumented code
+ * has other proportions of cost; busy host may switch them off by
+ * -DTEST_TIMING=0
+ */
+#ifndef TEST_TIMING
+#ifdef __SANITIZE_ADDRESS__
+#define TEST_TIMING 0
+#else
+#define TEST_TIMING 1
+#endif
+#endif
 
 /** test reverse_bits */
 void test_reverse_bits(void)
@@ -87,6 +117,16 @@ void test_itoa_u16(void)
     assert(!strcmp("12345", a));
 }
 
+/** test itoa_u32 */
+void test_itoa_u32(void)
+{
+    char a[12];
+    itoa_u32(4294967295U, a);
+    assert(!strcmp("4294967295", a));
+    itoa_u32(0, a);
+    assert(!strcmp("0", a));
+}
+
 /** test reverse */
 void test_reverse(void)
 {
@@ -122,6 +162,35 @@ void test_strlen_local(void)
     assert(strlen(a) == strlen_local(a));
 }
 
+/** test strcmp_local */
+void test_strcmp_local(void)
+{
+    assert(strcmp_local("led", "led") == 0);
+    assert(strcmp_local("lcdtest", "led") < 0);
+    assert(strcmp_local("led", "lcdtest") > 0);
+    assert(strcmp_local("ls", "lsx") < 0);
+    assert(strcmp_local("lsx", "ls") > 0);
+    assert(strcmp_local("", "a") < 0);
+    assert(strcmp_local("\x80", "a") > 0);
+}
+
+/** test decimal string parsing */
+void test_atoi_u16(void)
+{
+    uint16_t n = 7;
+    assert(atoi_u16("0", &n) && (n == 0));
+    assert(atoi_u16("60", &n) && (n == 60));
+    assert(atoi_u16("65535", &n) && (n == 65535));
+    n = 7;
+    assert(!atoi_u16("", &n));
+    assert(!atoi_u16("foo", &n));
+    assert(!atoi_u16("6x", &n));
+    assert(!atoi_u16("-1", &n));
+    assert(!atoi_u16("65536", &n));
+    assert(!atoi_u16("99999999999", &n));
+    assert(n == 7);
+}
+
 /** test shell command arguments processing */
 void test_shell_process_args(void)
 {
@@ -143,6 +212,341 @@ void test_shell_process_unknown(void)
     assert(!strcmp("UNKNOWN: aaa\r\n", shell_output_buffer));
 }
 
+/** test splitting of command line to words */
+void test_shell_tokenize(void)
+{
+    char line[SHELL_MAX_CLI_LENGTH + 1];
+    char *argv[5];
+    uint16_t argc = 99;
+
+    strcpy(line, "");
+    assert(shell_tokenize(line, argv, 4, &argc) == 0 && argc == 0);
+    strcpy(line, " \t  ");
+    assert(shell_tokenize(line, argv, 4, &argc) == 0 && argc == 0);
+
+    // repeated separators give no empty words
+    strcpy(line, "  led \t on  ");
+    assert(shell_tokenize(line, argv, 4, &argc) == 0 && argc == 2);
+    assert(!strcmp(argv[0], "led") && !strcmp(argv[1], "on"));
+
+    // quotes and escapes, words stay in line
+    strcpy(line, "a\"b c\"d 'x \\\"y' \"\" e\\ f \"\\\"\"");
+    assert(shell_tokenize(line, argv, 5, &argc) == 0 && argc == 5);
+    assert(!strcmp(argv[0], "ab cd"));
+    assert(!strcmp(argv[1], "x \\\"y"));
+    assert(!strcmp(argv[2], ""));
+    assert(!strcmp(argv[3], "e f"));
+    assert(!strcmp(argv[4], "\""));
+    assert(argv[0] == line);
+    assert(argv[4] < line + sizeof(line));
+
+    // overflow keeps first words
+    strcpy(line, "1 2 3 4 5 6");
+    assert(shell_tokenize(line, argv, 4, &argc) == E2BIG && argc == 4);
+    assert(!strcmp(argv[3], "4"));
+
+    // unterminated quote and escape
+    strcpy(line, "say \"hi there");
+    assert(shell_tokenize(line, argv, 4, &argc) == EINVAL && argc == 2);
+    assert(!strcmp(argv[1], "hi there"));
+    strcpy(line, "say hi\\");
+    assert(shell_tokenize(line, argv, 4, &argc) == EINVAL && argc == 2);
+    assert(!strcmp(argv[1], "hi"));
+
+    // shell gives quoted words to command
+    strcpy(shell_input_buffer, "  args  \"a b\"  c\\ d ''");
+    shell_process();
+    assert(!strcmp("arguments count: 3\r\nargument 0: a b\r\nargument 1: c d\r\n"
+                   "argument 2: \r\n", shell_output_buffer));
+    strcpy(shell_input_buffer, "args 1 2 3 4 5 6 7 8 9");
+    shell_process();
+    assert(!strcmp("ERROR: too many arguments\r\n", shell_output_buffer));
+    strcpy(shell_input_buffer, "args 'a");
+    shell_process();
+    assert(!strcmp("ERROR: unterminated quote or escape\r\n", shell_output_buffer));
+    strcpy(shell_input_buffer, "   ");
+    shell_process();
+    assert(!strcmp("", shell_output_buffer));
+}
+
+/**
+ * reference splitting of line to words, copies words out
+ */
+static uint16_t test_tokenize_ref(const char *line, char words[][SHELL_MAX_CLI_LENGTH + 1],
+                                  uint16_t max, uint16_t *argc)
+{
+    uint16_t n = 0, len = 0;
+    boolean in_word = FALSE;
+    char quote = 0;
+
+    *argc = 0;
+    for (const char *p = line; *p != '\0'; p++)
+    {
+        char c = *p;
+        if (!in_word)
+        {
+            if ((c == ' ') || (c == '\t'))
+            {
+                continue;
+            }
+            if (n == max)
+            {
+                return E2BIG;
+            }
+            in_word = TRUE;
+            len = 0;
+            *argc = ++n;
+        }
+        if (quote == '\'')
+        {
+            quote = (c == '\'') ? 0 : quote;
+            if (quote != 0)
+            {
+                words[n - 1][len++] = c;
+            }
+        }
+        else if (c == '\\')
+        {
+            if (p[1] == '\0')
+            {
+                words[n - 1][len] = 0;
+                return EINVAL;
+            }
+            words[n - 1][len++] = *++p;
+        }
+        else if ((quote == '"') && (c == '"'))
+        {
+            quote = 0;
+        }
+        else if ((quote == 0) && ((c == '"') || (c == '\'')))
+        {
+            quote = c;
+        }
+        else if ((quote == 0) && ((c == ' ') || (c == '\t')))
+        {
+            in_word = FALSE;
+        }
+        else
+        {
+            words[n - 1][len++] = c;
+        }
+        words[n - 1][len] = 0;
+    }
+    return (quote != 0) ? EINVAL : 0;
+}
+
+/** fuzz of splitting of command line: random lines against reference */
+void test_shell_tokenize_fuzz(void)
+{
+    static const char alphabet[] = "ab  \t\"'\\";
+    static const char *const names[] = {"args", "hello", "help", "ls", "nope", ""};
+    const uint32_t rounds = 300000;
+    char line[SHELL_MAX_CLI_LENGTH + 1 + 8];
+    char copy[SHELL_MAX_CLI_LENGTH + 1];
+    char words[SHELL_MAX_ARGS + 2][SHELL_MAX_CLI_LENGTH + 1];
+    char *argv[SHELL_MAX_ARGS + 2];
+    uint32_t seed = 2020;
+    uint32_t results[3] = {0, 0, 0};
+
+    for (uint32_t round = 0; round < rounds; round++)
+    {
+        seed = seed * 1103515245U + 12345U;
+        uint16_t len = (uint16_t)((seed >> 16) % (SHELL_MAX_CLI_LENGTH + 1));
+        uint16_t max = (uint16_t)(1 + (seed >> 8) % (SHELL_MAX_ARGS + 1));
+        for (uint16_t i = 0; i < len; i++)
+        {
+            seed = seed * 1103515245U + 12345U;
+            char c = alphabet[(seed >> 16) % (sizeof(alphabet) - 1)];
+            // sometimes any byte, zero ends line earlier
+            line[i] = ((seed >> 27) == 0) ? (char)(seed >> 8) : c;
+        }
+        line[len] = 0;
+        memset(&line[len + 1], 0x5a, sizeof(line) - len - 1);
+        uint16_t canary = (uint16_t)(len + 1);
+        strcpy(copy, line);
+        len = (uint16_t)strlen(line);
+
+        uint16_t argc = 0xffff, ref_argc = 0xffff;
+        uint16_t ref = test_tokenize_ref(copy, words, max, &ref_argc);
+        uint16_t err = shell_tokenize(line, argv, max, &argc);
+
+        assert(err == ref && argc == ref_argc && argc <= max);
+        results[(err == 0) ? 0 : ((err == E2BIG) ? 1 : 2)]++;
+        for (uint16_t i = 0; i < argc; i++)
+        {
+            // words are in line, in order and do not overlap
+            assert(argv[i] >= line && argv[i] <= line + len);
+            assert(argv[i] + strlen(argv[i]) <= line + len);
+            assert((i == 0) || (argv[i] > argv[i - 1] + strlen(argv[i - 1])));
+            assert(!strcmp(argv[i], words[i]));
+        }
+        for (uint16_t i = canary; i < sizeof(line); i++)
+        {
+            assert(line[i] == 0x5a);
+        }
+    }
+    // every outcome is reached
+    assert(results[0] > 0 && results[1] > 0 && results[2] > 0);
+
+    // whole shell survives the same lines after command names
+    for (uint32_t round = 0; round < rounds / 10; round++)
+    {
+        seed = seed * 1103515245U + 12345U;
+        const char *name = names[(seed >> 16) % (sizeof(names) / sizeof(names[0]))];
+        uint16_t len = (uint16_t)strlen(name);
+        strcpy(shell_input_buffer, name);
+        while (len < SHELL_MAX_CLI_LENGTH && ((seed >> 8) & 7) != 0)
+        {
+            seed = seed * 1103515245U + 12345U;
+            shell_input_buffer[len++] = alphabet[(seed >> 16) % (sizeof(alphabet) - 1)];
+        }
+        shell_input_buffer[len] = 0;
+        shell_process();
+        assert(shell_out_lastchar <= SHELL_MAX_OUT_LENGTH);
+    }
+    shell_cleanup_output();
+    printf("      %-28s %u ok %u overflow %u unterminated\n", "shell_tokenize fuzz",
+           results[0], results[1], results[2]);
+}
+
+/** test lookup in command table and its metadata */
+void test_shell_cmd_table(void)
+{
+    uint16_t n = 0;
+
+    assert(shell_cmd_check());
+    // firmware table is sorted too, test table is part of it
+    assert(shell_cmd_all_count > shell_cmd_count);
+    for (uint16_t i = 0; i < shell_cmd_all_count; i++)
+    {
+        assert((i == 0) || (strcmp_local(shell_cmd_all_names[i - 1], shell_cmd_all_names[i]) < 0));
+        if ((n < shell_cmd_count) && !strcmp(shell_cmd_all_names[i], shell_cmd_table[n].cmd_str))
+        {
+            n++;
+        }
+    }
+    assert(n == shell_cmd_count);
+    assert(shell_cmd_lookup(shell_cmd_table, shell_cmd_count, "lcdtest") == NULL);
+    // hidden commands work but are not listed
+    shell_cleanup_output();
+    shell_cmds(NULL, 0);
+    assert(strstr(shell_output_buffer, "args") == NULL);
+    assert(strstr(shell_output_buffer, "help\r\n") != NULL);
+
+    strcpy(shell_input_buffer, "help ls");
+    shell_process();
+    assert(!strcmp("ls\r\n", shell_output_buffer));
+
+    strcpy(shell_input_buffer, "help nope");
+    shell_process();
+    assert(!strcmp("UNKNOWN: nope\r\n", shell_output_buffer));
+
+    // argument count out of range gives usage
+    strcpy(shell_input_buffer, "help ls args");
+    shell_process();
+    assert(!strcmp("USAGE: help [command]\r\n", shell_output_buffer));
+
+    // prefix or longer name is not a command
+    strcpy(shell_input_buffer, "hel");
+    shell_process();
+    assert(!strcmp("UNKNOWN: hel\r\n", shell_output_buffer));
+    strcpy(shell_input_buffer, "hellos");
+    shell_process();
+    assert(!strcmp("UNKNOWN: hellos\r\n", shell_output_buffer));
+}
+
+/** names of synthetic command table, sorted */
+static char test_cmd_names[64][12];
+
+/** handler of synthetic commands, counts calls */
+static uint32_t test_cmd_calls = 0;
+static void test_cmd_handler(char* argv[], uint16_t argc)
+{
+    (void)argv;
+    (void)argc;
+    test_cmd_calls++;
+}
+
+/** dispatch speed of command table: linear walk against binary search */
+void test_shell_cmd_bench(void)
+{
+    static const char *const prefix[] = {"band", "freq", "mode", "vfo"};
+    static const char *const suffix[] = {"a", "a2", "b", "b2", "dn", "dn2", "get", "get2",
+                                         "lock", "lock2", "mem", "mem2", "set", "set2", "up",
+                                         "up2"};
+    const uint16_t count = 64;
+    const uint32_t dispatches = 200000;
+    shell_cmd_def_t table[64];
+    char mix[256][12];
+    uint32_t seed = 4321;
+    uint32_t found = 0;
+
+    // names are made in sorted order, table is checked below
+    for (uint16_t i = 0; i < count; i++)
+    {
+        snprintf(test_cmd_names[i], sizeof(test_cmd_names[i]), "%s%s", prefix[i / 16],
+                 suffix[i % 16]);
+    }
+    for (uint16_t i = 0; i < count; i++)
+    {
+        table[i] = (shell_cmd_def_t){test_cmd_names[i], test_cmd_handler, 0, 1, 0, ""};
+        assert((i == 0) || (strcmp(table[i - 1].cmd_str, table[i].cmd_str) < 0));
+    }
+    // mix of known commands with some unknown ones
+    for (uint16_t i = 0; i < 256; i++)
+    {
+        seed = seed * 1103515245U + 12345U;
+        if ((seed >> 28) == 0)
+        {
+            snprintf(mix[i], sizeof(mix[i]), "x%u", (seed >> 16) & 0xff);
+        }
+        else
+        {
+            strcpy(mix[i], test_cmd_names[(seed >> 16) % count]);
+        }
+    }
+
+    clock_t t0 = clock();
+    for (uint32_t n = 0; n < dispatches; n++)
+    {
+        const char *name = mix[n & 0xff];
+        for (uint16_t i = 0; i < count; i++)
+        {
+            if (compare_strings(table[i].cmd_str, name))
+            {
+                table[i].cmd(NULL, 0);
+                found++;
+                break;
+            }
+        }
+    }
+    clock_t t1 = clock();
+    uint32_t linear = test_cmd_calls;
+    test_cmd_calls = 0;
+    for (uint32_t n = 0; n < dispatches; n++)
+    {
+        const shell_cmd_def_t *c = shell_cmd_lookup(table, count, mix[n & 0xff]);
+        if (c != NULL)
+        {
+            c->cmd(NULL, 0);
+        }
+    }
+    clock_t t2 = clock();
+    // same commands are found both ways, unknown ones are not
+    assert(linear == found && test_cmd_calls == found);
+    assert(found > dispatches / 2 && found < dispatches);
+    for (uint16_t i = 0; i < count; i++)
+    {
+        assert(shell_cmd_lookup(table, count, test_cmd_names[i]) == &table[i]);
+    }
+    assert(shell_cmd_lookup(table, count, "aaa") == NULL);
+    assert(shell_cmd_lookup(table, count, "zzz") == NULL);
+    assert(shell_cmd_lookup(table, 0, "banda") == NULL);
+    printf("      %-28s %6.1f ns linear %6.1f ns binary, %u commands\n", "command dispatch",
+           (double)(t1 - t0) * 1e9 / CLOCKS_PER_SEC / dispatches,
+           (double)(t2 - t1) * 1e9 / CLOCKS_PER_SEC / dispatches, count);
+}
+
 /** test hello shell command */
 void test_shell_process_hello(void)
 {
@@ -162,6 +566,77 @@ void test_shell_out_buffer_add(void)
     assert(!strcmp(shell_output_buffer, "B"));
 }
 
+/** output given to test sink of shell */
+static char test_shell_sunk[2000];
+static uint16_t test_shell_sunk_len = 0;
+static uint16_t test_shell_sink_calls = 0;
+static const char *test_shell_sink_last = NULL;
+
+/** test sink of shell output, appends chunks */
+static void test_shell_sink(const char *data, uint16_t len)
+{
+    assert((len > 0) && ((data != shell_output_buffer) || (len <= SHELL_MAX_OUT_LENGTH)));
+    assert(test_shell_sunk_len + len < sizeof(test_shell_sunk));
+    memcpy(&test_shell_sunk[test_shell_sunk_len], data, len);
+    test_shell_sunk_len = (uint16_t)(test_shell_sunk_len + len);
+    test_shell_sunk[test_shell_sunk_len] = 0;
+    test_shell_sink_calls++;
+    test_shell_sink_last = data;
+}
+
+/** test streaming of shell output to sink */
+void test_shell_out_stream(void)
+{
+    static const char banner[] = "-- long constant line of output --\r\n";
+    char expected[sizeof(test_shell_sunk)] = "";
+
+    test_shell_sunk_len = 0;
+    test_shell_sink_calls = 0;
+    shell_cleanup_output();
+    shell_out_set_sink(test_shell_sink);
+
+    // copied output is flushed by chunks, nothing is cut
+    for (uint16_t i = 0; i < 100; i++)
+    {
+        shell_out_buffer_add("0123456789");
+        strcat(expected, "0123456789");
+    }
+    assert(test_shell_sink_calls == 1000 / SHELL_MAX_OUT_LENGTH);
+    assert(test_shell_sink_last == shell_output_buffer);
+
+    // long constant goes to sink as is, after buffered output
+    shell_out_const(banner);
+    strcat(expected, banner);
+    assert(test_shell_sink_last == banner);
+    assert(test_shell_sink_calls == 1000 / SHELL_MAX_OUT_LENGTH + 2);
+
+    // short constant is copied
+    shell_out_const("ok\r\n");
+    strcat(expected, "ok\r\n");
+    assert(test_shell_sink_last == banner);
+    shell_out_flush();
+    assert(!strcmp(test_shell_sunk, expected));
+    assert(shell_out_lastchar == 0);
+
+    // whole command output is streamed
+    test_shell_sunk_len = 0;
+    strcpy(shell_input_buffer, "args aaa bbb");
+    shell_process();
+    shell_out_flush();
+    assert(!strcmp("arguments count: 2\r\nargument 0: aaa\r\nargument 1: bbb\r\n",
+           test_shell_sunk));
+
+    // without sink output is kept and cut, as before
+    shell_out_set_sink(NULL);
+    shell_cleanup_output();
+    for (uint16_t i = 0; i < 100; i++)
+    {
+        shell_out_buffer_add("0123456789");
+    }
+    assert(shell_out_lastchar == SHELL_MAX_OUT_LENGTH);
+    shell_cleanup_output();
+}
+
 /** test shell_cleanup_output */
 void test_shell_cleanup_output(void)
 {
@@ -179,6 +654,832 @@ void test_shell_in_buffer_add(void)
     assert(!strcmp(shell_input_buffer, "A"));
 }
 
+/** spi dma callback counter for tests */
+static uint16_t test_dma_callbacks = 0;
+
+/** spi dma callback for tests */
+static void test_dma_callback(uint16_t status)
+{
+    assert(status == 0);
+    test_dma_callbacks++;
+}
+
+/** test spi dma start, busy state and completion callback */
+void test_spi_dma_start_wait(void)
+{
+    uint8_t buf[4] = {1, 2, 3, 4};
+    fake_spi_reset();
+    test_dma_callbacks = 0;
+    spi_dma_set_callback(test_dma_callback);
+    assert(spi_dma_send_start(SPI1, NULL, 4) == EIO);
+    assert(spi_dma_send_start(SPI1, buf, 0) == EIO);
+    assert(spi_dma_send_start(SPI1, buf, 4) == 0);
+    assert(spi_dma_busy(SPI1));
+    assert(spi_dma_send_start(SPI1, buf, 4) == EBUSY);
+    assert(test_dma_callbacks == 0);
+    assert(spi_dma_wait(SPI1, 10) == 0);
+    assert(!spi_dma_busy(SPI1));
+    assert(test_dma_callbacks == 1);
+    assert(fake_spi_stats.bytes == 4);
+    assert(fake_spi_stats.dma_transfers == 1);
+    spi_dma_set_callback(NULL);
+}
+
+/** test spi dma wait timeout */
+void test_spi_dma_timeout(void)
+{
+    uint8_t buf[2] = {0, 0};
+    fake_spi_reset();
+    fake_spi_dma_hang = TRUE;
+    assert(spi_dma_send_start(SPI1, buf, 2) == 0);
+    assert(spi_dma_wait(SPI1, 10) == ETIME);
+    assert(!spi_dma_busy(SPI1));
+    fake_spi_reset();
+}
+
+/** test runtime spi clock and mode changes */
+void test_spi_configure(void)
+{
+    spi_config_t cfg;
+    uint8_t buf[2] = {0, 0};
+
+    fake_spi_reset();
+    spi_get_config(SPI1, &cfg);
+    assert(cfg.baudrate == SPI_BAUDRATE_SLOWEST);
+    assert(spi_clock_hz(SPI1, SPI_BAUDRATE_SLOWEST) == 281250);
+    assert(spi_clock_hz(SPI1, 2) == 9000000);
+    assert(spi_clock_hz(SPI2, 0) == 18000000);
+
+    cfg.baudrate = SPI_BAUDRATE_SLOWEST + 1;
+    assert(spi_configure(SPI1, &cfg) == EINVAL);
+    cfg.baudrate = 2;
+    assert(spi_dma_send_start(SPI1, buf, 2) == 0);
+    fake_spi_dma_hang = TRUE;
+    assert(spi_configure(SPI1, &cfg) == EBUSY);
+    assert(spi_dma_wait(SPI1, 10) == ETIME);
+    assert(spi_configure(SPI1, &cfg) == 0);
+    spi_get_config(SPI1, &cfg);
+    assert(cfg.baudrate == 2);
+
+    // idle data line without panel
+    assert(spi_receive_2wire_8bit(SPI1, buf, 2, 10) == 0);
+    assert((buf[0] == 0xff) && (buf[1] == 0xff));
+    // line is input until end of receive
+    assert(spi_send_buffer_2wire_8bit(SPI1, buf, 2, 10) == EIO);
+    assert(spi_dma_send_start(SPI1, buf, 2) == EIO);
+    spi_receive_2wire_end(SPI1);
+    assert(spi_send_buffer_2wire_8bit(SPI1, buf, 2, 10) == 0);
+    fake_spi_reset();
+}
+
+/** counting byte source for receive tests */
+static uint8_t test_spi_counter;
+static uint8_t test_spi_count(void)
+{
+    return test_spi_counter++;
+}
+
+/** test receive by parts is one stream, stop of receive loses a byte */
+void test_spi_receive_stream(void)
+{
+    uint8_t buf[8];
+
+    fake_spi_reset();
+    fake_spi_source = test_spi_count;
+    test_spi_counter = 0;
+    assert(spi_receive_2wire_8bit(SPI1, buf, 1, 10) == 0);
+    assert(spi_receive_2wire_8bit(SPI1, buf + 1, 3, 10) == 0);
+    assert(spi_receive_2wire_8bit(SPI1, buf + 4, 4, 10) == 0);
+    for (uint8_t i = 0; i < 8; i++)
+    {
+        assert(buf[i] == i);
+    }
+    spi_receive_2wire_end(SPI1);
+    assert(spi_receive_2wire_8bit(SPI1, buf, 2, 10) == 0);
+    assert((buf[0] == 9) && (buf[1] == 10));
+    spi_receive_2wire_end(SPI1);
+    // end without receive clocks nothing
+    spi_receive_2wire_end(SPI1);
+    assert(spi_receive_2wire_8bit(SPI1, buf, 1, 10) == 0);
+    assert(buf[0] == 12);
+    spi_receive_2wire_end(SPI1);
+    fake_spi_source = NULL;
+    fake_spi_reset();
+}
+
+/** raw test image in RGB565, images_raw.c keeps it in spi byte order */
+static const uint16_t *test_saber_rgb565(void)
+{
+    static uint16_t img[128 * 128];
+    const uint16_t *src = &saber[0][0];
+    for (uint16_t i = 0; i < 128 * 128; i++)
+    {
+        img[i] = (uint16_t)((src[i] >> 8) | (src[i] << 8));
+    }
+    return img;
+}
+
+/** test ST7789_DrawImage sends image by 16-bit dma in background */
+void test_st7789_image_dma(void)
+{
+    static uint16_t image[ST7789_WIDTH * ST7789_HEIGHT];
+    ST7789_Init();
+    fake_spi_reset();
+    ST7789_Invalidate();
+    ST7789_DrawImage(0, 0, ST7789_WIDTH, ST7789_HEIGHT, image);
+    // parameters are sent without dma, whole screen is one 16-bit transfer
+    assert(spi_dma_busy(ST7789_SPI));
+    assert(fake_spi_stats.dma_transfers == 1);
+    ST7789_WaitIdle();
+    assert(!spi_dma_busy(ST7789_SPI));
+    assert(fake_spi_stats.data_bytes == 8 + sizeof(image));
+    assert(fake_spi_stats.cmd_bytes == 3);
+    // one frame per command or parameter byte, one per pixel
+    assert(fake_spi_stats.frames == 3 + 8 + ST7789_WIDTH * ST7789_HEIGHT);
+    // commands go in 8-bit frames again
+    ST7789_InvertColors(1);
+    assert(fake_spi_stats.cmd_bytes == 4);
+    // the same window is cached, only RAMWR is sent
+    fake_spi_reset();
+    ST7789_DrawImage(0, 0, ST7789_WIDTH, ST7789_HEIGHT, image);
+    ST7789_WaitIdle();
+    assert(fake_spi_stats.cmd_bytes == 1);
+    assert(fake_spi_stats.data_bytes == sizeof(image));
+}
+
+/** test ST7789_DrawImage with 128x128 test image */
+void test_st7789_image_small(void)
+{
+    // cold window sends CASET and RASET
+    fake_spi_reset();
+    ST7789_Invalidate();
+    ST7789_DrawImage(0, 0, 128, 128, test_saber_rgb565());
+    ST7789_WaitIdle();
+    assert(fake_spi_stats.data_bytes == 8 + 128 * 128 * 2);
+    // image right below continues RAMWR without commands
+    fake_spi_reset();
+    ST7789_DrawImage(0, 128, 128, 112, test_saber_rgb565());
+    ST7789_WaitIdle();
+    assert(fake_spi_stats.cmd_bytes == 0);
+    assert(fake_spi_stats.data_bytes == 128 * 112 * 2);
+    // the same first row, RASET is not sent
+    fake_spi_reset();
+    ST7789_DrawImage(0, 0, 64, 128, test_saber_rgb565());
+    ST7789_WaitIdle();
+    assert(fake_spi_stats.cmd_bytes == 2);
+    assert(fake_spi_stats.data_bytes == 4 + 64 * 128 * 2);
+    // only visible columns of image at the edge are sent
+    fake_spi_reset();
+    ST7789_DrawImage(200, 0, 128, 128, test_saber_rgb565());
+    ST7789_WaitIdle();
+    assert(fake_spi_stats.data_bytes == 4 + 40 * 128 * 2);
+    // image outside of screen is not sent
+    fake_spi_reset();
+    ST7789_DrawImage(ST7789_WIDTH, 0, 128, 128, test_saber_rgb565());
+    assert(fake_spi_stats.bytes == 0);
+}
+
+/** print spi traffic of last drawing */
+static void test_print_spi_stats(const char *name)
+{
+    printf("      %-28s %6u transactions %7u bytes %7u frames\n", name,
+           fake_spi_stats.transactions, fake_spi_stats.bytes, fake_spi_stats.frames);
+}
+
+/** benchmark of solid fills, one data transaction per cold window */
+void test_st7789_fill_bench(void)
+{
+    fake_spi_reset();
+    ST7789_Invalidate();
+    ST7789_Fill_Color(RED);
+    ST7789_WaitIdle();
+    test_print_spi_stats("ST7789_Fill_Color");
+    // CASET, data, RASET, data, RAMWR + single pixel data burst
+    assert(fake_spi_stats.transactions == 6);
+    assert(fake_spi_stats.data_bytes == 8 + ST7789_WIDTH * ST7789_HEIGHT * 2);
+    // 16-bit frames: one DR write per pixel, single dma transfer of one word
+    assert(fake_spi_stats.frames == 11 + ST7789_WIDTH * ST7789_HEIGHT);
+    assert(fake_spi_stats.dma_transfers == 1);
+
+    fake_spi_reset();
+    ST7789_Invalidate();
+    ST7789_Fill(10, 10, 59, 19, GREEN);
+    ST7789_WaitIdle();
+    test_print_spi_stats("ST7789_Fill 50x10");
+    assert(fake_spi_stats.transactions == 6);
+    assert(fake_spi_stats.data_bytes == 8 + 50 * 10 * 2);
+
+    fake_spi_reset();
+    ST7789_Invalidate();
+    ST7789_DrawFilledRectangle(30, 30, 50, 50, WHITE);
+    ST7789_WaitIdle();
+    test_print_spi_stats("ST7789_DrawFilledRectangle");
+    assert(fake_spi_stats.transactions == 6);
+    assert(fake_spi_stats.data_bytes == 8 + 51 * 51 * 2);
+
+    // clamped at the screen edge
+    fake_spi_reset();
+    ST7789_Invalidate();
+    ST7789_DrawFilledRectangle(200, 200, 100, 100, WHITE);
+    ST7789_WaitIdle();
+    assert(fake_spi_stats.data_bytes == 8 + 40 * 40 * 2);
+}
+
+/** default framebuffer palette */
+static const uint16_t test_fb_palette[FB_COLORS] =
+{
+    BLACK, WHITE, RED, GREEN, BLUE, YELLOW, CYAN, MAGENTA,
+    GRAY, LGRAY, BROWN, DARKBLUE, LIGHTBLUE, GRAYBLUE, BRRED, LIGHTGREEN
+};
+
+/** check that emulated panel shows framebuffer exactly */
+static void test_fb_check_panel(void)
+{
+    for (uint16_t y = FB_Y; y < FB_Y + FB_HEIGHT; y++)
+    {
+        for (uint16_t x = FB_X; x < FB_X + FB_WIDTH; x++)
+        {
+            assert(st7789_emu_pixel(x, y) == test_fb_palette[fb_get_pixel(x, y)]);
+        }
+    }
+}
+
+/** test merging of dirty rectangles */
+void test_fb_dirty_merge(void)
+{
+    fb_init(0);
+    assert(fb_dirty_count() == 1);
+    fb_flush();
+    assert(fb_dirty_count() == 0);
+
+    // same color - nothing changed
+    fb_fill_rect(0, 0, 20, 20, 0);
+    assert(fb_dirty_count() == 0);
+
+    // overlapping rectangles are merged
+    fb_fill_rect(10, 10, 10, 10, 2);
+    fb_fill_rect(15, 15, 10, 10, 3);
+    assert(fb_dirty_count() == 1);
+    assert(fb_dirty_rect(0)->x0 == 10 && fb_dirty_rect(0)->y0 == 10);
+    assert(fb_dirty_rect(0)->x1 == 24 && fb_dirty_rect(0)->y1 == 24);
+
+    // far one is separate, adjacent one is merged with it
+    fb_fill_rect(100, 40, 5, 5, 4);
+    assert(fb_dirty_count() == 2);
+    fb_fill_rect(105, 40, 5, 5, 4);
+    assert(fb_dirty_count() == 2);
+    assert(fb_dirty_rect(1)->x0 == 100 && fb_dirty_rect(1)->x1 == 109);
+
+    // rectangle joining two others merges all of them
+    fb_fill_rect(20, 20, 90, 25, 5);
+    assert(fb_dirty_count() == 1);
+    fb_flush();
+
+    // list overflow
+    for (uint16_t i = 0; i < FB_MAX_DIRTY * 2; i++)
+    {
+        fb_draw_pixel((uint16_t)(i * 14), (uint16_t)((i & 1) * 60), 1);
+    }
+    assert(fb_dirty_count() <= FB_MAX_DIRTY);
+    fb_flush();
+}
+
+/** test framebuffer flush on emulated panel */
+void test_fb_flush_panel(void)
+{
+    fake_spi_reset();
+    st7789_emu_attach(BLACK);
+    fb_init(11);
+    fb_fill_rect(0, 0, FB_WIDTH, 20, 9);
+    fb_write_string(4, 1, "14.074.000", Font_16x26, 1, 9);
+    fb_write_string(4, 30, "USB  2.7k", Font_11x18, 5, 11);
+    fb_fill_rect(4, 52, 120, 8, 3);
+    fb_flush();
+    test_fb_check_panel();
+
+    // one digit changed
+    fake_spi_reset();
+    fb_write_string(4, 1, "14.074.010", Font_16x26, 1, 9);
+    assert(fb_dirty_count() == 1);
+    assert(fb_dirty_rect(0)->x1 - fb_dirty_rect(0)->x0 < Font_16x26.width);
+    fb_flush();
+    test_fb_check_panel();
+    test_print_spi_stats("fb digit update");
+    uint32_t fb_bytes = fake_spi_stats.bytes;
+
+    // meter grows
+    fb_fill_rect(4, 52, 130, 8, 3);
+    fb_flush();
+    test_fb_check_panel();
+    st7789_emu_write_ppm("fb_test.ppm", FB_X, FB_Y, FB_WIDTH, FB_HEIGHT);
+
+    // direct redraw of same text
+    fake_spi_reset();
+    ST7789_WriteString(4, 1, "14.074.010", Font_16x26, WHITE, LGRAY);
+    ST7789_WaitIdle();
+    test_print_spi_stats("direct string redraw");
+    assert(fb_bytes * 10 < fake_spi_stats.bytes);
+    st7789_emu_detach();
+}
+
+/** check char on emulated panel against font bitmap */
+static void test_check_char(uint16_t x, uint16_t y, char ch, FontDef font,
+                            uint16_t color, uint16_t bgcolor)
+{
+    const FontGlyph *glyph = Font_Glyph(&font, ch);
+    for (uint16_t i = 0; i < font.height; i++)
+    {
+        uint16_t bits = Font_Row(&font, glyph, i);
+        for (uint16_t j = 0; j < Font_Advance(&font, glyph); j++)
+        {
+            uint16_t c = ((bits << j) & 0x8000) ? color : bgcolor;
+            assert(st7789_emu_pixel((uint16_t)(x + j), (uint16_t)(y + i)) == c);
+        }
+    }
+}
+
+/** test text run rendering: one window per line */
+void test_st7789_write_string(void)
+{
+    const char str[] = "Hello Steve!";
+    st7789_emu_attach(BLACK);
+    fake_spi_reset();
+    ST7789_WriteString(10, 75, str, Font_11x18, YELLOW, BLUE);
+    ST7789_WaitIdle();
+    test_print_spi_stats("ST7789_WriteString 12 chars");
+    assert(fake_spi_stats.transactions == 6);
+    for (uint16_t i = 0; i < strlen(str); i++)
+    {
+        test_check_char((uint16_t)(10 + i * 11), 75, str[i], Font_11x18, YELLOW, BLUE);
+    }
+
+    // wrapped to next line, leading space skipped
+    fake_spi_reset();
+    ST7789_WriteString(200, 100, "ab cd", Font_16x26, RED, WHITE);
+    ST7789_WaitIdle();
+    assert(fake_spi_stats.transactions == 12);
+    test_check_char(200, 100, 'a', Font_16x26, RED, WHITE);
+    test_check_char(216, 100, 'b', Font_16x26, RED, WHITE);
+    test_check_char(0, 126, 'c', Font_16x26, RED, WHITE);
+    test_check_char(16, 126, 'd', Font_16x26, RED, WHITE);
+    st7789_emu_detach();
+}
+
+/** test glyph cache of ST7789_WriteChar */
+void test_st7789_write_char(void)
+{
+    const char digits[] = "0123456789";
+    st7789_emu_attach(BLACK);
+    // more glyphs and colors than cache entries, some are repeated
+    for (uint16_t pass = 0; pass < 3; pass++)
+    {
+        uint16_t fg = pass & 1 ? RED : GREEN;
+        for (uint16_t i = 0; i < 10; i++)
+        {
+            char ch = digits[(i * 3 + pass) % 10];
+            uint16_t x = (uint16_t)(i * 11);
+            uint16_t y = (uint16_t)(pass * 20);
+            fake_spi_reset();
+            ST7789_Invalidate();
+            ST7789_WriteChar(x, y, ch, Font_11x18, fg, BLACK);
+            ST7789_WaitIdle();
+            // cold char is window + single burst
+            assert(fake_spi_stats.transactions == 6);
+            fake_spi_reset();
+            ST7789_WriteChar(x, y, ch, Font_11x18, fg, BLACK);
+            ST7789_WaitIdle();
+            // window is cached, only RAMWR is sent
+            assert(fake_spi_stats.transactions == 2);
+            test_check_char(x, y, ch, Font_11x18, fg, BLACK);
+        }
+    }
+    // big font is not cached
+    ST7789_WriteChar(0, 100, 'W', Font_16x26, BLUE, WHITE);
+    ST7789_WaitIdle();
+    test_check_char(0, 100, 'W', Font_16x26, BLUE, WHITE);
+    st7789_emu_detach();
+}
+
+/** test waterfall color map ends */
+void test_waterfall_colormap(void)
+{
+    uint16_t lut[WATERFALL_LEVELS];
+    waterfall_default_colormap(lut);
+    assert(lut[0] == BLACK);
+    assert(lut[WATERFALL_LEVELS - 1] == WHITE);
+    assert(lut[51] == BLUE);
+}
+
+/** test waterfall: one row per line, newest at the top */
+void test_waterfall_scroll(void)
+{
+    uint8_t line[128];
+    uint16_t lut[WATERFALL_LEVELS];
+    const uint16_t top = 100, height = 80;
+
+    waterfall_default_colormap(lut);
+    st7789_emu_attach(RED);
+    waterfall_init(top, height);
+    ST7789_WaitIdle();
+    assert(st7789_emu_pixel(0, top) == BLACK);
+    assert(st7789_emu_pixel(0, top - 1) == RED);
+
+    for (uint16_t n = 1; n <= height + 3; n++)
+    {
+        for (uint16_t i = 0; i < sizeof(line); i++)
+        {
+            line[i] = (uint8_t)(n + i);
+        }
+        fake_spi_reset();
+        waterfall_add_line(line, sizeof(line));
+        ST7789_WaitIdle();
+        // first row of window + one row + scroll address, columns are cached
+        assert(fake_spi_stats.data_bytes == 4 + ST7789_WIDTH * 2 + 2);
+    }
+    test_print_spi_stats("waterfall_add_line");
+
+    // newest line at the top, older below, fixed rows are not moved
+    for (uint16_t age = 0; age < 3; age++)
+    {
+        uint16_t n = (uint16_t)(height + 3 - age);
+        for (uint16_t x = 0; x < ST7789_WIDTH; x++)
+        {
+            uint8_t m = (uint8_t)(n + x * sizeof(line) / ST7789_WIDTH);
+            assert(st7789_emu_pixel(x, (uint16_t)(top + age)) == lut[m]);
+        }
+    }
+    assert(st7789_emu_pixel(0, top - 1) == RED);
+    assert(st7789_emu_pixel(0, top + height) == RED);
+    st7789_emu_write_ppm("waterfall_test.ppm", 0, 0, ST7789_WIDTH, ST7789_HEIGHT);
+    waterfall_stop();
+    st7789_emu_detach();
+}
+
+/** check bandscope column on emulated panel: bar, peak marker, background */
+static void test_spectrum_column(uint16_t x, uint16_t top, uint16_t height,
+                                 uint16_t level, uint16_t peak)
+{
+    for (uint16_t row = 0; row < height; row++)
+    {
+        uint16_t c = st7789_emu_pixel(x, (uint16_t)(top + height - 1 - row));
+        if (row < level)
+        {
+            assert(c == GREEN);
+        }
+        else if ((peak > level) && (row == peak - 1))
+        {
+            assert(c == YELLOW);
+        }
+        else
+        {
+            assert(c == BLACK);
+        }
+    }
+}
+
+/** bandscope: max-decimation, peak hold and fall, only changed rows are sent */
+void test_spectrum_peaks(void)
+{
+    static uint8_t mag[480];
+    const uint16_t top = 120, height = 100;
+
+    st7789_emu_attach(RED);
+    spectrum_init(top, height);
+    spectrum_set_dynamics(0, 5);
+    ST7789_WaitIdle();
+    assert(st7789_emu_pixel(0, top - 1) == RED);
+    assert(st7789_emu_pixel(0, top) == BLACK);
+
+    // flat floor of 20 rows is one window for all columns
+    memset(mag, 51, sizeof(mag));
+    memset(&st7789_cache_stats, 0, sizeof(st7789_cache_stats));
+    assert(spectrum_update(mag, sizeof(mag)) == SPECTRUM_COLUMNS * 20u);
+    assert(st7789_cache_stats.windows == 1);
+    assert(spectrum_update(mag, sizeof(mag)) == 0);
+
+    // carrier in one of two bins of column 50
+    mag[101] = 255;
+    assert(spectrum_update(mag, sizeof(mag)) == 80);
+    ST7789_WaitIdle();
+    test_spectrum_column(49, top, height, 20, 20);
+    test_spectrum_column(50, top, height, 100, 100);
+    test_spectrum_column(51, top, height, 20, 20);
+
+    // carrier is gone, peak is held: bar is erased, marker is drawn
+    mag[101] = 51;
+    assert(spectrum_update(mag, sizeof(mag)) == 80 + 1);
+    ST7789_WaitIdle();
+    test_spectrum_column(50, top, height, 20, 100);
+    for (uint16_t i = 1; i < SPECTRUM_PEAK_HOLD; i++)
+    {
+        assert(spectrum_update(mag, sizeof(mag)) == 0);
+    }
+    // then marker falls by 5 rows: old one is erased, new one is drawn
+    for (uint16_t peak = 95; peak > 20; peak = (uint16_t)(peak - 5))
+    {
+        assert(spectrum_update(mag, sizeof(mag)) == 2);
+        ST7789_WaitIdle();
+        test_spectrum_column(50, top, height, 20, peak);
+    }
+    // marker merges with bar
+    assert(spectrum_update(mag, sizeof(mag)) == 1);
+    ST7789_WaitIdle();
+    test_spectrum_column(50, top, height, 20, 20);
+
+    // few bins are stretched to all columns
+    mag[0] = 0;
+    mag[1] = 255;
+    spectrum_update(mag, 2);
+    ST7789_WaitIdle();
+    test_spectrum_column(0, top, height, 0, 20);
+    test_spectrum_column(SPECTRUM_COLUMNS / 2 - 1, top, height, 0, 20);
+    test_spectrum_column(SPECTRUM_COLUMNS / 2, top, height, 100, 100);
+    assert(st7789_emu_pixel(0, top + height) == RED);
+    st7789_emu_detach();
+}
+
+/** bandscope benchmark: synthetic noise with drifting carriers over calibrated link */
+void test_spectrum_bench(void)
+{
+    static uint8_t mag[1024];
+    const uint16_t top = 100, height = 120, frames = 100;
+    uint32_t seed = 12345;
+    uint32_t pixels = 0, start;
+    st7789_link_t link;
+    spi_config_t cfg;
+
+    st7789_emu_attach(BLACK);
+    fake_spi_max_hz = 20000000;
+    assert(ST7789_Calibrate(&link) == 0);
+    spectrum_init(top, height);
+    spectrum_set_dynamics(2, 2);
+    ST7789_WaitIdle();
+    // counters are cleared with spi config
+    spi_get_config(ST7789_SPI, &cfg);
+    fake_spi_reset();
+    spi_configure(ST7789_SPI, &cfg);
+    start = hw_time_ms();
+    for (uint16_t f = 0; f < frames; f++)
+    {
+        for (uint16_t i = 0; i < sizeof(mag); i++)
+        {
+            seed = seed * 1103515245U + 12345U;
+            mag[i] = (uint8_t)(40 + ((seed >> 16) & 31));
+        }
+        for (uint16_t k = 0; k < 3; k++)
+        {
+            uint16_t bin = (uint16_t)((200 + k * 300 + f * (k + 1)) % sizeof(mag));
+            for (uint16_t i = 0; i < 6; i++)
+            {
+                mag[(bin + i) % sizeof(mag)] = (uint8_t)(250 - k * 60 - i * 10);
+            }
+        }
+        pixels += spectrum_update(mag, sizeof(mag));
+    }
+    ST7789_WaitIdle();
+    uint32_t ms = hw_time_ms() - start;
+    printf("      %-28s %6u pixels %7u bytes per frame, %u fps at %u Hz\n", "spectrum_update",
+           pixels / frames, fake_spi_stats.bytes / frames, frames * 1000U / ms, link.clock_hz);
+    // far less than full redraw of area, fast enough for live bandscope
+    assert(pixels / frames * 8 < (uint32_t)SPECTRUM_COLUMNS * height);
+    assert(frames * 1000U / ms >= 25);
+    st7789_emu_detach();
+}
+
+/** context of strip test scene */
+typedef struct //vera++ blamed for single space
+{
+    uint32_t cost_ns;       /** simulated cpu time per pixel of band */
+    boolean serial;         /** wait for previous band before composing */
+} test_strip_ctx_t;
+
+/** strip scene: primitives drawn the same way by st7789.c */
+static void test_strip_scene(strip_band_t *band, void *ctx)
+{
+    const test_strip_ctx_t *c = ctx;
+
+    if (c->serial)
+    {
+        ST7789_WaitIdle();
+    }
+    fake_cpu_work((uint32_t)(band->y1 - band->y0 + 1) * ST7789_WIDTH * c->cost_ns);
+    strip_fill(band, 0, 0, ST7789_WIDTH - 1, 29, BLUE);
+    strip_text(band, 4, 6, "14.074.000 USB", &Font_11x18, WHITE, BLUE);
+    strip_image(band, 150, 100, 128, 128, test_saber_rgb565());
+    strip_line(band, 0, 40, 239, 40, YELLOW);
+    strip_line(band, 120, 30, 120, 239, YELLOW);
+    strip_text(band, 0, 230, "cut by bottom", &Font_11x18, GREEN, BLACK);
+}
+
+/** the same scene drawn directly */
+static void test_strip_direct(void)
+{
+    ST7789_Fill_Color(BLACK);
+    ST7789_Fill(0, 0, ST7789_WIDTH - 1, 29, BLUE);
+    ST7789_WriteString(4, 6, "14.074.000 USB", Font_11x18, WHITE, BLUE);
+    ST7789_DrawImage(150, 100, 128, 128, test_saber_rgb565());
+    ST7789_DrawLine(0, 40, 239, 40, YELLOW);
+    ST7789_DrawLine(120, 30, 120, 239, YELLOW);
+    ST7789_WriteString(0, 230, "cut by bottom", Font_11x18, GREEN, BLACK);
+    ST7789_WaitIdle();
+}
+
+/** strip scene: circle and sloped line crossing bands */
+static void test_strip_circle(strip_band_t *band, void *ctx)
+{
+    (void)ctx;
+    strip_filled_circle(band, 100, 100, 40, GREEN);
+    strip_line(band, 10, 50, 109, 149, WHITE);
+}
+
+/** strip renderer gives the same picture as direct drawing, every pixel once */
+void test_strip_render(void)
+{
+    test_strip_ctx_t ctx = {0, FALSE};
+    uint32_t crc;
+
+    st7789_emu_attach(RED);
+    test_strip_direct();
+    crc = st7789_emu_crc(0, 0, ST7789_WIDTH, ST7789_HEIGHT);
+
+    st7789_emu_attach(RED);
+    fake_spi_reset();
+    strip_render(0, ST7789_HEIGHT - 1, BLACK, test_strip_scene, &ctx);
+    ST7789_WaitIdle();
+    assert(st7789_emu_crc(0, 0, ST7789_WIDTH, ST7789_HEIGHT) == crc);
+    assert(st7789_emu_written == ST7789_WIDTH * ST7789_HEIGHT);
+    // one window, one dma transfer per band
+    assert(fake_spi_stats.cmd_bytes == 3);
+    assert(fake_spi_stats.dma_transfers == (ST7789_HEIGHT + STRIP_ROWS - 1) / STRIP_ROWS);
+
+    // sloped line and circle are cut by bands
+    st7789_emu_attach(RED);
+    strip_render(50, 149, BLACK, test_strip_circle, NULL);
+    ST7789_WaitIdle();
+    assert(st7789_emu_pixel(100, 100) == GREEN);
+    assert(st7789_emu_pixel(100, 60) == GREEN);
+    assert(st7789_emu_pixel(100, 59) == BLACK);
+    assert(st7789_emu_pixel(10, 50) == WHITE);
+    assert(st7789_emu_pixel(109, 149) == WHITE);
+    assert(st7789_emu_pixel(0, 49) == RED);
+    assert(st7789_emu_pixel(0, 150) == RED);
+    assert(st7789_emu_written == ST7789_WIDTH * 100);
+    st7789_emu_detach();
+}
+
+/** timing of full screen redraw: raw dma fill, strips, strips without overlap */
+void test_strip_timing(void)
+{
+    // composing of band takes about 14 cpu cycles per pixel at 72MHz
+    test_strip_ctx_t ctx = {200, FALSE};
+    const spi_config_t cfg = {1, FALSE, FALSE};
+    uint32_t raw, strip, serial;
+
+    st7789_emu_attach(BLACK);
+    fake_spi_reset();
+    spi_configure(ST7789_SPI, &cfg);
+    ST7789_Fill_Color(BLUE);
+    ST7789_WaitIdle();
+    raw = fake_wall_us();
+
+    fake_spi_reset();
+    spi_configure(ST7789_SPI, &cfg);
+    strip_render(0, ST7789_HEIGHT - 1, BLACK, test_strip_scene, &ctx);
+    ST7789_WaitIdle();
+    strip = fake_wall_us();
+
+    ctx.serial = TRUE;
+    fake_spi_reset();
+    spi_configure(ST7789_SPI, &cfg);
+    strip_render(0, ST7789_HEIGHT - 1, BLACK, test_strip_scene, &ctx);
+    ST7789_WaitIdle();
+    serial = fake_wall_us();
+
+    printf("      %-28s %6u us raw fill %6u us strips %6u us serial at %u Hz\n",
+           "strip_render", raw, strip, serial, spi_clock_hz(ST7789_SPI, cfg.baudrate));
+    // only the first band is composed before spi starts
+    assert(strip < raw + STRIP_ROWS * ST7789_WIDTH * ctx.cost_ns / 1000 + raw / 100);
+    assert(serial > strip + strip / 10);
+    st7789_emu_detach();
+}
+
+/** test order, full and empty states and index wrap of byte ring */
+void test_ring(void)
+{
+    uint8_t data[8];
+    ring_t r;
+    uint8_t b = 0;
+
+    ring_init(&r, data, sizeof(data));
+    assert(!ring_get(&r, &b));
+    for (uint8_t i = 0; i < sizeof(data); i++)
+    {
+        assert(ring_put(&r, (uint8_t)(i + 1)));
+    }
+    assert(!ring_put(&r, 99));
+    assert(ring_count(&r) == sizeof(data));
+    for (uint8_t i = 0; i < sizeof(data); i++)
+    {
+        assert(ring_get(&r, &b) && (b == i + 1));
+    }
+    assert(!ring_get(&r, &b));
+
+    // free running indexes pass 65535
+    uint8_t put = 0, got = 0;
+    r.head = r.tail = 65530;
+    for (uint16_t i = 0; i < 100; i++)
+    {
+        // two in, one out, drained when nearly full
+        assert(ring_put(&r, put++));
+        assert(ring_put(&r, put++));
+        assert(ring_get(&r, &b) && (b == got++));
+        if (ring_count(&r) >= sizeof(data) - 1)
+        {
+            while (ring_get(&r, &b))
+            {
+                assert(b == got++);
+            }
+        }
+    }
+    assert(r.head < 1000);
+}
+
+/** bytes passed through ring by stress test */
+#define TEST_RING_BYTES 4000000U
+
+/** producer of ring stress test, retries while ring is full */
+static void *test_ring_producer(void *arg)
+{
+    ring_t *r = (ring_t *)arg;
+    uint32_t full = 0;
+
+    for (uint32_t i = 0; i < TEST_RING_BYTES; i++)
+    {
+        while (!ring_put(r, (uint8_t)(i * 31 + (i >> 8))))
+        {
+            full++;
+            sched_yield();
+        }
+    }
+    return (void *)(uintptr_t)full;
+}
+
+/** test ring by concurrent producer and consumer threads */
+void test_ring_stress(void)
+{
+    static uint8_t data[16];
+    ring_t r;
+    pthread_t producer;
+    void *full;
+    uint32_t empty = 0;
+    clock_t t0 = clock();
+
+    ring_init(&r, data, sizeof(data));
+    assert(pthread_create(&producer, NULL, test_ring_producer, &r) == 0);
+    for (uint32_t i = 0; i < TEST_RING_BYTES; i++)
+    {
+        uint8_t b;
+        while (!ring_get(&r, &b))
+        {
+            empty++;
+            sched_yield();
+        }
+        // every byte once and in order
+        assert(b == (uint8_t)(i * 31 + (i >> 8)));
+    }
+    assert(pthread_join(producer, &full) == 0);
+    assert(ring_count(&r) == 0);
+    printf("      %-28s %u bytes %u full %u empty %u ms\n", "ring_put/ring_get",
+           TEST_RING_BYTES, (uint32_t)(uintptr_t)full, empty,
+           (uint32_t)((clock() - t0) * 1000 / CLOCKS_PER_SEC));
+}
+
+/** test capture of uart output by host backend */
+void test_uart_capture(void)
+{
+    char line[100];
+
+    fake_uart_reset();
+    send_string("lcd ");
+    send_char('o');
+    assert(uart_send("k\r\n", 3) == 3);
+    assert(uart_flush(portMAX_DELAY) == 0);
+    assert(strcmp(fake_uart_out, "lcd ok\r\n") == 0);
+    assert(fake_uart_sent == 8);
+
+    // everything is counted, only first bytes are kept
+    memset(line, 'x', sizeof(line) - 1);
+    line[sizeof(line) - 1] = 0;
+    for (uint16_t i = 0; i < FAKE_UART_SIZE / 90; i++)
+    {
+        send_string(line);
+    }
+    assert(fake_uart_sent == 8 + FAKE_UART_SIZE / 90 * 99);
+    assert(strlen(fake_uart_out) == FAKE_UART_SIZE);
+    fake_uart_reset();
+    assert((fake_uart_sent == 0) && (fake_uart_out[0] == 0));
+}
+
 /**
  * test procedure pointer type
  */
@@ -193,6 +1494,1691 @@ typedef struct // test name + test function
     test_handler_t test_proc; /** test procedure */
     const uint16_t test_group_id;
 } test_def_t;
+/** pixels expected on emulated panel */
+static uint8_t test_ref[ST7789_HEIGHT][ST7789_WIDTH];
+
+/** put pixel into expected picture, outside of screen is skipped */
+static void test_ref_pixel(int32_t x, int32_t y)
+{
+    if ((x >= 0) && (x < ST7789_WIDTH) && (y >= 0) && (y < ST7789_HEIGHT))
+    {
+        test_ref[y][x] = 1;
+    }
+}
+
+/** line of expected picture by per-pixel Bresenham */
+static void test_ref_line(int32_t x0, int32_t y0, int32_t x1, int32_t y1)
+{
+    int32_t swap;
+    int32_t steep = ABS(y1 - y0) > ABS(x1 - x0);
+    if (steep)
+    {
+        swap = x0;
+        x0 = y0;
+        y0 = swap;
+        swap = x1;
+        x1 = y1;
+        y1 = swap;
+    }
+    if (x0 > x1)
+    {
+        swap = x0;
+        x0 = x1;
+        x1 = swap;
+        swap = y0;
+        y0 = y1;
+        y1 = swap;
+    }
+    int32_t dx = x1 - x0, dy = ABS(y1 - y0), err = dx / 2;
+    for (; x0 <= x1; x0++)
+    {
+        steep ? test_ref_pixel(y0, x0) : test_ref_pixel(x0, y0);
+        err -= dy;
+        if (err < 0)
+        {
+            y0 += (y0 < y1) ? 1 : -1;
+            err += dx;
+        }
+    }
+}
+
+/** circle of expected picture by per-pixel midpoint algorithm */
+static void test_ref_circle(int32_t x0, int32_t y0, int32_t r, int32_t filled)
+{
+    int32_t f = 1 - r, ddF_x = 1, ddF_y = -2 * r, x = 0, y = r;
+    test_ref_line(x0 - r, y0, filled ? x0 + r : x0 - r, y0);
+    test_ref_pixel(x0 + r, y0);
+    test_ref_pixel(x0, y0 - r);
+    test_ref_pixel(x0, y0 + r);
+    while (x < y)
+    {
+        if (f >= 0)
+        {
+            y--;
+            ddF_y += 2;
+            f += ddF_y;
+        }
+        x++;
+        ddF_x += 2;
+        f += ddF_x;
+        for (int32_t s = -1; s <= 1; s += 2)
+        {
+            if (filled)
+            {
+                test_ref_line(x0 - x, y0 + s * y, x0 + x, y0 + s * y);
+                test_ref_line(x0 - y, y0 + s * x, x0 + y, y0 + s * x);
+            }
+            else
+            {
+                test_ref_pixel(x0 - x, y0 + s * y);
+                test_ref_pixel(x0 + x, y0 + s * y);
+                test_ref_pixel(x0 - y, y0 + s * x);
+                test_ref_pixel(x0 + y, y0 + s * x);
+            }
+        }
+    }
+}
+
+/** compare emulated panel with expected picture, return count of pixels */
+static uint32_t test_ref_check(uint16_t color, uint16_t bgcolor)
+{
+    uint32_t count = 0;
+    for (uint16_t y = 0; y < ST7789_HEIGHT; y++)
+    {
+        for (uint16_t x = 0; x < ST7789_WIDTH; x++)
+        {
+            assert(st7789_emu_pixel(x, y) == (test_ref[y][x] ? color : bgcolor));
+            count += test_ref[y][x];
+        }
+    }
+    return count;
+}
+
+/** start drawing of primitive on clean panel */
+static void test_ref_start(void)
+{
+    memset(test_ref, 0, sizeof(test_ref));
+    st7789_emu_attach(BLACK);
+    fake_spi_reset();
+    memset(&st7789_cache_stats, 0, sizeof(st7789_cache_stats));
+}
+
+/** spi transactions not sent thanks to cached window since test_ref_start */
+static uint32_t test_cache_transactions(void)
+{
+    // CASET and RASET are command and data, continued window only selects panel for data again
+    return 2 * (st7789_cache_stats.caset_skipped + st7789_cache_stats.raset_skipped) +
+           5 * st7789_cache_stats.continued;
+}
+
+/** benchmark of span rasterizers, pictures must match per-pixel ones */
+void test_st7789_span_bench(void)
+{
+    const uint32_t window = 11; // CASET, RASET and RAMWR with parameters, not cached
+    uint32_t pixels;
+
+    // horizontal and vertical lines are single spans
+    test_ref_start();
+    ST7789_DrawLine(10, 20, 200, 20, WHITE);
+    ST7789_DrawLine(30, 5, 30, 150, WHITE);
+    ST7789_WaitIdle();
+    test_print_spi_stats("ST7789_DrawLine h+v");
+    test_ref_line(10, 20, 200, 20);
+    test_ref_line(30, 5, 30, 150);
+    pixels = test_ref_check(WHITE, BLACK);
+    assert(st7789_cache_stats.windows == 2);
+    assert(fake_spi_stats.transactions == 2 * 6 - test_cache_transactions());
+    assert(fake_spi_stats.bytes == 2 * window - st7789_cache_stats.saved + (pixels + 1) * 2);
+
+    // sloped lines, one span per row or column
+    test_ref_start();
+    ST7789_DrawLine(0, 0, 239, 60, WHITE);
+    ST7789_DrawLine(200, 239, 150, 10, WHITE);
+    ST7789_DrawLine(5, 100, 100, 195, WHITE);
+    ST7789_WaitIdle();
+    test_print_spi_stats("ST7789_DrawLine sloped");
+    test_ref_line(0, 0, 239, 60);
+    test_ref_line(200, 239, 150, 10);
+    test_ref_line(5, 100, 100, 195);
+    test_ref_check(WHITE, BLACK);
+    assert(st7789_cache_stats.windows == (61 + 51 + 96));
+    assert(fake_spi_stats.transactions == (61 + 51 + 96) * 6 - test_cache_transactions());
+
+    test_ref_start();
+    ST7789_DrawRectangle(20, 30, 120, 90, WHITE);
+    ST7789_WaitIdle();
+    test_print_spi_stats("ST7789_DrawRectangle");
+    test_ref_line(20, 30, 120, 30);
+    test_ref_line(20, 90, 120, 90);
+    test_ref_line(20, 30, 20, 90);
+    test_ref_line(120, 30, 120, 90);
+    pixels = test_ref_check(WHITE, BLACK);
+    assert(st7789_cache_stats.windows == 4);
+    assert(fake_spi_stats.transactions == 4 * 6 - test_cache_transactions());
+    assert(fake_spi_stats.bytes == 4 * window - st7789_cache_stats.saved + pixels * 2);
+
+    test_ref_start();
+    ST7789_DrawCircle(120, 120, 100, WHITE);
+    ST7789_DrawCircle(10, 10, 30, WHITE);   // clipped
+    ST7789_WaitIdle();
+    test_print_spi_stats("ST7789_DrawCircle");
+    test_ref_circle(120, 120, 100, 0);
+    test_ref_circle(10, 10, 30, 0);
+    pixels = test_ref_check(WHITE, BLACK);
+    // per-pixel drawing takes a window for every pixel
+    assert(fake_spi_stats.bytes * 3 < pixels * (window + 2) * 2);
+
+    test_ref_start();
+    ST7789_DrawFilledCircle(120, 120, 100, WHITE);
+    ST7789_DrawFilledCircle(230, 5, 20, WHITE);   // clipped
+    ST7789_WaitIdle();
+    test_print_spi_stats("ST7789_DrawFilledCircle");
+    test_ref_circle(120, 120, 100, 1);
+    test_ref_circle(230, 5, 20, 1);
+    test_ref_check(WHITE, BLACK);
+    // one span per row
+    assert(st7789_cache_stats.windows == (201 + 26));
+    assert(fake_spi_stats.transactions == (201 + 26) * 6 - test_cache_transactions());
+
+    test_ref_start();
+    ST7789_DrawFilledTriangle(120, 10, 10, 200, 230, 150, WHITE);
+    ST7789_WaitIdle();
+    test_print_spi_stats("ST7789_DrawFilledTriangle");
+    assert(st7789_cache_stats.windows == 191);
+    assert(fake_spi_stats.transactions == 191 * 6 - test_cache_transactions());
+    pixels = 0;
+    for (uint16_t y = 10; y <= 200; y++)
+    {
+        // every row is one solid span
+        uint16_t first = ST7789_WIDTH, last = 0, count = 0;
+        for (uint16_t x = 0; x < ST7789_WIDTH; x++)
+        {
+            if (st7789_emu_pixel(x, y) == WHITE)
+            {
+                first = x < first ? x : first;
+                last = x;
+                count++;
+            }
+        }
+        assert(count == last - first + 1);
+        pixels += count;
+    }
+    assert(st7789_emu_pixel(120, 10) == WHITE);
+    assert(st7789_emu_pixel(10, 200) == WHITE);
+    assert(st7789_emu_pixel(230, 150) == WHITE);
+    assert(st7789_emu_pixel(120, 120) == WHITE);
+    assert(st7789_emu_pixel(10, 10) == BLACK);
+    // area of triangle is 18150 pixels, edges are included
+    assert((pixels > 18150) && (pixels < 18150 + 3 * 240));
+    st7789_emu_detach();
+}
+
+/** packed fonts must give the same rows as source bitmaps */
+void test_fonts_packed(void)
+{
+    const FontDef *fonts[] = {&Font_7x10, &Font_11x18, &Font_16x26};
+    const uint16_t *raw[] = {Font7x10, Font11x18, Font16x26};
+    const FontDef *prop[] = {&Font_7x10p, &Font_11x18p, &Font_16x26p};
+
+    for (uint16_t f = 0; f < 3; f++)
+    {
+        const FontDef *font = fonts[f];
+        uint16_t mask = (uint16_t)(0xffff << (16 - font->width));
+        uint32_t packed = sizeof(FontGlyph) * font->count;
+        for (uint16_t ch = ' '; ch <= '~'; ch++)
+        {
+            const FontGlyph *g = Font_Glyph(font, (char)ch);
+            const uint16_t *rows = &raw[f][(ch - ' ') * font->height];
+            assert(Font_Glyph(prop[f], (char)ch) == g);
+            assert(Font_Advance(font, g) == font->width);
+            assert(Font_Advance(prop[f], g) <= font->width);
+            for (uint16_t i = 0; i < font->height; i++)
+            {
+                uint16_t bits = rows[i] & mask;
+                assert(Font_Row(font, g, i) == bits);
+                // proportional glyph starts at the left of advance
+                assert(Font_Row(prop[f], g, i) == (uint16_t)(bits << g->left));
+            }
+            // last glyph ends data, with its blank rows
+            packed = g->offset + (uint32_t)((g->cols + 7) / 8 * font->height) + 2 +
+                     sizeof(FontGlyph) * font->count;
+        }
+        printf("      %-28s %6u bytes, packed %6u bytes\n", f == 0 ? "Font_7x10" :
+               f == 1 ? "Font_11x18" : "Font_16x26",
+               (unsigned)(font->count * font->height * sizeof(uint16_t)), packed);
+        assert(packed < font->count * font->height * sizeof(uint16_t));
+    }
+    // chars without glyph are shown as space
+    assert(Font_Glyph(&Font_7x10, '\n') == Font_Glyph(&Font_7x10, ' '));
+    assert(Font_Glyph(&Font_7x10, (char)0xc0) == Font_Glyph(&Font_7x10, ' '));
+}
+
+/** expand glyph row to pixels as text renderer does, return their sum */
+static uint16_t test_expand_row(uint16_t *dst, uint16_t bits, uint16_t width)
+{
+    uint16_t sum = 0;
+    for (uint16_t j = 0; j < width; j++)
+    {
+        dst[j] = (bits & 0x8000) ? WHITE : BLACK;
+        sum = (uint16_t)(sum * 3 + dst[j]);
+        bits = (uint16_t)(bits << 1);
+    }
+    return sum;
+}
+
+/** speed of rendering rows from packed font against plain table lookup */
+void test_fonts_decode_speed(void)
+{
+    const FontDef *fonts[] = {&Font_7x10, &Font_11x18, &Font_16x26};
+    const uint16_t *raw[] = {Font7x10, Font11x18, Font16x26};
+    const uint32_t passes = 100;
+    uint16_t pixels[16];
+
+    for (uint16_t f = 0; f < 3; f++)
+    {
+        const FontDef *font = fonts[f];
+        const uint16_t h = font->height;
+        double lookup = 1e9, packed = 1e9;
+        uint16_t acc[2] = {0, 0};
+        // best of many interleaved runs, so load of host hits both alike
+        for (uint16_t k = 0; k < 101; k++)
+        {
+            clock_t t0 = clock();
+            for (uint32_t n = 0; n < passes; n++)
+            {
+                for (uint16_t ch = 0; ch < 95; ch++)
+                {
+                    for (uint16_t i = 0; i < h; i++)
+                    {
+                        acc[0] = (uint16_t)(acc[0] * 31 +
+                                            test_expand_row(pixels, raw[f][ch * h + i], font->width));
+                    }
+                }
+            }
+            clock_t t1 = clock();
+            for (uint32_t n = 0; n < passes; n++)
+            {
+                for (uint16_t ch = 0; ch < 95; ch++)
+                {
+                    const FontGlyph *g = Font_Glyph(font, (char)(ch + ' '));
+                    for (uint16_t i = 0; i < h; i++)
+                    {
+                        acc[1] = (uint16_t)(acc[1] * 31 +
+                                            test_expand_row(pixels, Font_Row(font, g, i), font->width));
+                    }
+                }
+            }
+            clock_t t2 = clock();
+            double rows = (double)passes * 95 * h;
+            double l = (double)(t1 - t0) * 1e9 / CLOCKS_PER_SEC / rows;
+            double p = (double)(t2 - t1) * 1e9 / CLOCKS_PER_SEC / rows;
+            lookup = l < lookup ? l : lookup;
+            packed = p < packed ? p : packed;
+        }
+        printf("      %-28s %6.1f ns lookup %6.1f ns packed\n", f == 0 ? "Font_7x10 row render" :
+               f == 1 ? "Font_11x18 row render" : "Font_16x26 row render", lookup, packed);
+        // benchmark only, cpu time ratio is noisy; both give the same pixels
+        assert(acc[0] == acc[1]);
+    }
+}
+
+/** anti-aliased fonts give 1bpp source back above half level */
+void test_fonts_aa(void)
+{
+    const FontDef *aa[] = {&Font_11x18a, &Font_16x26a, &Font_11x18ap, &Font_16x26ap};
+    const FontDef *mono[] = {&Font_11x18, &Font_16x26, &Font_11x18p, &Font_16x26p};
+
+    for (uint16_t f = 0; f < 4; f++)
+    {
+        uint32_t partial = 0;
+        uint16_t used = 0;
+        uint16_t levels = 0;
+        for (uint16_t ch = ' '; ch <= '~'; ch++)
+        {
+            const FontGlyph *g = Font_Glyph(aa[f], (char)ch);
+            const FontGlyph *m = Font_Glyph(mono[f], (char)ch);
+            assert(Font_Advance(aa[f], g) == Font_Advance(mono[f], m));
+            for (uint16_t i = 0; i < aa[f]->height; i++)
+            {
+                assert(Font_Row(aa[f], g, i) == Font_Row(mono[f], m, i));
+            }
+            for (uint16_t r = 0; r < g->rows; r++)
+            {
+                for (uint8_t c = 0; c < g->cols; c++)
+                {
+                    uint8_t level = Font_Level(aa[f], g, r, c);
+                    partial += (level != 0) && (level != (1 << aa[f]->bpp) - 1);
+                    used |= (uint16_t)(1 << level);
+                }
+            }
+        }
+        for (uint16_t l = 0; l < 16; l++)
+        {
+            levels = (uint16_t)(levels + ((used >> l) & 1));
+        }
+        if (f < 2)
+        {
+            printf("      %-28s %u bpp %6u smoothed pixels %2u levels\n",
+                   f ? "Font_16x26a" : "Font_11x18a", aa[f]->bpp, partial, levels);
+        }
+        assert(partial > 0);
+        // every level of 2bpp, 4bpp has levels between those of 2x2 coverage
+        assert(levels >= ((aa[f]->bpp == 2) ? 4 : 9));
+    }
+}
+
+/** anti-aliased text has colors of blend table, costs about as 1bpp */
+void test_st7789_text_aa(void)
+{
+    const FontDef *fonts[] = {&Font_16x26, &Font_16x26a};
+    const char str[] = "Wave 14.074";
+    const uint32_t passes = 20;
+    const uint16_t runs = 101;
+    uint16_t lut[16];
+    double ns[2], best[2] = {1e9, 1e9};
+    double ratio[101];
+
+    // same table as renderer: levels blended from BLUE to YELLOW
+    for (uint16_t i = 0; i < 16; i++)
+    {
+        uint16_t r = (uint16_t)((0 * (15 - i) + 31 * i + 7) / 15);
+        uint16_t g = (uint16_t)((0 * (15 - i) + 63 * i + 7) / 15);
+        uint16_t b = (uint16_t)((31 * (15 - i) + 0 * i + 7) / 15);
+        lut[i] = (uint16_t)((r << 11) | (g << 5) | b);
+    }
+    st7789_emu_attach(BLACK);
+    ST7789_WriteString(0, 0, str, Font_16x26a, YELLOW, BLUE);
+    ST7789_WriteChar(0, 30, 'W', Font_16x26a, YELLOW, BLUE);
+    ST7789_WaitIdle();
+    uint16_t used = 0;
+    for (uint16_t y = 0; y < 26; y++)
+    {
+        for (uint16_t x = 0; x < 16 * 11; x++)
+        {
+            uint16_t c = st7789_emu_pixel(x, y);
+            uint16_t i = 0;
+            while ((i < 16) && (lut[i] != c))
+            {
+                i++;
+            }
+            assert(i < 16);
+            used |= (uint16_t)(1 << i);
+            if (x < 16)
+            {
+                assert(st7789_emu_pixel(x, (uint16_t)(y + 30)) == c);
+            }
+        }
+    }
+    assert((used & 1) && (used & 0x8000) && (used & 0x7ffe));
+
+    // every glyph has its levels, 4bpp ones are taken by two per byte
+    const FontDef *aa[] = {&Font_16x26a, &Font_16x26ap, &Font_11x18a};
+    for (uint16_t f = 0; f < 3; f++)
+    {
+        const FontDef *font = aa[f];
+        uint16_t max = (uint16_t)((1 << font->bpp) - 1);
+        for (char ch = ' '; ch <= '~'; ch++)
+        {
+            const FontGlyph *g = Font_Glyph(font, ch);
+            uint8_t adv = Font_Advance(font, g);
+            uint8_t left = font->widths ? 0 : g->left;
+            const char one[2] = {ch, 0};
+            ST7789_WriteString(0, 60, one, *font, WHITE, BLACK);
+            ST7789_WaitIdle();
+            for (uint16_t y = 0; y < font->height; y++)
+            {
+                for (uint16_t x = 0; x < adv; x++)
+                {
+                    uint16_t r = (uint16_t)(y - g->top);
+                    uint8_t level = 0;
+                    if ((r < g->rows) && (x >= left) && (x < left + g->cols))
+                    {
+                        level = Font_Level(font, g, r, (uint8_t)(x - left));
+                    }
+                    uint16_t c = st7789_emu_pixel(x, (uint16_t)(60 + y));
+                    // green of RGB565 has 6 bits, so level is exact in it
+                    assert(((c >> 5) & 0x3f) == (63 * level + max / 2) / max);
+                }
+            }
+        }
+    }
+
+    // rendering only, spi sink is off; median of interleaved runs, so
+    // load of host hits both alike
+    st7789_emu_detach();
+    for (uint16_t k = 0; k < runs; k++)
+    {
+        for (uint16_t f = 0; f < 2; f++)
+        {
+            clock_t t0 = clock();
+            for (uint32_t n = 0; n < passes; n++)
+            {
+                ST7789_WriteString(0, 0, str, *fonts[f], YELLOW, BLUE);
+            }
+            ST7789_WaitIdle();
+            ns[f] = (double)(clock() - t0) * 1e9 / CLOCKS_PER_SEC / (passes * (sizeof(str) - 1));
+            best[f] = ns[f] < best[f] ? ns[f] : best[f];
+        }
+        // insertion sort of 4bpp to 1bpp ratios
+        uint16_t i = k;
+        while ((i > 0) && (ratio[i - 1] > ns[1] / ns[0]))
+        {
+            ratio[i] = ratio[i - 1];
+            i--;
+        }
+        ratio[i] = ns[1] / ns[0];
+    }
+    printf("      %-28s %6.1f ns 1bpp %6.1f ns 4bpp per char, median %.2f\n",
+           "Font_16x26 render", best[0], best[1], ratio[runs / 2]);
+    assert(!TEST_TIMING || (ratio[runs / 2] <= 1.2));
+}
+
+/** text screen with cached address window, picture is the same as cold one */
+void test_st7789_window_cache(void)
+{
+    static const char * const labels[] = {"Band", "Mode", "Filter", "AGC", "Power", "Step"};
+    static const char * const values[] = {"20m", "USB", "2.7k", "fast", "5W", "10Hz"};
+    uint16_t rows = sizeof(labels) / sizeof(labels[0]);
+    uint32_t cold = 0, crc = 0;
+
+    for (uint16_t pass = 0; pass < 2; pass++)
+    {
+        st7789_emu_attach(BLACK);
+        memset(&st7789_cache_stats, 0, sizeof(st7789_cache_stats));
+        fake_spi_reset();
+        for (uint16_t i = 0; i < rows; i++)
+        {
+            uint16_t y = (uint16_t)(10 + i * Font_11x18.height);
+            if (pass == 0)
+            {
+                ST7789_Invalidate();
+            }
+            // label and value of the same row share RASET
+            ST7789_WriteString(10, y, labels[i], Font_11x18, WHITE, BLUE);
+            ST7789_WriteString(120, y, values[i], Font_11x18, YELLOW, BLUE);
+        }
+        // rows of the same width are one data transaction
+        for (uint16_t i = 0; i < rows; i++)
+        {
+            ST7789_WriteString(10, (uint16_t)(130 + i * Font_11x18.height), "----------",
+                               Font_11x18, GREEN, BLACK);
+        }
+        ST7789_WaitIdle();
+        if (pass == 0)
+        {
+            cold = fake_spi_stats.bytes + st7789_cache_stats.saved;
+            crc = st7789_emu_crc(0, 0, ST7789_WIDTH, ST7789_HEIGHT);
+        }
+    }
+    printf("      %-28s %6u bytes cold %6u bytes cached %5u saved\n", "ST7789 window cache",
+           cold, fake_spi_stats.bytes, st7789_cache_stats.saved);
+    assert(st7789_emu_crc(0, 0, ST7789_WIDTH, ST7789_HEIGHT) == crc);
+    assert(cold - fake_spi_stats.bytes == st7789_cache_stats.saved);
+    assert(st7789_cache_stats.raset_skipped == rows);
+    assert(st7789_cache_stats.continued == rows - 1u);
+    assert(st7789_cache_stats.saved == rows * 5u + (rows - 1u) * 11u);
+
+    // the same rotation is not sent again
+    fake_spi_reset();
+    ST7789_SetRotation(ST7789_ROTATION);
+    ST7789_SetRotation(ST7789_ROTATION);
+    assert(fake_spi_stats.bytes == 2);
+    st7789_emu_detach();
+}
+
+/** proportional text is sent as one run per line */
+void test_st7789_proportional(void)
+{
+    const char str[] = "Illinois 14.250";
+    uint16_t x = 5;
+    st7789_emu_attach(BLACK);
+    fake_spi_reset();
+    ST7789_WriteString(x, 40, str, Font_11x18p, WHITE, BLUE);
+    ST7789_WaitIdle();
+    assert(fake_spi_stats.transactions == 6);
+    for (uint16_t i = 0; i < strlen(str); i++)
+    {
+        test_check_char(x, 40, str[i], Font_11x18p, WHITE, BLUE);
+        x = (uint16_t)(x + Font_Advance(&Font_11x18p, Font_Glyph(&Font_11x18p, str[i])));
+    }
+    // narrower than monospace
+    assert(x < 5 + strlen(str) * Font_11x18.width);
+    assert(st7789_emu_pixel(x, 40) == BLACK);
+    st7789_emu_detach();
+}
+
+/** compare two files */
+static int test_files_equal(const char *a, const char *b)
+{
+    FILE *fa = fopen(a, "rb");
+    FILE *fb = fopen(b, "rb");
+    int ca, cb, equal = (fa != NULL) && (fb != NULL);
+    while (equal)
+    {
+        ca = fgetc(fa);
+        cb = fgetc(fb);
+        equal = (ca == cb);
+        if (ca == EOF)
+        {
+            break;
+        }
+    }
+    if (fa)
+    {
+        fclose(fa);
+    }
+    if (fb)
+    {
+        fclose(fb);
+    }
+    return equal;
+}
+
+/** packed image decoded in pieces of any size gives source pixels */
+void test_image_decode(void)
+{
+    static uint16_t pixels[128 * 128];
+    image_decoder_t dec;
+    const uint16_t *src = test_saber_rgb565();
+    uint32_t n = 0;
+
+    printf("      %-28s %6u bytes, packed %6u bytes\n", "image_saber",
+           (unsigned)sizeof(pixels), image_saber.size);
+    assert(image_saber.size < sizeof(pixels));
+
+    image_decode_start(&dec, &image_saber);
+    while (n < 128 * 128)
+    {
+        uint16_t got = image_decode(&dec, &pixels[n], 37);
+        assert((got == 37) || (n + got == 128 * 128));
+        n += got;
+    }
+    assert(image_decode(&dec, pixels, 1) == 0);
+    assert(!memcmp(pixels, src, sizeof(pixels)));
+
+    // broken image ends early
+    image_t cut = image_saber;
+    cut.size /= 2;
+    image_decode_start(&dec, &cut);
+    assert(image_decode(&dec, pixels, 65535) < 128 * 128);
+}
+
+/** packed image on panel, compared with raw one through PPM files */
+void test_image_draw_ppm(void)
+{
+    st7789_emu_attach(BLACK);
+    fake_spi_reset();
+    ST7789_DrawPackedImage(50, 60, &image_saber);
+    ST7789_WaitIdle();
+    test_print_spi_stats("ST7789_DrawPackedImage");
+    // one window, rows are sent in one data transaction
+    assert(fake_spi_stats.transactions == 6);
+    assert(fake_spi_stats.data_bytes == 8 + 128 * 128 * 2);
+    assert(!st7789_emu_write_ppm("saber_packed.ppm", 50, 60, 128, 128));
+
+    st7789_emu_attach(WHITE);
+    ST7789_DrawImage(0, 0, 128, 128, test_saber_rgb565());
+    ST7789_WaitIdle();
+    assert(!st7789_emu_write_ppm("saber_raw.ppm", 0, 0, 128, 128));
+    assert(test_files_equal("saber_packed.ppm", "saber_raw.ppm"));
+
+    // image at the corner is cut to visible 40x90 pixels
+    st7789_emu_attach(BLACK);
+    fake_spi_reset();
+    ST7789_DrawPackedImage(200, 150, &image_saber);
+    ST7789_WaitIdle();
+    assert(fake_spi_stats.data_bytes == 8 + 40 * 90 * 2);
+    assert(!st7789_emu_write_ppm("saber_packed.ppm", 200, 150, 40, 90));
+    st7789_emu_attach(WHITE);
+    ST7789_DrawImage(200, 150, 128, 128, test_saber_rgb565());
+    ST7789_WaitIdle();
+    assert(!st7789_emu_write_ppm("saber_raw.ppm", 200, 150, 40, 90));
+    assert(test_files_equal("saber_packed.ppm", "saber_raw.ppm"));
+
+    // image outside of screen is not sent
+    fake_spi_reset();
+    ST7789_DrawPackedImage(0, ST7789_HEIGHT, &image_saber);
+    assert(fake_spi_stats.bytes == 0);
+    st7789_emu_detach();
+}
+
+/** drain display queue to emulated panel */
+static void test_display_drain(void)
+{
+    display_cmd_t cmd;
+    while (display_take(&cmd))
+    {
+        display_execute(&cmd);
+    }
+    ST7789_WaitIdle();
+}
+
+/** repeated widget updates and overdrawn commands are merged */
+void test_display_coalesce(void)
+{
+    display_cmd_t cmd;
+    char freq[] = "14.070.00";
+
+    display_init();
+    // frequency widget updated faster than drawn
+    for (uint16_t i = 0; i < 10; i++)
+    {
+        freq[7] = (char)('0' + i);
+        assert(display_text(10, 40, freq, &Font_16x26, WHITE, BLACK) == 0);
+    }
+    assert(display_pending() == 1);
+    assert(display_stats.coalesced == 9);
+    // partly overlapping and scroll commands stay
+    assert(display_fill(0, 30, 60, 50, RED) == 0);
+    assert(display_scroll(10) == 0);
+    assert(display_scroll(20) == 0);
+    assert(display_pending() == 3);
+    freq[7] = 'X';
+    assert(display_text(10, 40, freq, &Font_16x26, WHITE, BLACK) == 0);
+    assert(display_pending() == 3);
+
+    // order of pending commands is kept
+    assert(display_take(&cmd) && (cmd.type == DISPLAY_CMD_FILL));
+    assert(display_take(&cmd) && (cmd.type == DISPLAY_CMD_SCROLL) && (cmd.color == 20));
+    assert(display_take(&cmd) && (cmd.type == DISPLAY_CMD_TEXT) && !strcmp(cmd.text, freq));
+    assert(!display_take(&cmd));
+
+    // full screen fill drops all drawing, text is cut at screen edge
+    assert(display_text(200, 0, "long text", &Font_11x18, WHITE, BLACK) == 0);
+    assert(display_image(0, 100, &image_saber) == 0);
+    assert(display_fill(0, 0, 1000, 1000, BLUE) == 0);
+    assert(display_pending() == 1);
+    assert(display_take(&cmd) && (cmd.x1 == ST7789_WIDTH - 1) && (cmd.y1 == ST7789_HEIGHT - 1));
+    assert(display_text(300, 0, "x", &Font_11x18, WHITE, BLACK) == EINVAL);
+
+    // full queue rejects posts
+    for (uint16_t i = 0; i < DISPLAY_QUEUE_SIZE; i++)
+    {
+        assert(display_fill(i, 0, i, 0, RED) == 0);
+    }
+    assert(display_fill(100, 100, 101, 101, RED) == EBUSY);
+    assert(display_stats.rejected == 1);
+    display_init();
+
+    // interrupt posts are coalesced with task ones
+    assert(display_fill(20, 20, 29, 29, RED) == 0);
+    cmd.type = DISPLAY_CMD_FILL;
+    cmd.x0 = cmd.y0 = 10;
+    cmd.x1 = cmd.y1 = 39;
+    cmd.color = BLUE;
+    assert(display_post_from_isr(&cmd) == 0);
+    assert(display_pending() == 1);
+    assert(display_stats.coalesced == 1);
+    assert(display_take(&cmd) && (cmd.color == BLUE));
+    display_init();
+}
+
+/** viewport moves and cuts following commands, it is carried by each */
+void test_display_viewport(void)
+{
+    display_cmd_t cmd;
+
+    st7789_emu_attach(BLACK);
+    display_init();
+    assert(display_viewport(0, 0, 0, 10) == EINVAL);
+    assert(display_viewport(ST7789_WIDTH, 0, 10, 10) == EINVAL);
+    assert(display_fill(0, 0, 9, 9, WHITE) == 0);
+    assert(display_viewport(100, 100, 40, 20) == 0);
+    // local coordinates, not coalesced with the same local bounds
+    assert(display_fill(0, 0, 9, 9, RED) == 0);
+    assert(display_fill(30, 10, 60, 40, GREEN) == 0);
+    assert(display_stats.coalesced == 0);
+    // coalesced by bounds on screen
+    assert(display_fill(0, 0, 9, 9, YELLOW) == 0);
+    assert(display_fill(0, 0, 9, 9, RED) == 0);
+    assert(display_stats.coalesced == 2);
+    display_viewport_reset();
+    assert(display_fill(0, 0, 109, 109, BLUE) == 0);
+    assert(display_fill(100, 100, 109, 109, RED) == 0);
+    assert(display_stats.coalesced == 4);
+    assert(display_pending() == 3);
+    test_display_drain();
+    assert(st7789_emu_pixel(0, 0) == BLUE);
+    assert(st7789_emu_pixel(100, 100) == RED);
+    assert(st7789_emu_pixel(109, 109) == RED);
+    assert(st7789_emu_pixel(130, 110) == GREEN);
+    assert(st7789_emu_pixel(139, 119) == GREEN);
+    // cut by viewport
+    assert(st7789_emu_pixel(140, 110) == BLACK);
+    assert(st7789_emu_pixel(130, 120) == BLACK);
+    // viewport is cut to screen, text is cut by it
+    assert(display_viewport(200, 200, 100, 100) == 0);
+    assert(display_fill(0, 0, 100, 100, RED) == 0);
+    assert(display_text(0, 0, "Not wrapped", &Font_7x10, WHITE, BLUE) == 0);
+    display_viewport_reset();
+    test_display_drain();
+    assert(st7789_emu_pixel(ST7789_WIDTH - 1, ST7789_HEIGHT - 1) == RED);
+    assert(st7789_emu_pixel(199, 199) == BLACK);
+    assert(st7789_emu_pixel(234, 200) != RED);
+    assert(st7789_emu_pixel(235, 200) == RED);
+    assert(st7789_emu_pixel(200, 215) == RED);
+    // viewport does not stay set after commands
+    ST7789_Fill_Color(BLACK);
+    ST7789_WaitIdle();
+    assert(st7789_emu_pixel(0, 0) == BLACK);
+    // interrupt posts are in screen coordinates
+    assert(display_viewport(100, 100, 40, 20) == 0);
+    cmd.type = DISPLAY_CMD_FILL;
+    cmd.x0 = cmd.y0 = 0;
+    cmd.x1 = cmd.y1 = 9;
+    cmd.color = GREEN;
+    assert(display_post_from_isr(&cmd) == 0);
+    display_viewport_reset();
+    test_display_drain();
+    assert(st7789_emu_pixel(0, 0) == GREEN);
+    assert(st7789_emu_pixel(100, 100) == BLACK);
+    display_init();
+    st7789_emu_detach();
+}
+
+/** picture after coalesced queue is the same as after drawing every command */
+void test_display_equivalence(void)
+{
+    static uint16_t direct[ST7789_EMU_MEM_HEIGHT][ST7789_EMU_MEM_WIDTH];
+    const FontDef *fonts[] = {&Font_7x10, &Font_11x18, &Font_16x26p};
+    const char *texts[] = {"7.074", "14.250.00", "USB", "-73 dBm"};
+    uint32_t seed;
+    uint32_t coalesced = 0;
+
+    for (uint16_t pass = 0; pass < 2; pass++)
+    {
+        st7789_emu_attach(BLACK);
+        display_init();
+        seed = 12345;
+        for (uint16_t i = 0; i < 300; i++)
+        {
+            uint16_t r[4];
+            for (uint16_t k = 0; k < 4; k++)
+            {
+                seed = seed * 1103515245 + 12345;
+                r[k] = (uint16_t)(seed >> 16);
+            }
+            // few widget positions, so updates overlap like in real ui
+            uint16_t x = (uint16_t)((r[0] % 4) * 50);
+            uint16_t y = (uint16_t)((r[1] % 6) * 36);
+            if (r[2] % 5 == 0)
+            {
+                assert(display_fill(x, y, (uint16_t)(x + r[3] % 80),
+                                    (uint16_t)(y + r[3] % 40), r[3]) == 0);
+            }
+            else
+            {
+                assert(display_text(x, y, texts[r[3] % 4], fonts[r[2] % 3],
+                                    r[3], (uint16_t)~r[3]) == 0);
+            }
+            // direct pass draws every command, queued one drains when full
+            if ((pass == 0) || (display_pending() == DISPLAY_QUEUE_SIZE))
+            {
+                test_display_drain();
+            }
+        }
+        test_display_drain();
+        if (pass == 0)
+        {
+            memcpy(direct, st7789_emu_mem, sizeof(direct));
+        }
+        else
+        {
+            coalesced = display_stats.coalesced;
+        }
+    }
+    printf("      %-28s %6u of 300 commands merged\n", "display queue", coalesced);
+    assert(coalesced > 0);
+    assert(!memcmp(direct, st7789_emu_mem, sizeof(direct)));
+    st7789_emu_detach();
+}
+
+/** frame start by TE pulses, frame rate cap and TE timeout */
+void test_display_te_sync(void)
+{
+    display_init();
+    // no sync - drawn at once
+    assert(!display_frame_begin(DISPLAY_EVENT_POST, 0));
+    assert(display_fill(0, 0, 9, 9, RED) == 0);
+    assert(display_frame_begin(DISPLAY_EVENT_POST, 0));
+    test_display_drain();
+    display_frame_end();
+    assert(display_stats.frames == 0);
+
+    assert(display_sync(DISPLAY_PANEL_FPS + 1) == EINVAL);
+    assert(display_sync(30) == 0);
+    // posted commands wait for TE pulse
+    assert(display_fill(0, 0, 9, 9, RED) == 0);
+    assert(!display_frame_begin(DISPLAY_EVENT_POST, 0));
+    display_te_irq();
+    assert(display_frame_begin(DISPLAY_EVENT_TE, 16));
+    test_display_drain();
+    display_frame_end();
+    assert((display_stats.frames == 1) && (display_stats.missed == 0));
+
+    // 30 fps - every second pulse of 60 Hz panel
+    assert(display_fill(0, 0, 9, 9, RED) == 0);
+    display_te_irq();
+    assert(!display_frame_begin(DISPLAY_EVENT_TE, 33));
+    display_te_irq();
+    assert(display_frame_begin(DISPLAY_EVENT_TE, 50));
+    test_display_drain();
+    display_te_irq();   // panel scan overtakes drawing
+    display_frame_end();
+    assert((display_stats.frames == 2) && (display_stats.missed == 1));
+
+    // silent TE line
+    assert(display_fill(0, 0, 9, 9, RED) == 0);
+    assert(!display_frame_begin(DISPLAY_EVENT_POST, 1000));
+    assert(!display_frame_begin(DISPLAY_EVENT_POST, 1000 + DISPLAY_TE_TIMEOUT - 1));
+    assert(display_frame_begin(0, 1000 + DISPLAY_TE_TIMEOUT));
+    test_display_drain();
+    display_frame_end();
+    assert(display_stats.unsynced == 1);
+    display_init();
+}
+
+/**
+ * meter animated faster than panel, drawn with TE sync at 60 Hz panel,
+ * frame time is estimated from sent bytes
+ */
+void test_display_te_bench(void)
+{
+    const uint8_t caps[] = {60, 30, 20};
+    const double te_period = 1000.0 / DISPLAY_PANEL_FPS;
+
+    for (uint16_t k = 0; k < sizeof(caps); k++)
+    {
+        double next_te = te_period;
+        display_init();
+        assert(display_sync(caps[k]) == 0);
+        for (uint32_t ms = 0; ms < 1000; ms++)
+        {
+            uint32_t events = 0;
+            // needle of s-meter moves every 2 ms
+            uint16_t level = (uint16_t)(ms % 200);
+            if (ms % 2 == 0)
+            {
+                assert(display_fill(20, 200, 220, 215, BLACK) == 0);
+                assert(display_fill(20, 200, (uint16_t)(20 + level), 215, GREEN) == 0);
+                events |= DISPLAY_EVENT_POST;
+            }
+            if (ms >= next_te)
+            {
+                display_te_irq();
+                next_te += te_period;
+                events |= DISPLAY_EVENT_TE;
+            }
+            if (display_frame_begin(events, ms))
+            {
+                fake_spi_reset();
+                test_display_drain();
+                // pulses during drawing
+                double end = ms + fake_spi_time_us() / 1000.0;
+                while (end >= next_te)
+                {
+                    display_te_irq();
+                    next_te += te_period;
+                }
+                display_frame_end();
+            }
+        }
+        printf("      %-28s %3u fps cap %4u frames %3u missed %3u coalesced\n",
+               "display TE sync", caps[k], display_stats.frames,
+               display_stats.missed, display_stats.coalesced);
+        assert(display_stats.frames <= caps[k]);
+        assert(display_stats.frames + 1 >= caps[k]);
+        assert(display_stats.missed == 0);
+        assert(display_stats.unsynced == 0);
+    }
+    display_init();
+}
+
+/**
+ * primitives drawn for golden images
+ * @{
+ */
+static void test_golden_fill_color(void)
+{
+    ST7789_Fill_Color(BLUE);
+}
+
+static void test_golden_fill(void)
+{
+    ST7789_Fill(10, 20, 229, 59, RED);
+    ST7789_Fill(100, 0, 100, 239, GREEN);
+}
+
+static void test_golden_pixels(void)
+{
+    for (uint16_t i = 0; i < 240; i += 7)
+    {
+        ST7789_DrawPixel(i, (uint16_t)(i * i % 240), WHITE);
+        ST7789_DrawPixel_4px((uint16_t)(i / 2 + 1), (uint16_t)(i + 1 < 239 ? i + 1 : 238), YELLOW);
+    }
+}
+
+static void test_golden_lines(void)
+{
+    for (uint16_t i = 0; i < 240; i += 24)
+    {
+        ST7789_DrawLine(0, i, 239, (uint16_t)(239 - i), (uint16_t)(i * 271));
+        ST7789_DrawLine(i, 0, 120, 120, WHITE);
+    }
+}
+
+static void test_golden_rectangles(void)
+{
+    ST7789_DrawRectangle(20, 30, 120, 90, WHITE);
+    ST7789_DrawRectangle(200, 200, 239, 239, CYAN);
+    ST7789_DrawFilledRectangle(50, 100, 60, 40, MAGENTA);
+    ST7789_DrawFilledRectangle(220, 10, 100, 100, GREEN);  // clipped
+}
+
+static void test_golden_circles(void)
+{
+    ST7789_DrawCircle(120, 120, 100, WHITE);
+    ST7789_DrawCircle(10, 10, 30, RED);
+    ST7789_DrawFilledCircle(160, 60, 40, YELLOW);
+    ST7789_DrawFilledCircle(230, 230, 25, BLUE);
+}
+
+static void test_golden_triangles(void)
+{
+    ST7789_DrawTriangle(10, 10, 100, 30, 40, 120, WHITE);
+    ST7789_DrawFilledTriangle(120, 110, 20, 230, 235, 190, GREEN);
+}
+
+static void test_golden_text(void)
+{
+    ST7789_WriteChar(0, 0, 'W', Font_16x26, BLUE, WHITE);
+    ST7789_WriteString(20, 0, "14.074.010", Font_16x26, WHITE, LGRAY);
+    ST7789_WriteString(0, 40, "Hello Steve! long line is wrapped", Font_11x18, RED, WHITE);
+    ST7789_WriteString(0, 100, "Hello Steve!", Font_7x10, YELLOW, BLACK);
+    ST7789_WriteString(0, 120, "Proportional 7.074", Font_11x18p, GREEN, BLACK);
+    ST7789_WriteString(0, 150, "S9+20", Font_16x26p, CYAN, BLACK);
+}
+
+static void test_golden_text_aa(void)
+{
+    ST7789_WriteChar(0, 0, 'W', Font_16x26a, BLUE, WHITE);
+    ST7789_WriteString(20, 0, "14.074.010", Font_16x26a, WHITE, LGRAY);
+    ST7789_WriteString(0, 40, "Hello Steve! long line is wrapped", Font_11x18a, RED, WHITE);
+    ST7789_WriteString(0, 120, "Proportional 7.074", Font_11x18ap, GREEN, BLACK);
+    ST7789_WriteString(0, 150, "S9+20", Font_16x26ap, CYAN, BLACK);
+}
+
+static void test_golden_images(void)
+{
+    ST7789_DrawImage(0, 0, 128, 128, test_saber_rgb565());
+    ST7789_DrawPackedImage(112, 112, &image_saber);
+}
+
+static void test_golden_scroll(void)
+{
+    for (uint16_t y = 0; y < 240; y += 20)
+    {
+        ST7789_Fill(0, y, 239, (uint16_t)(y + 9), (uint16_t)(y * 273));
+    }
+    ST7789_SetScrollArea(40, 160);
+    ST7789_SetScrollStart(100);
+}
+
+static void test_golden_invert(void)
+{
+    ST7789_Fill(0, 0, 119, 239, RED);
+    ST7789_InvertColors(0);
+}
+
+static void test_golden_test(void)
+{
+    ST7789_Test();
+}
+/**
+ * @}
+ */
+
+/**
+ * golden image: CRC32 of screen as seen on panel after drawing
+ */
+typedef struct //vera++ blamed for single space
+{
+    const char *name;
+    void (*draw)(void);
+    uint32_t crc;
+} test_golden_t;
+
+static const test_golden_t test_golden_list[] =
+{
+    {"fill_color",  test_golden_fill_color,  0x327fa90a},
+    {"fill",        test_golden_fill,        0x330b74a2},
+    {"pixels",      test_golden_pixels,      0xc072f2e1},
+    {"lines",       test_golden_lines,       0x73b75e82},
+    {"rectangles",  test_golden_rectangles,  0x4dadcaf3},
+    {"circles",     test_golden_circles,     0x730c0dcb},
+    {"triangles",   test_golden_triangles,   0x310aac25},
+    {"text",        test_golden_text,        0xd01a8668},
+    {"text_aa",     test_golden_text_aa,     0x4f947ddb},
+    {"images",      test_golden_images,      0x5f7417df},
+    {"scroll",      test_golden_scroll,      0xeb1082af},
+    {"invert",      test_golden_invert,      0x16a67cc9},
+    {"ST7789_Test", test_golden_test,        0xec374756},
+};
+
+/**
+ * primitives are drawn on emulated panel and compared with golden CRC,
+ * changed picture is left in golden_<name>.ppm for review
+ */
+void test_st7789_golden(void)
+{
+    boolean ok = TRUE;
+
+    printf("      %-16s %12s %10s %10s %10s %10s\n", "primitive", "transactions",
+           "bytes", "frames", "us", "crc");
+    for (uint16_t i = 0; i < sizeof(test_golden_list) / sizeof(test_golden_list[0]); i++)
+    {
+        const test_golden_t *g = &test_golden_list[i];
+        st7789_emu_attach(BLACK);
+        fake_spi_reset();
+        g->draw();
+        ST7789_WaitIdle();
+        uint32_t crc = st7789_emu_crc(0, 0, ST7789_WIDTH, ST7789_HEIGHT);
+        printf("      %-16s %12u %10u %10u %10u   %08x\n", g->name,
+               fake_spi_stats.transactions, fake_spi_stats.bytes,
+               fake_spi_stats.frames, fake_spi_time_us(), crc);
+        if (crc != g->crc)
+        {
+            char path[40];
+            snprintf(path, sizeof(path), "golden_%s.ppm", g->name);
+            st7789_emu_write_ppm(path, 0, 0, ST7789_WIDTH, ST7789_HEIGHT);
+            printf("      %-16s changed, see %s\n", g->name, path);
+            ok = FALSE;
+        }
+    }
+    st7789_emu_detach();
+    assert(ok);
+}
+
+/** emulated MADCTL, inversion and CRC */
+void test_st7789_emu_modes(void)
+{
+    const uint8_t check[] = "123456789";
+    assert(crc32_update(0, check, 9) == 0xCBF43926U);
+    assert(crc32_update(crc32_update(0, check, 4), check + 4, 5) == 0xCBF43926U);
+
+    st7789_emu_attach(BLACK);
+    // rotation 1: MY | MV, columns go down along rows of memory
+    ST7789_SetRotation(1);
+    ST7789_Fill(0, 0, 9, 4, RED);
+    assert(st7789_emu_mem[ST7789_EMU_MEM_HEIGHT - 1][0] == RED);
+    assert(st7789_emu_mem[ST7789_EMU_MEM_HEIGHT - 10][4] == RED);
+    assert(st7789_emu_mem[ST7789_EMU_MEM_HEIGHT - 11][4] == BLACK);
+    assert(st7789_emu_mem[ST7789_EMU_MEM_HEIGHT - 1][5] == BLACK);
+    // rotation 0: MX | MY
+    st7789_emu_attach(BLACK);
+    ST7789_SetRotation(0);
+    ST7789_Fill(0, 0, 9, 4, RED);
+    assert(st7789_emu_mem[ST7789_EMU_MEM_HEIGHT - 1][ST7789_EMU_MEM_WIDTH - 1] == RED);
+    assert(st7789_emu_mem[ST7789_EMU_MEM_HEIGHT - 5][ST7789_EMU_MEM_WIDTH - 10] == RED);
+    assert(st7789_emu_mem[0][0] == BLACK);
+    // screen coordinates follow MADCTL
+    assert(st7789_emu_pixel(9, 4) == RED);
+    assert(st7789_emu_pixel(10, 4) == BLACK);
+    ST7789_SetRotation(ST7789_ROTATION);
+
+    // IPS panel shows true colors with INVON only
+    st7789_emu_attach(BLACK);
+    ST7789_Fill(0, 0, 0, 0, RED);
+    assert(st7789_emu_shown(0, 0) == RED);
+    ST7789_InvertColors(0);
+    assert(st7789_emu_pixel(0, 0) == RED);
+    assert(st7789_emu_shown(0, 0) == (uint16_t)~RED);
+    ST7789_InvertColors(1);
+    assert(st7789_emu_shown(0, 0) == RED);
+    st7789_emu_detach();
+}
+
+/** test reads of panel id and memory through emulator */
+void test_st7789_read_back(void)
+{
+    uint8_t id[3] = {0, 0, 0};
+    uint16_t pixels[16 * 8];
+    const uint16_t *img = test_saber_rgb565();
+    spi_config_t cfg;
+
+    fake_spi_reset();
+    st7789_emu_attach(BLACK);
+    assert(ST7789_ReadID(id) == 0);
+    assert((id[0] == ST7789_ID1) && (id[1] == ST7789_ID2) && (id[2] == ST7789_ID3));
+
+    // reads go at safe clock, write clock is restored after
+    cfg.baudrate = 0;
+    cfg.cpol = cfg.cpha = TRUE;
+    assert(spi_configure(SPI1, &cfg) == 0);
+    ST7789_DrawImage(30, 40, 16, 8, img);
+    ST7789_WaitIdle();
+    fake_spi_stats.transfers = 0;
+    assert(ST7789_ReadPixels(30, 40, 45, 47, pixels) == 0);
+    // RAMRD is received by runs of pixels, not pixel by pixel
+    printf("      %-28s %u transfers for %u pixels\n", "ST7789_ReadPixels",
+           fake_spi_stats.transfers, 16 * 8);
+    assert(fake_spi_stats.transfers <= 8 + (16 * 8 + ST7789_READ_CHUNK - 1) / ST7789_READ_CHUNK);
+    for (uint16_t i = 0; i < 16 * 8; i++)
+    {
+        assert(pixels[i] == img[i]);
+    }
+    spi_get_config(SPI1, &cfg);
+    assert(cfg.baudrate == 0);
+    st7789_emu_detach();
+    fake_spi_reset();
+}
+
+/** test spi clock calibration against link with limited clock */
+void test_st7789_calibrate(void)
+{
+    static const uint32_t limits[] = {10000000, 20000000, 0};
+    static const uint8_t expected[] = {2, 1, 0};
+    st7789_link_t link = {0, 0, 0};
+    spi_config_t cfg;
+
+    // no panel answers
+    fake_spi_reset();
+    assert(ST7789_Calibrate(&link) == EIO);
+    spi_get_config(SPI1, &cfg);
+    assert(cfg.baudrate == SPI_BAUDRATE_SLOWEST);
+    assert(link.clock_hz == 0);
+
+    // even slowest clock fails
+    st7789_emu_attach(WHITE);
+    fake_spi_max_hz = 100000;
+    assert(ST7789_Calibrate(&link) == EIO);
+    spi_get_config(SPI1, &cfg);
+    assert(cfg.baudrate == SPI_BAUDRATE_SLOWEST);
+
+    for (uint16_t k = 0; k < sizeof(limits) / sizeof(limits[0]); k++)
+    {
+        fake_spi_reset();
+        st7789_emu_attach(WHITE);
+        fake_spi_max_hz = limits[k];
+        assert(ST7789_Calibrate(&link) == 0);
+        spi_get_config(SPI1, &cfg);
+        printf("      %-28s %8u Hz limit %8u Hz clock %8u pixels/s\n", "ST7789_Calibrate",
+               limits[k], link.clock_hz, link.fill_rate);
+        assert(link.baudrate == expected[k]);
+        assert(cfg.baudrate == expected[k]);
+        assert(link.clock_hz == spi_clock_hz(SPI1, expected[k]));
+        // 16 bits per pixel, no gaps in dma fill, time in whole ms
+        assert(link.fill_rate >= link.clock_hz / 16 * 95 / 100);
+        assert(link.fill_rate <= link.clock_hz / 16 * 105 / 100);
+        // test window is cleared with screen
+        assert(st7789_emu_pixel(0, 0) == BLACK);
+        assert(st7789_emu_pixel(ST7789_WIDTH - 1, ST7789_HEIGHT - 1) == BLACK);
+    }
+
+    // calibration is posted to render task and never coalesced
+    display_init();
+    st7789_emu_attach(WHITE);
+    assert(display_fill(0, 0, 9, 9, RED) == 0);
+    assert(display_calibrate() == 0);
+    assert(display_calibrate() == 0);
+    assert(display_fill(0, 0, ST7789_WIDTH - 1, ST7789_HEIGHT - 1, BLUE) == 0);
+    assert(display_pending() == 2);
+    display_link.clock_hz = 0;
+    display_cmd_t cmd;
+    while (display_take(&cmd))
+    {
+        display_execute(&cmd);
+    }
+    ST7789_WaitIdle();
+    assert(display_link.clock_hz == spi_clock_hz(SPI1, 0));
+    assert(st7789_emu_pixel(0, 0) == BLUE);
+    st7789_emu_detach();
+    fake_spi_reset();
+}
+
+/** test CRC self-test of display link by read back */
+void test_st7789_verify(void)
+{
+    st7789_verify_t v = {0, 0, 0, 0, 0, 0};
+    uint32_t status, crc;
+    spi_config_t cfg;
+
+    fake_spi_reset();
+    st7789_emu_attach(BLACK);
+    fake_spi_max_hz = 20000000;
+    assert(ST7789_ReadStatus(&status) == 0);
+    assert((status & ST7789_STATUS_CHECK) == ST7789_STATUS_RUNNING);
+    assert(status & ST7789_STATUS_INVON);
+
+    // CRC of region read back is CRC of drawn pixels
+    ST7789_DrawImage(30, 40, 16, 8, test_saber_rgb565());
+    assert(ST7789_ReadCRC(30, 40, 45, 47, &crc) == 0);
+    assert(crc == ST7789_CrcPixels(0, test_saber_rgb565(), 16 * 8));
+    assert(crc == st7789_emu_crc(30, 40, 16, 8));
+
+    // good link
+    spi_get_config(SPI1, &cfg);
+    cfg.baudrate = 1;
+    assert(spi_configure(SPI1, &cfg) == 0);
+    assert(ST7789_Verify(&v, 2) == 0);
+    printf("      %-28s %8u Hz %u rounds %u errors\n", "ST7789_Verify",
+           spi_clock_hz(SPI1, 1), v.rounds, v.errors);
+    assert((v.rounds == 2) && (v.errors == 0) && (v.status_errors == 0));
+    assert(v.crc == v.expected);
+    assert(st7789_emu_pixel(ST7789_WIDTH - 1, ST7789_HEIGHT - 1) == BLACK);
+
+    // link too fast for wires, every screen is corrupted
+    cfg.baudrate = 0;
+    assert(spi_configure(SPI1, &cfg) == 0);
+    assert(ST7789_Verify(&v, 2) == EIO);
+    printf("      %-28s %8u Hz %u rounds %u errors\n", "ST7789_Verify",
+           spi_clock_hz(SPI1, 0), v.rounds, v.errors);
+    assert((v.rounds == 4) && (v.errors == 2) && (v.status_errors == 0));
+    spi_get_config(SPI1, &cfg);
+    assert(cfg.baudrate == 0);
+
+    // panel reset by glitch is found by status
+    cfg.baudrate = 1;
+    assert(spi_configure(SPI1, &cfg) == 0);
+    st7789_emu_reset();
+    assert(ST7789_Verify(&v, 1) == EIO);
+    assert((v.rounds == 5) && (v.errors == 2) && (v.status_errors == 1));
+    assert((v.status & ST7789_STATUS_CHECK) != ST7789_STATUS_RUNNING);
+
+    // test is posted to render task, only last one is kept
+    display_init();
+    st7789_emu_attach(WHITE);
+    assert(display_verify(1) == 0);
+    assert(display_verify(3) == 0);
+    assert(display_fill(0, 0, ST7789_WIDTH - 1, ST7789_HEIGHT - 1, BLUE) == 0);
+    assert(display_pending() == 2);
+    display_verify_result = v;
+    display_cmd_t cmd;
+    while (display_take(&cmd))
+    {
+        display_execute(&cmd);
+    }
+    ST7789_WaitIdle();
+    assert((display_verify_result.rounds == 8) && (display_verify_result.errors == 2));
+    assert(st7789_emu_pixel(0, 0) == BLUE);
+    st7789_emu_detach();
+    fake_spi_reset();
+}
+
+/** drawing of queued commands is checked by CRC of its window */
+void test_display_check(void)
+{
+    const st7789_check_t zero = {0, 0, 0, 0, 0};
+    spi_config_t cfg;
+
+    fake_spi_reset();
+    st7789_emu_attach(BLACK);
+    fake_spi_max_hz = 20000000;
+    spi_get_config(SPI1, &cfg);
+    cfg.baudrate = 1;
+    assert(spi_configure(SPI1, &cfg) == 0);
+    display_init();
+    display_check_result = zero;
+
+    // only commands between switches are checked, switch is never coalesced
+    assert(display_fill(0, 0, 9, 9, RED) == 0);
+    assert(display_check(TRUE) == 0);
+    assert(display_fill(0, 0, ST7789_WIDTH - 1, ST7789_HEIGHT - 1, WHITE) == 0);
+    assert(display_text(10, 10, "Check", &Font_11x18, RED, WHITE) == 0);
+    assert(display_text(10, 40, "Check", &Font_16x26ap, BLUE, WHITE) == 0);
+    assert(display_viewport(20, 60, 50, 20) == 0);
+    assert(display_image(0, 0, &image_saber) == 0);
+    display_viewport_reset();
+    assert(display_check(FALSE) == 0);
+    assert(display_fill(0, 0, 9, 9, RED) == 0);
+    assert(display_pending() == 8);
+    test_display_drain();
+    assert((display_check_result.checked == 4) && (display_check_result.errors == 0));
+    assert(display_check_result.skipped == 0);
+    assert(display_check_result.crc == st7789_emu_crc(20, 60, 50, 20));
+
+    // text wrapped at viewport edge is drawn in several windows
+    ST7789_SetViewport(0, 0, 60, ST7789_HEIGHT);
+    ST7789_CheckStart();
+    ST7789_WriteString(0, 0, "Wrapped text", Font_11x18, RED, WHITE);
+    assert(ST7789_CheckEnd(&display_check_result) == 0);
+    ST7789_ResetViewport();
+    ST7789_WaitIdle();
+    assert((display_check_result.checked == 4) && (display_check_result.skipped == 1));
+    assert(display_check(TRUE) == 0);
+
+    // link too fast for wires, drawing is corrupted
+    cfg.baudrate = 0;
+    assert(spi_configure(SPI1, &cfg) == 0);
+    assert(display_fill(0, 0, ST7789_WIDTH - 1, ST7789_HEIGHT - 1, GBLUE) == 0);
+    assert(display_image(0, 100, &image_saber) == 0);
+    test_display_drain();
+    printf("      %-28s %8u Hz %u checked %u errors\n", "display_check",
+           spi_clock_hz(SPI1, 0), display_check_result.checked,
+           display_check_result.errors);
+    assert(display_check_result.errors == 2);
+    assert(display_check(FALSE) == 0);
+    test_display_drain();
+    st7789_emu_detach();
+    fake_spi_reset();
+}
+
+/** drain display queue, return pixels written to panel by it */
+static uint32_t test_widget_pixels(void)
+{
+    uint32_t start = st7789_emu_written;
+    test_display_drain();
+    return st7789_emu_written - start;
+}
+
+/** VFO step repaints only changed digits */
+void test_widget_freq(void)
+{
+    static const widget_text_def_t def = {10, 10, 11, &Font_11x18, WHITE, BLACK};
+    static const struct
+    {
+        uint32_t hz;
+        uint32_t chars;     /** chars expected to be redrawn */
+    } steps[] = {
+        {14074000, 11}, {14074001, 1}, {14074010, 2}, {14075000, 2},
+        {14075000, 0}, {7074000, 3}, {144300000, 6},
+    };
+    uint16_t cell = Font_11x18.width * Font_11x18.height;
+    uint32_t crc;
+    widget_freq_t f;
+
+    st7789_emu_attach(BLUE);
+    display_init();
+    widget_freq_init(&f, &def);
+    for (uint16_t i = 0; i < sizeof(steps) / sizeof(steps[0]); i++)
+    {
+        assert(widget_freq_set(&f, steps[i].hz) == 0);
+        uint32_t pixels = test_widget_pixels();
+        printf("      %-28s %9u Hz %5u pixels\n", "widget_freq", steps[i].hz, pixels);
+        assert(pixels == steps[i].chars * cell);
+    }
+    assert(widget_freq_set(&f, 4000000000UL) == EINVAL);
+    assert(f.hz == 144300000);
+
+    // same picture as fresh readout
+    crc = st7789_emu_crc(10, 10, 11 * 11, 18);
+    st7789_emu_attach(BLUE);
+    widget_freq_init(&f, &def);
+    assert(widget_freq_set(&f, 144300000) == 0);
+    test_display_drain();
+    assert(st7789_emu_crc(10, 10, 11 * 11, 18) == crc);
+    assert(st7789_emu_pixel(10, 10) == BLACK);
+    st7789_emu_detach();
+}
+
+/** labelled value with monospace and proportional font */
+void test_widget_label(void)
+{
+    static const widget_label_def_t mono =
+    {"BAT ", {10, 40, 4, &Font_7x10, GRAY, BLACK}, {38, 40, 5, &Font_7x10, WHITE, BLACK}};
+    static const widget_label_def_t prop =
+    {"SWR", {10, 60, 3, &Font_11x18p, GRAY, BLACK}, {60, 60, 5, &Font_11x18p, WHITE, BLACK}};
+    widget_label_t l;
+    uint32_t crc;
+
+    st7789_emu_attach(BLUE);
+    display_init();
+    widget_label_init(&l, &mono);
+    assert(widget_label_set(&l, "12.5V") == 0);
+    assert(test_widget_pixels() == 9 * 7 * 10);
+    assert(widget_label_set(&l, "12.6V") == 0);
+    assert(test_widget_pixels() == 7 * 10);
+
+    // wider digit moves the rest of value, freed columns are cleared
+    st7789_emu_attach(BLACK);
+    widget_label_init(&l, &prop);
+    assert(widget_label_set(&l, "1.1") == 0);
+    test_display_drain();
+    assert(widget_label_set(&l, "4.1") == 0);
+    assert(widget_label_set(&l, "1.1") == 0);
+    assert(widget_label_set(&l, "1.11") == 0);
+    assert(widget_label_set(&l, "1.1") == 0);
+    test_display_drain();
+    crc = st7789_emu_crc(10, 60, 150, 18);
+    st7789_emu_attach(BLACK);
+    widget_label_init(&l, &prop);
+    assert(widget_label_set(&l, "1.1") == 0);
+    test_display_drain();
+    assert(st7789_emu_crc(10, 60, 150, 18) == crc);
+    st7789_emu_detach();
+}
+
+/** S-meter redraws only segments between old and new level */
+void test_widget_meter(void)
+{
+    static const widget_meter_def_t def = {10, 100, 15, 8, 12, 2, 9, GREEN, RED, GRAY};
+    uint16_t seg = 8 * 12;
+    widget_meter_t m;
+    uint32_t crc;
+
+    st7789_emu_attach(BLACK);
+    display_init();
+    widget_meter_init(&m, &def);
+    assert(widget_meter_set(&m, 5) == 0);
+    assert(test_widget_pixels() == 15U * seg);
+    assert(widget_meter_set(&m, 6) == 0);
+    assert(test_widget_pixels() == seg);
+    assert(widget_meter_set(&m, 12) == 0);
+    assert(test_widget_pixels() == 6U * seg);
+    assert(widget_meter_set(&m, 12) == 0);
+    assert(test_widget_pixels() == 0);
+    assert(st7789_emu_pixel(10 + 8 * 10, 100) == GREEN);
+    assert(st7789_emu_pixel(10 + 10 * 9, 100) == RED);
+    assert(st7789_emu_pixel(10 + 10 * 12, 100) == GRAY);
+    assert(st7789_emu_pixel(10 + 8, 100) == BLACK);
+
+    // full queue: rest of segments is drawn by next update
+    for (uint16_t i = 0; i < DISPLAY_QUEUE_SIZE - 4; i++)
+    {
+        assert(display_fill(i, 200, i, 200, WHITE) == 0);
+    }
+    assert(widget_meter_set(&m, 0) == EBUSY);
+    test_display_drain();
+    assert(widget_meter_set(&m, 0) == 0);
+    assert(test_widget_pixels() == 8U * seg);
+    crc = st7789_emu_crc(10, 100, 150, 12);
+    st7789_emu_attach(BLACK);
+    widget_meter_init(&m, &def);
+    assert(widget_meter_set(&m, 0) == 0);
+    test_display_drain();
+    assert(st7789_emu_crc(10, 100, 150, 12) == crc);
+    st7789_emu_detach();
+}
+
+/** menu moves selection by two rows, scroll redraws all rows */
+void test_widget_menu(void)
+{
+    static const char * const items[] = {"LSB", "USB", "CW", "AM", "FM", "DIGI"};
+    static const widget_menu_def_t def =
+    {10, 130, 6, 3, &Font_7x10, WHITE, BLACK, BLACK, YELLOW, items, 6};
+    uint32_t row = 6 * 7 * 10;
+    widget_menu_t m;
+
+    st7789_emu_attach(BLUE);
+    display_init();
+    widget_menu_init(&m, &def);
+    assert(widget_menu_select(&m, 0) == 0);
+    assert(test_widget_pixels() == 3 * row);
+    assert(widget_menu_select(&m, 1) == 0);
+    assert(test_widget_pixels() == 2 * row);
+    assert(st7789_emu_pixel(10 + 6 * 7 - 1, 140) == YELLOW);
+    assert(st7789_emu_pixel(10 + 6 * 7 - 1, 130) == BLACK);
+    assert(widget_menu_select(&m, 1) == 0);
+    assert(test_widget_pixels() == 0);
+    assert(widget_menu_select(&m, 3) == 0);
+    assert(m.top == 1);
+    assert(test_widget_pixels() == 3 * row);
+    assert(widget_menu_select(&m, 200) == 0);
+    assert((m.selected == 5) && (m.top == 3));
+    test_display_drain();
+    assert(st7789_emu_pixel(10, 150) == YELLOW);
+    st7789_emu_detach();
+}
+
+/** status icons are drawn or cleared one by one */
+void test_widget_icons(void)
+{
+    // 8x8 solid icons: color, run of 62, run of 1
+    static const uint8_t red[] = {IMAGE_OP_COLOR, 0xf8, 0x00, IMAGE_OP_RUN | 61, IMAGE_OP_RUN};
+    static const uint8_t green[] = {IMAGE_OP_COLOR, 0x07, 0xe0, IMAGE_OP_RUN | 61, IMAGE_OP_RUN};
+    static const image_t icon_red = {8, 8, sizeof(red), red};
+    static const image_t icon_green = {8, 8, sizeof(green), green};
+    static const image_t * const icons[] = {&icon_red, &icon_green, &icon_red};
+    static const widget_icons_def_t def = {200, 4, 3, 2, icons, BLACK};
+    widget_icons_t w;
+
+    st7789_emu_attach(BLUE);
+    display_init();
+    widget_icons_init(&w, &def);
+    assert(widget_icons_set(&w, 5) == 0);
+    assert(test_widget_pixels() == 3 * 64);
+    assert(st7789_emu_pixel(200, 4) == RED);
+    assert(st7789_emu_pixel(210, 4) == BLACK);
+    assert(st7789_emu_pixel(220, 11) == RED);
+    assert(widget_icons_set(&w, 6) == 0);
+    assert(test_widget_pixels() == 2 * 64);
+    assert(st7789_emu_pixel(200, 4) == BLACK);
+    assert(st7789_emu_pixel(217, 11) == GREEN);
+    st7789_emu_detach();
+}
+
+/** pixels written to emulated panel by last drawing */
+static uint32_t test_clip_pixels(void)
+{
+    static uint32_t last = 0;
+    uint32_t n;
+    ST7789_WaitIdle();
+    n = st7789_emu_written - last;
+    last = st7789_emu_written;
+    return n;
+}
+
+/** fills crossing the edge of screen send only visible pixels */
+void test_clip_fill(void)
+{
+    ST7789_Init();
+    st7789_emu_attach(BLACK);
+    test_clip_pixels();
+    ST7789_Fill(230, 230, 300, 300, RED);
+    assert(test_clip_pixels() == 10 * 10);
+    assert(st7789_emu_pixel(239, 239) == RED);
+    assert(st7789_emu_pixel(229, 239) == BLACK);
+    // reversed corners
+    ST7789_Fill(500, 100, 0, 100, GREEN);
+    assert(test_clip_pixels() == ST7789_WIDTH);
+    assert(st7789_emu_pixel(0, 100) == GREEN);
+    // outside of screen
+    fake_spi_reset();
+    ST7789_Fill(250, 0, 260, 10, GREEN);
+    ST7789_DrawFilledRectangle(0, ST7789_HEIGHT, 10, 10, GREEN);
+    assert(fake_spi_stats.bytes == 0);
+    ST7789_DrawFilledRectangle(235, 235, 10, 10, BLUE);
+    assert(test_clip_pixels() == 5 * 5);
+    st7789_emu_detach();
+}
+
+/** shapes at the corner do not wrap around */
+void test_clip_shapes(void)
+{
+    st7789_emu_attach(BLACK);
+    test_clip_pixels();
+    ST7789_DrawPixel_4px(0, 0, RED);
+    assert(test_clip_pixels() == 2 * 2);
+    assert(st7789_emu_pixel(1, 1) == RED);
+    assert(st7789_emu_pixel(ST7789_WIDTH - 1, 0) == BLACK);
+    assert(st7789_emu_pixel(0, ST7789_HEIGHT - 1) == BLACK);
+    ST7789_DrawPixel_4px(ST7789_WIDTH - 1, ST7789_HEIGHT - 1, RED);
+    assert(test_clip_pixels() == 2 * 2);
+    ST7789_DrawFilledCircle(0, 0, 20, GREEN);
+    ST7789_DrawCircle(ST7789_WIDTH - 1, 0, 20, GREEN);
+    ST7789_DrawLine(230, 10, 300, 10, GREEN);
+    test_clip_pixels();
+    assert(st7789_emu_pixel(ST7789_WIDTH - 1, 20) == GREEN);
+    assert(st7789_emu_pixel(ST7789_WIDTH - 1, ST7789_HEIGHT - 20) == BLACK);
+    assert(st7789_emu_pixel(100, 10) == BLACK);
+    st7789_emu_detach();
+}
+
+/** glyphs cut by the edge of screen are drawn partially */
+void test_clip_text(void)
+{
+    uint16_t w = Font_11x18.width, h = Font_11x18.height;
+
+    st7789_emu_attach(BLACK);
+    test_clip_pixels();
+    ST7789_WriteChar(100, 100, 'W', Font_11x18, WHITE, BLUE);
+    ST7789_WriteChar(ST7789_WIDTH - 5, 0, 'W', Font_11x18, WHITE, BLUE);
+    ST7789_WriteChar(0, ST7789_HEIGHT - 7, 'W', Font_11x18, WHITE, BLUE);
+    assert(test_clip_pixels() == (uint32_t)(w * h + 5 * h + w * 7));
+    for (uint16_t y = 0; y < h; y++)
+    {
+        for (uint16_t x = 0; x < w; x++)
+        {
+            uint16_t c = st7789_emu_pixel((uint16_t)(100 + x), (uint16_t)(100 + y));
+            if (x < 5)
+            {
+                assert(st7789_emu_pixel((uint16_t)(ST7789_WIDTH - 5 + x), y) == c);
+            }
+            if (y < 7)
+            {
+                assert(st7789_emu_pixel(x, (uint16_t)(ST7789_HEIGHT - 7 + y)) == c);
+            }
+        }
+    }
+    // last line is drawn partially, anti-aliased font too
+    ST7789_WriteString(0, ST7789_HEIGHT - 10, "AB", Font_11x18a, WHITE, BLUE);
+    assert(test_clip_pixels() == 2 * w * 10);
+    ST7789_WriteString(ST7789_WIDTH - 2 * w, 0, "ABC", Font_11x18, WHITE, BLUE);
+    assert(test_clip_pixels() == 3 * w * h);
+    st7789_emu_detach();
+}
+
+/** widget is drawn by local coordinates inside of viewport */
+void test_clip_viewport(void)
+{
+    const uint16_t *saber = test_saber_rgb565();
+
+    st7789_emu_attach(BLACK);
+    test_clip_pixels();
+    ST7789_SetViewport(50, 60, 40, 30);
+    ST7789_Fill(0, 0, ST7789_WIDTH - 1, ST7789_HEIGHT - 1, GREEN);
+    assert(test_clip_pixels() == 40 * 30);
+    assert(st7789_emu_pixel(49, 60) == BLACK);
+    assert(st7789_emu_pixel(50, 59) == BLACK);
+    assert(st7789_emu_pixel(89, 89) == GREEN);
+    assert(st7789_emu_pixel(90, 89) == BLACK);
+    ST7789_DrawPixel(0, 0, RED);
+    ST7789_DrawPixel(40, 0, RED);
+    assert(test_clip_pixels() == 1);
+    assert(st7789_emu_pixel(50, 60) == RED);
+    ST7789_DrawFilledRectangle(30, 20, 100, 100, BLUE);
+    assert(test_clip_pixels() == 10 * 10);
+    assert(st7789_emu_pixel(89, 89) == BLUE);
+    ST7789_DrawImage(20, 10, 128, 128, saber);
+    assert(test_clip_pixels() == 20 * 20);
+    assert(st7789_emu_pixel(70, 70) == saber[0]);
+    assert(st7789_emu_pixel(89, 89) == saber[19 * 128 + 19]);
+    // 5 chars of 7x10 font fit in a line, 3 lines are visible
+    ST7789_WriteString(0, 0, "ABCDEFGHIJKLMNOPQRSTUVWXYZ", Font_7x10, WHITE, BLACK);
+    assert(test_clip_pixels() == 3 * 5 * 7 * 10);
+    // viewport is cut by screen
+    ST7789_SetViewport(200, 200, 100, 100);
+    ST7789_Fill(0, 0, ST7789_WIDTH - 1, ST7789_HEIGHT - 1, RED);
+    assert(test_clip_pixels() == 40 * 40);
+    // whole screen fill does not depend on viewport
+    ST7789_Fill_Color(BLACK);
+    assert(test_clip_pixels() == ST7789_WIDTH * ST7789_HEIGHT);
+    ST7789_ResetViewport();
+    ST7789_DrawPixel(0, 0, RED);
+    assert(st7789_emu_pixel(0, 0) == RED);
+    st7789_emu_detach();
+}
+
 
 typedef struct // group id + group name
 {
@@ -205,6 +3191,20 @@ static test_groups_t group_list[] =
     {1, "string_local.h"},
     {2, "shell functions"},
     {3, "utils"},
+    {4, "spi dma"},
+    {5, "st7789"},
+    {6, "framebuffer"},
+    {7, "waterfall"},
+    {8, "fonts"},
+    {9, "images"},
+    {10, "display queue"},
+    {11, "golden images"},
+    {12, "spi calibration"},
+    {13, "widgets"},
+    {14, "clipping"},
+    {15, "bandscope"},
+    {16, "strip renderer"},
+    {17, "uart"},
     {0, NULL}
 };
 
@@ -220,17 +3220,74 @@ static test_def_t test_list[] =
     {"itohex_u32",            test_itohex_u32, 1},
     {"itoa_s16",              test_itoa_s16, 1},
     {"itoa_u16",              test_itoa_u16, 1},
+    {"itoa_u32",              test_itoa_u32, 1},
     {"reverse",               test_reverse, 1},
     {"compare_strings",       test_compare_strings, 1},
     {"strnsmp_local",         test_strncmp_local, 1},
     {"strlen_local",          test_strlen_local, 1},
+    {"strcmp_local",          test_strcmp_local, 1},
+    {"atoi_u16",              test_atoi_u16, 1},
     {"shell_in_buffer_add",   test_shell_in_buffer_add, 2},
     {"shell_out_buffer_add",  test_shell_out_buffer_add, 2},
+    {"shell_out_stream",      test_shell_out_stream, 2},
     {"shell_cleanup_output",  test_shell_cleanup_output, 2},
     {"shell_process_hello",   test_shell_process_hello, 2},
     {"shell_process_args",    test_shell_process_args, 2},
     {"shell_cmds",            test_shell_cmds, 2},
     {"shell_process_unknown", test_shell_process_unknown, 2},
+    {"shell_tokenize",        test_shell_tokenize, 2},
+    {"shell_tokenize_fuzz",   test_shell_tokenize_fuzz, 2},
+    {"shell_cmd_table",       test_shell_cmd_table, 2},
+    {"shell_cmd_bench",       test_shell_cmd_bench, 2},
+    {"spi_dma_start_wait",    test_spi_dma_start_wait, 4},
+    {"spi_dma_timeout",       test_spi_dma_timeout, 4},
+    {"spi_configure",         test_spi_configure, 4},
+    {"spi_receive_stream",    test_spi_receive_stream, 4},
+    {"st7789_image_dma",      test_st7789_image_dma, 5},
+    {"st7789_image_small",    test_st7789_image_small, 5},
+    {"st7789_fill_bench",     test_st7789_fill_bench, 5},
+    {"st7789_write_string",   test_st7789_write_string, 5},
+    {"st7789_write_char",     test_st7789_write_char, 5},
+    {"st7789_span_bench",     test_st7789_span_bench, 5},
+    {"st7789_proportional",   test_st7789_proportional, 5},
+    {"st7789_text_aa",        test_st7789_text_aa, 5},
+    {"st7789_window_cache",   test_st7789_window_cache, 5},
+    {"fb_dirty_merge",        test_fb_dirty_merge, 6},
+    {"fb_flush_panel",        test_fb_flush_panel, 6},
+    {"waterfall_colormap",    test_waterfall_colormap, 7},
+    {"waterfall_scroll",      test_waterfall_scroll, 7},
+    {"fonts_packed",          test_fonts_packed, 8},
+    {"fonts_decode_speed",    test_fonts_decode_speed, 8},
+    {"fonts_aa",              test_fonts_aa, 8},
+    {"image_decode",          test_image_decode, 9},
+    {"image_draw_ppm",        test_image_draw_ppm, 9},
+    {"display_coalesce",      test_display_coalesce, 10},
+    {"display_viewport",      test_display_viewport, 10},
+    {"display_equivalence",   test_display_equivalence, 10},
+    {"display_te_sync",       test_display_te_sync, 10},
+    {"display_te_bench",      test_display_te_bench, 10},
+    {"st7789_emu_modes",      test_st7789_emu_modes, 11},
+    {"st7789_golden",         test_st7789_golden, 11},
+    {"st7789_read_back",      test_st7789_read_back, 12},
+    {"st7789_calibrate",      test_st7789_calibrate, 12},
+    {"st7789_verify",         test_st7789_verify, 12},
+    {"display_check",         test_display_check, 12},
+    {"widget_freq",           test_widget_freq, 13},
+    {"widget_label",          test_widget_label, 13},
+    {"widget_meter",          test_widget_meter, 13},
+    {"widget_menu",           test_widget_menu, 13},
+    {"widget_icons",          test_widget_icons, 13},
+    {"clip_fill",             test_clip_fill, 14},
+    {"clip_shapes",           test_clip_shapes, 14},
+    {"clip_text",             test_clip_text, 14},
+    {"clip_viewport",         test_clip_viewport, 14},
+    {"spectrum_peaks",        test_spectrum_peaks, 15},
+    {"spectrum_bench",        test_spectrum_bench, 15},
+    {"strip_render",          test_strip_render, 16},
+    {"strip_timing",          test_strip_timing, 16},
+    {"ring",                  test_ring, 17},
+    {"ring_stress",           test_ring_stress, 17},
+    {"uart_capture",          test_uart_capture, 17},
     {NULL, NULL, 0}
 };
 
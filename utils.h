@@ -9,6 +9,11 @@
  *
  */
 
+#ifndef UTILS_H_
+#define UTILS_H_
+
+#include <stdint.h>
+
 /**
  * @brief reverse bits order in number
  * @param num - number for reverse
@@ -30,3 +35,29 @@ static inline uint16_t reverse_bits(uint16_t num, uint8_t bits)
 
     return reverse_num;
 }
+
+/**
+ * @brief update CRC32 (IEEE 802.3, as zlib crc32) with data
+ * @param crc - CRC of previous data, 0 at start
+ * @param data, len - data
+ * @return CRC of all data
+ *
+ * Bitwise, no table, for checks where speed does not matter.
+ */
+static inline uint32_t crc32_update(uint32_t crc, const uint8_t *data, uint32_t len)
+{
+    crc = ~crc;
+    for (uint32_t i = 0; i < len; i++)
+    {
+        crc ^= data[i];
+        for (uint8_t k = 0; k < 8; k++)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320U & (0U - (crc & 1U)));
+        }
+    }
+    return ~crc;
+}
+
+#endif
+
+/** @}*/
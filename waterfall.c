@@ -0,0 +1,143 @@
+/** @weakgroup hardware
+ *  @{
+ */
+/**
+ * @file waterfall.c
+ * @brief spectrum waterfall on ST7789 hardware vertical scrolling
+ *
+ * Copyright 2020 Stanislav V. Vlasov <stanislav.v.v@gmail.com>
+ */
+
+#include <stdint.h>
+#include "st7789.h"
+#include "waterfall.h"
+
+/**
+ * magnitude to RGB565 lookup table
+ */
+static uint16_t wf_colormap[WATERFALL_LEVELS];
+
+/**
+ * waterfall area and row of the newest line, relative to top
+ * @{
+ */
+static uint16_t wf_top = 0;
+static uint16_t wf_height = 0;
+static uint16_t wf_pos = 0;
+/**
+ * @}
+ */
+
+/**
+ * RGB565 pixels of new line
+ */
+static uint16_t wf_row[ST7789_WIDTH];
+
+/**
+ * @brief make default color map black-blue-cyan-yellow-red-white
+ * @param lut - destination
+ */
+void waterfall_default_colormap(uint16_t lut[WATERFALL_LEVELS])
+{
+    /* gradient stops in RGB888 */
+    static const uint8_t stops[][3] =
+    {
+        {0, 0, 0}, {0, 0, 255}, {0, 255, 255},
+        {255, 255, 0}, {255, 0, 0}, {255, 255, 255}
+    };
+    const uint16_t segments = sizeof(stops) / sizeof(stops[0]) - 1;
+
+    for (uint16_t i = 0; i < WATERFALL_LEVELS; i++)
+    {
+        /* position in gradient, 8 bits of fraction */
+        uint32_t pos = (uint32_t)i * segments * 256 / (WATERFALL_LEVELS - 1);
+        uint16_t s = (uint16_t)(pos >> 8);
+        uint16_t f = (uint16_t)(pos & 0xff);
+        uint8_t rgb[3];
+        if (s >= segments)
+        {
+            s = (uint16_t)(segments - 1);
+            f = 256;
+        }
+        for (uint8_t c = 0; c < 3; c++)
+        {
+            int32_t a = stops[s][c];
+            int32_t b = stops[s + 1][c];
+            rgb[c] = (uint8_t)(a + (b - a) * f / 256);
+        }
+        lut[i] = (uint16_t)(((rgb[0] & 0xf8) << 8) | ((rgb[1] & 0xfc) << 3) | (rgb[2] >> 3));
+    }
+}
+
+/**
+ * @brief set color map
+ * @param lut - RGB565 color for every magnitude level
+ */
+void waterfall_set_colormap(const uint16_t lut[WATERFALL_LEVELS])
+{
+    for (uint16_t i = 0; i < WATERFALL_LEVELS; i++)
+    {
+        wf_colormap[i] = lut[i];
+    }
+}
+
+/**
+ * @brief init waterfall area and clear it
+ * @param top - first screen row of waterfall
+ * @param height - rows of waterfall
+ *
+ * Rows above and below waterfall stay fixed. Default color map
+ * is made by {@link #waterfall_default_colormap}.
+ */
+void waterfall_init(uint16_t top, uint16_t height)
+{
+    wf_top = top;
+    wf_height = height;
+    wf_pos = 0;
+    waterfall_default_colormap(wf_colormap);
+    ST7789_Fill(0, top, ST7789_WIDTH - 1, (uint16_t)(top + height - 1), wf_colormap[0]);
+    ST7789_SetScrollArea(top, height);
+    ST7789_SetScrollStart(top);
+}
+
+/**
+ * @brief add new line at the top of waterfall
+ * @param magnitude - magnitudes 0..255, stretched or shrinked to screen width
+ * @param count - count of magnitudes
+ *
+ * Sends one row of pixels and scroll start address.
+ */
+void waterfall_add_line(const uint8_t *magnitude, uint16_t count)
+{
+    uint16_t row;
+    uint16_t c = 0;
+
+    if ((wf_height == 0) || (count == 0))
+    {
+        return;
+    }
+
+    /* oldest row becomes the newest one */
+    wf_pos = (uint16_t)(wf_pos == 0 ? wf_height - 1 : wf_pos - 1);
+    row = (uint16_t)(wf_top + wf_pos);
+
+    /* previous line may be still sent from row buffer */
+    ST7789_StartWrite(0, row, ST7789_WIDTH - 1, row);
+    for (uint16_t x = 0; x < ST7789_WIDTH; x++)
+    {
+        wf_row[c++] = wf_colormap[magnitude[(uint32_t)x * count / ST7789_WIDTH]];
+    }
+    ST7789_WritePixels(wf_row, ST7789_WIDTH);
+    ST7789_SetScrollStart(row);
+}
+
+/**
+ * @brief switch off scrolling, waterfall rows stay in display RAM order
+ */
+void waterfall_stop(void)
+{
+    ST7789_SetScrollStart(wf_top);
+    wf_pos = 0;
+}
+
+/** @}*/
@@ -0,0 +1,62 @@
+/** @weakgroup hardware
+ *  @{
+ */
+/**
+ * @file waterfall.h
+ * @brief spectrum waterfall on ST7789 hardware vertical scrolling
+ *
+ * Copyright 2020 Stanislav V. Vlasov <stanislav.v.v@gmail.com>
+ *
+ * Waterfall rows are a ring in display RAM. Every new line is written
+ * over the oldest row and scroll start address is moved to it, so the
+ * newest line is shown at the top and older lines move down without
+ * redrawing: one row of pixels per update.
+ */
+
+#ifndef WATERFALL_H_
+#define WATERFALL_H_
+
+#include <stdint.h>
+
+/**
+ * magnitude levels in color map
+ */
+#define WATERFALL_LEVELS 256
+
+/**
+ * @brief init waterfall area and clear it
+ * @param top - first screen row of waterfall
+ * @param height - rows of waterfall
+ *
+ * Rows above and below waterfall stay fixed. Default color map
+ * is made by {@link #waterfall_default_colormap}.
+ */
+void waterfall_init(uint16_t top, uint16_t height);
+
+/**
+ * @brief set color map
+ * @param lut - RGB565 color for every magnitude level
+ */
+void waterfall_set_colormap(const uint16_t lut[WATERFALL_LEVELS]);
+
+/**
+ * @brief make default color map black-blue-cyan-yellow-red-white
+ * @param lut - destination
+ */
+void waterfall_default_colormap(uint16_t lut[WATERFALL_LEVELS]);
+
+/**
+ * @brief add new line at the top of waterfall
+ * @param magnitude - magnitudes 0..255, stretched or shrinked to screen width
+ * @param count - count of magnitudes
+ */
+void waterfall_add_line(const uint8_t *magnitude, uint16_t count);
+
+/**
+ * @brief switch off scrolling, waterfall rows stay in display RAM order
+ */
+void waterfall_stop(void);
+
+#endif
+
+/** @}*/
@@ -0,0 +1,432 @@
+/** @weakgroup hardware
+ *  @{
+ */
+/**
+ * @file widget.c
+ * @brief retained widgets of front panel drawn through display queue
+ *
+ * Copyright 2020 Stanislav V. Vlasov <stanislav.v.v@gmail.com>
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include "widget.h"
+
+/**
+ * @brief columns from char to next one
+ * @param font - font
+ * @param ch - char
+ * @return advance in columns
+ */
+static inline uint16_t widget_advance(const FontDef *font, char ch)
+{
+    return Font_Advance(font, Font_Glyph(font, ch));
+}
+
+/**
+ * @brief copy text cut or padded with spaces to len chars
+ * @param dst - destination, len + 1 chars
+ * @param str - text
+ * @param len - chars
+ */
+static void widget_pad(char *dst, const char *str, uint8_t len)
+{
+    uint8_t n = 0;
+
+    for (; (n < len) && (str[n] != 0); n++)
+    {
+        dst[n] = str[n];
+    }
+    for (; n < len; n++)
+    {
+        dst[n] = ' ';
+    }
+    dst[n] = 0;
+}
+
+/**
+ * @brief set text line to unknown state
+ * @param t - widget
+ * @param def - definition, must live as long as widget
+ */
+void widget_text_init(widget_text_t *t, const widget_text_def_t *def)
+{
+    t->def = def;
+    t->end = def->x;
+    for (uint8_t i = 0; i <= WIDGET_TEXT_LEN; i++)
+    {
+        t->drawn[i] = 0;
+    }
+}
+
+/**
+ * @brief show text
+ * @param t - widget
+ * @param str - text, chars beyond len are cut
+ * @return errno - 0 (ok), EBUSY (queue is full), EINVAL (outside of screen)
+ *
+ * Runs of changed chars are posted as one text command. Char of
+ * proportional font with other advance moves the rest of line, so
+ * everything after it is redrawn and freed columns are cleared.
+ */
+uint16_t widget_text_set(widget_text_t *t, const char *str)
+{
+    const widget_text_def_t *def = t->def;
+    uint8_t len = def->len < WIDGET_TEXT_LEN ? def->len : WIDGET_TEXT_LEN;
+    char s[WIDGET_TEXT_LEN + 1];
+    uint16_t x = def->x;
+    boolean moved = FALSE;
+    uint8_t i = 0;
+
+    widget_pad(s, str, len);
+    while (i < len)
+    {
+        uint8_t start = i;
+        uint16_t sx = x;
+        uint16_t res;
+        char c;
+
+        while ((i < len) && (moved || (s[i] != t->drawn[i])))
+        {
+            if ((t->drawn[i] == 0) ||
+                (widget_advance(def->font, s[i]) != widget_advance(def->font, t->drawn[i])))
+            {
+                moved = TRUE;
+            }
+            x = (uint16_t)(x + widget_advance(def->font, s[i]));
+            i++;
+        }
+        if (i == start)
+        {
+            x = (uint16_t)(x + widget_advance(def->font, s[i]));
+            i++;
+            continue;
+        }
+        c = s[i];
+        s[i] = 0;
+        res = display_text(sx, def->y, &s[start], def->font, def->color, def->bgcolor);
+        s[i] = c;
+        if (res != 0)
+        {
+            /* redraw the rest by next update */
+            for (; start < len; start++)
+            {
+                t->drawn[start] = 0;
+            }
+            return res;
+        }
+        for (; start < i; start++)
+        {
+            t->drawn[start] = s[start];
+        }
+    }
+    if (x < t->end)
+    {
+        uint16_t res = display_fill(x, def->y, (uint16_t)(t->end - 1),
+                                    (uint16_t)(def->y + def->font->height - 1), def->bgcolor);
+        if (res != 0)
+        {
+            return res;
+        }
+    }
+    t->end = x;
+    return 0;
+}
+
+/**
+ * @brief set frequency readout to unknown state
+ * @param f - widget
+ * @param def - definition, len includes dots
+ */
+void widget_freq_init(widget_freq_t *f, const widget_text_def_t *def)
+{
+    widget_text_init(&f->text, def);
+    f->hz = 0;
+}
+
+/**
+ * @brief show frequency
+ * @param f - widget
+ * @param hz - frequency
+ * @return errno - 0 (ok), EBUSY (queue is full), EINVAL (does not fit)
+ *
+ * Step of VFO changes few low digits, only they are posted.
+ */
+uint16_t widget_freq_set(widget_freq_t *f, uint32_t hz)
+{
+    uint8_t len = f->text.def->len < WIDGET_TEXT_LEN ? f->text.def->len : WIDGET_TEXT_LEN;
+    char s[WIDGET_TEXT_LEN + 1];
+    uint32_t n = hz;
+
+    /* from right to left, every 4th place is dot */
+    s[len] = 0;
+    for (uint8_t k = 0; k < len; k++)
+    {
+        uint8_t pos = (uint8_t)(len - 1 - k);
+        if (k % 4 == 3)
+        {
+            s[pos] = n ? '.' : ' ';
+        }
+        else
+        {
+            s[pos] = (n || (k == 0)) ? (char)('0' + n % 10) : ' ';
+            n /= 10;
+        }
+    }
+    if (n != 0)
+    {
+        return EINVAL;
+    }
+    f->hz = hz;
+    return widget_text_set(&f->text, s);
+}
+
+/**
+ * @brief set labelled value to unknown state
+ * @param l - widget
+ * @param def - definition
+ */
+void widget_label_init(widget_label_t *l, const widget_label_def_t *def)
+{
+    l->def = def;
+    widget_text_init(&l->label, &def->label_def);
+    widget_text_init(&l->value, &def->value_def);
+}
+
+/**
+ * @brief show label and value
+ * @param l - widget
+ * @param value - text of value
+ * @return errno - 0 (ok), EBUSY (queue is full), EINVAL (outside of screen)
+ */
+uint16_t widget_label_set(widget_label_t *l, const char *value)
+{
+    uint16_t res = widget_text_set(&l->label, l->def->label);
+
+    if (res != 0)
+    {
+        return res;
+    }
+    return widget_text_set(&l->value, value);
+}
+
+/**
+ * @brief set bar graph to unknown state
+ * @param m - widget
+ * @param def - definition
+ */
+void widget_meter_init(widget_meter_t *m, const widget_meter_def_t *def)
+{
+    m->def = def;
+    m->lit = 0;
+    m->valid = 0;
+}
+
+/**
+ * @brief show level
+ * @param m - widget
+ * @param level - lit segments, cut to count of segments
+ * @return errno - 0 (ok), EBUSY (queue is full), EINVAL (outside of screen)
+ *
+ * Only segments between old and new level are posted.
+ */
+uint16_t widget_meter_set(widget_meter_t *m, uint8_t level)
+{
+    const widget_meter_def_t *def = m->def;
+    uint8_t count = def->segments < WIDGET_MAX_ITEMS ? def->segments : WIDGET_MAX_ITEMS;
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        uint32_t bit = 1UL << i;
+        boolean on = (i < level);
+        uint16_t x, color, res;
+
+        if ((m->valid & bit) && (((m->lit & bit) != 0) == on))
+        {
+            continue;
+        }
+        color = !on ? def->off_color : (i >= def->warn ? def->warn_color : def->color);
+        x = (uint16_t)(def->x + i * (def->width + def->gap));
+        res = display_fill(x, def->y, (uint16_t)(x + def->width - 1),
+                           (uint16_t)(def->y + def->height - 1), color);
+        if (res != 0)
+        {
+            return res;
+        }
+        m->valid |= bit;
+        m->lit = on ? (m->lit | bit) : (m->lit & ~bit);
+    }
+    return 0;
+}
+
+/**
+ * @brief set menu to unknown state
+ * @param m - widget
+ * @param def - definition
+ */
+void widget_menu_init(widget_menu_t *m, const widget_menu_def_t *def)
+{
+    m->def = def;
+    m->top = 0;
+    m->selected = 0;
+    m->drawn_sel = WIDGET_UNKNOWN;
+    for (uint8_t r = 0; r < WIDGET_MENU_ROWS; r++)
+    {
+        m->drawn[r] = WIDGET_UNKNOWN;
+    }
+}
+
+/**
+ * @brief draw row of menu
+ * @param m - widget
+ * @param row - visible row
+ * @param item - item, count of items for empty row
+ * @param sel - draw as selected
+ * @return errno - 0 (ok), EBUSY (queue is full), EINVAL (outside of screen)
+ */
+static uint16_t widget_menu_row(const widget_menu_t *m, uint8_t row, uint8_t item,
+                                boolean sel)
+{
+    const widget_menu_def_t *def = m->def;
+    uint8_t width = def->width < WIDGET_TEXT_LEN ? def->width : WIDGET_TEXT_LEN;
+    uint16_t y = (uint16_t)(def->y + row * def->font->height);
+    uint16_t bgcolor = sel ? def->sel_bgcolor : def->bgcolor;
+    uint16_t end = (uint16_t)(def->x + width * def->font->width);
+    uint16_t x = def->x;
+    char s[WIDGET_TEXT_LEN + 1];
+    uint16_t res;
+
+    widget_pad(s, item < def->count ? def->items[item] : "", width);
+    res = display_text(def->x, y, s, def->font, sel ? def->sel_color : def->color, bgcolor);
+    for (uint8_t i = 0; i < width; i++)
+    {
+        x = (uint16_t)(x + widget_advance(def->font, s[i]));
+    }
+    /* proportional text is narrower than row */
+    if ((res == 0) && (x < end))
+    {
+        res = display_fill(x, y, (uint16_t)(end - 1),
+                           (uint16_t)(y + def->font->height - 1), bgcolor);
+    }
+    return res;
+}
+
+/**
+ * @brief select item, menu is scrolled to show it
+ * @param m - widget
+ * @param item - selected item, cut to count of items
+ * @return errno - 0 (ok), EBUSY (queue is full), EINVAL (outside of screen)
+ *
+ * Without scroll only rows of old and new selection are posted.
+ */
+uint16_t widget_menu_select(widget_menu_t *m, uint8_t item)
+{
+    const widget_menu_def_t *def = m->def;
+    uint8_t rows = def->rows < WIDGET_MENU_ROWS ? def->rows : WIDGET_MENU_ROWS;
+
+    if ((def->count == 0) || (rows == 0))
+    {
+        return 0;
+    }
+    if (item >= def->count)
+    {
+        item = (uint8_t)(def->count - 1);
+    }
+    m->selected = item;
+    if (item < m->top)
+    {
+        m->top = item;
+    }
+    if (item >= m->top + rows)
+    {
+        m->top = (uint8_t)(item - rows + 1);
+    }
+    for (uint8_t r = 0; r < rows; r++)
+    {
+        uint8_t shown = (uint8_t)(m->top + r);
+        boolean sel = (shown == item);
+        uint16_t res;
+
+        if (shown > def->count)
+        {
+            shown = def->count;
+        }
+        if ((m->drawn[r] == shown) && ((m->drawn_sel == r) == sel))
+        {
+            continue;
+        }
+        res = widget_menu_row(m, r, shown, sel);
+        if (res != 0)
+        {
+            m->drawn[r] = WIDGET_UNKNOWN;
+            return res;
+        }
+        m->drawn[r] = shown;
+        if (sel)
+        {
+            m->drawn_sel = r;
+        }
+        else if (m->drawn_sel == r)
+        {
+            m->drawn_sel = WIDGET_UNKNOWN;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief set status icons to unknown state
+ * @param w - widget
+ * @param def - definition
+ */
+void widget_icons_init(widget_icons_t *w, const widget_icons_def_t *def)
+{
+    w->def = def;
+    w->shown = 0;
+    w->valid = 0;
+}
+
+/**
+ * @brief show icons
+ * @param w - widget
+ * @param mask - bit n shows icon n
+ * @return errno - 0 (ok), EBUSY (queue is full), EINVAL (outside of screen)
+ *
+ * Hidden icon is cleared with background color.
+ */
+uint16_t widget_icons_set(widget_icons_t *w, uint32_t mask)
+{
+    const widget_icons_def_t *def = w->def;
+    uint8_t count = def->count < WIDGET_MAX_ITEMS ? def->count : WIDGET_MAX_ITEMS;
+    uint16_t x = def->x;
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        const image_t *icon = def->icons[i];
+        uint32_t bit = 1UL << i;
+        uint16_t res = 0;
+
+        if (!(w->valid & bit) || ((w->shown ^ mask) & bit))
+        {
+            if (mask & bit)
+            {
+                res = display_image(x, def->y, icon);
+            }
+            else
+            {
+                res = display_fill(x, def->y, (uint16_t)(x + icon->width - 1),
+                                   (uint16_t)(def->y + icon->height - 1), def->bgcolor);
+            }
+            if (res != 0)
+            {
+                return res;
+            }
+            w->valid |= bit;
+            w->shown = (w->shown & ~bit) | (mask & bit);
+        }
+        x = (uint16_t)(x + icon->width + def->gap);
+    }
+    return 0;
+}
+
+/** @}*/
@@ -0,0 +1,262 @@
+/** @weakgroup hardware
+ *  @{
+ */
+/**
+ * @file widget.h
+ * @brief retained widgets of front panel drawn through display queue
+ *
+ * Copyright 2020 Stanislav V. Vlasov <stanislav.v.v@gmail.com>
+ *
+ * Every widget is a constant definition (place, font, colors), which
+ * may live in flash, and small state in RAM with what is on screen now.
+ * Update of widget posts commands only for chars, segments, rows or
+ * icons which differ from drawn ones. If queue is full, EBUSY is
+ * returned and not posted parts are kept unknown, so they are drawn
+ * by next update.
+ */
+
+#ifndef WIDGET_H_
+#define WIDGET_H_
+
+#include <stdint.h>
+#include "bool.h"
+#include "fonts.h"
+#include "image.h"
+#include "display.h"
+
+/**
+ * max chars of text widget and menu row
+ */
+#define WIDGET_TEXT_LEN DISPLAY_TEXT_LEN
+
+/**
+ * max visible rows of menu
+ */
+#define WIDGET_MENU_ROWS 8
+
+/**
+ * max segments of meter and icons of status line
+ */
+#define WIDGET_MAX_ITEMS 32
+
+/**
+ * unknown state of menu row
+ */
+#define WIDGET_UNKNOWN 0xff
+
+/**
+ * text line definition
+ */
+typedef struct //vera++ blamed for single space
+{
+    uint16_t x, y;            /** top left corner */
+    uint8_t len;              /** chars, shorter text is padded with spaces */
+    const FontDef *font;
+    uint16_t color, bgcolor;
+} widget_text_def_t;
+
+/**
+ * text line, only changed chars are redrawn
+ */
+typedef struct //vera++ blamed for single space
+{
+    const widget_text_def_t *def;
+    uint16_t end;             /** column after last drawn char */
+    char drawn[WIDGET_TEXT_LEN + 1]; /** chars on screen, 0 - unknown */
+} widget_text_t;
+
+/**
+ * frequency readout in Hz, digits are grouped by 3 with dots,
+ * leading zeros are blank: " 14.074.000"
+ */
+typedef struct //vera++ blamed for single space
+{
+    widget_text_t text;
+    uint32_t hz;
+} widget_freq_t;
+
+/**
+ * label and value definition
+ */
+typedef struct //vera++ blamed for single space
+{
+    const char *label;
+    widget_text_def_t label_def;
+    widget_text_def_t value_def;
+} widget_label_def_t;
+
+/**
+ * labelled value, label is drawn once
+ */
+typedef struct //vera++ blamed for single space
+{
+    const widget_label_def_t *def;
+    widget_text_t label;
+    widget_text_t value;
+} widget_label_t;
+
+/**
+ * bar graph definition, segments go from left to right
+ */
+typedef struct //vera++ blamed for single space
+{
+    uint16_t x, y;            /** top left corner */
+    uint8_t segments;         /** count of segments, up to WIDGET_MAX_ITEMS */
+    uint8_t width, height;    /** size of segment */
+    uint8_t gap;              /** columns between segments */
+    uint8_t warn;             /** first segment of warn color, ex. S9+ */
+    uint16_t color, warn_color, off_color;
+} widget_meter_def_t;
+
+/**
+ * bar graph, S-meter
+ */
+typedef struct //vera++ blamed for single space
+{
+    const widget_meter_def_t *def;
+    uint32_t lit;             /** lit segments on screen */
+    uint32_t valid;           /** segments with known state */
+} widget_meter_t;
+
+/**
+ * menu list definition
+ */
+typedef struct //vera++ blamed for single space
+{
+    uint16_t x, y;            /** top left corner */
+    uint8_t width;            /** chars of row */
+    uint8_t rows;             /** visible rows, up to WIDGET_MENU_ROWS */
+    const FontDef *font;
+    uint16_t color, bgcolor;  /** colors of item */
+    uint16_t sel_color, sel_bgcolor; /** colors of selected item */
+    const char * const *items;
+    uint8_t count;            /** count of items */
+} widget_menu_def_t;
+
+/**
+ * menu list scrolled to selected item
+ */
+typedef struct //vera++ blamed for single space
+{
+    const widget_menu_def_t *def;
+    uint8_t top;              /** first visible item */
+    uint8_t selected;
+    uint8_t drawn[WIDGET_MENU_ROWS];  /** item shown in row, WIDGET_UNKNOWN */
+    uint8_t drawn_sel;        /** row shown as selected, WIDGET_UNKNOWN */
+} widget_menu_t;
+
+/**
+ * status icons definition, icons are placed in one row
+ */
+typedef struct //vera++ blamed for single space
+{
+    uint16_t x, y;            /** top left corner */
+    uint8_t count;            /** count of icons, up to WIDGET_MAX_ITEMS */
+    uint8_t gap;              /** columns between icons */
+    const image_t * const *icons;
+    uint16_t bgcolor;         /** place of hidden icon */
+} widget_icons_def_t;
+
+/**
+ * status icons
+ */
+typedef struct //vera++ blamed for single space
+{
+    const widget_icons_def_t *def;
+    uint32_t shown;           /** icons on screen */
+    uint32_t valid;           /** icons with known state */
+} widget_icons_t;
+
+/**
+ * @brief set text line to unknown state
+ * @param t - widget
+ * @param def - definition, must live as long as widget
+ */
+void widget_text_init(widget_text_t *t, const widget_text_def_t *def);
+
+/**
+ * @brief show text
+ * @param t - widget
+ * @param str - text, chars beyond len are cut
+ * @return errno - 0 (ok), EBUSY (queue is full), EINVAL (outside of screen)
+ */
+uint16_t widget_text_set(widget_text_t *t, const char *str);
+
+/**
+ * @brief set frequency readout to unknown state
+ * @param f - widget
+ * @param def - definition, len includes dots
+ */
+void widget_freq_init(widget_freq_t *f, const widget_text_def_t *def);
+
+/**
+ * @brief show frequency
+ * @param f - widget
+ * @param hz - frequency
+ * @return errno - 0 (ok), EBUSY (queue is full), EINVAL (does not fit)
+ */
+uint16_t widget_freq_set(widget_freq_t *f, uint32_t hz);
+
+/**
+ * @brief set labelled value to unknown state
+ * @param l - widget
+ * @param def - definition
+ */
+void widget_label_init(widget_label_t *l, const widget_label_def_t *def);
+
+/**
+ * @brief show label and value
+ * @param l - widget
+ * @param value - text of value
+ * @return errno - 0 (ok), EBUSY (queue is full), EINVAL (outside of screen)
+ */
+uint16_t widget_label_set(widget_label_t *l, const char *value);
+
+/**
+ * @brief set bar graph to unknown state
+ * @param m - widget
+ * @param def - definition
+ */
+void widget_meter_init(widget_meter_t *m, const widget_meter_def_t *def);
+
+/**
+ * @brief show level
+ * @param m - widget
+ * @param level - lit segments, cut to count of segments
+ * @return errno - 0 (ok), EBUSY (queue is full), EINVAL (outside of screen)
+ */
+uint16_t widget_meter_set(widget_meter_t *m, uint8_t level);
+
+/**
+ * @brief set menu to unknown state
+ * @param m - widget
+ * @param def - definition
+ */
+void widget_menu_init(widget_menu_t *m, const widget_menu_def_t *def);
+
+/**
+ * @brief select item, menu is scrolled to show it
+ * @param m - widget
+ * @param item - selected item, cut to count of items
+ * @return errno - 0 (ok), EBUSY (queue is full), EINVAL (outside of screen)
+ */
+uint16_t widget_menu_select(widget_menu_t *m, uint8_t item);
+
+/**
+ * @brief set status icons to unknown state
+ * @param w - widget
+ * @param def - definition
+ */
+void widget_icons_init(widget_icons_t *w, const widget_icons_def_t *def);
+
+/**
+ * @brief show icons
+ * @param w - widget
+ * @param mask - bit n shows icon n
+ * @return errno - 0 (ok), EBUSY (queue is full), EINVAL (outside of screen)
+ */
+uint16_t widget_icons_set(widget_icons_t *w, uint32_t mask);
+
+#endif
+
+/** @}*/